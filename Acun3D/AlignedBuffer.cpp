@@ -0,0 +1,42 @@
+#include "AlignedBuffer.h"
+
+namespace a3d
+{
+	AlignedBuffer::AlignedBuffer()
+	{
+		_block = 0;
+		_data = 0;
+	}
+
+	AlignedBuffer::~AlignedBuffer()
+	{
+		release();
+	}
+
+	/*
+	 * Replaces the buffer with a new one of size bytes, whose contents are undefined
+	 */
+	void* AlignedBuffer::allocate(size_t size)
+	{
+		release();
+
+		_block = new unsigned char[size + ALIGNMENT - 1];
+		_data = (void*)(((size_t)_block + ALIGNMENT - 1) & ~(ALIGNMENT - 1));
+
+		return _data;
+	}
+
+	void AlignedBuffer::release()
+	{
+		if (_block != 0)
+			delete[] _block;
+
+		_block = 0;
+		_data = 0;
+	}
+
+	void* AlignedBuffer::get() const
+	{
+		return _data;
+	}
+}
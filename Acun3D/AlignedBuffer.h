@@ -0,0 +1,36 @@
+#ifndef __ALIGNEDBUFFER_H__
+#define __ALIGNEDBUFFER_H__
+
+#include <stddef.h>
+
+namespace a3d
+{
+	/*
+	 * A block of memory whose start is aligned to a cache line, so that buffers laid out
+	 * in cache-line-sized pieces line up with the cache
+	 */
+	class AlignedBuffer
+	{
+	public:
+		// Alignment of the start of the buffer in bytes
+		static const size_t ALIGNMENT = 64;
+
+		AlignedBuffer();
+		~AlignedBuffer();
+
+		void* allocate(size_t size);
+		void release();
+
+		void* get() const;
+
+	private:
+		// Not copyable
+		AlignedBuffer(const AlignedBuffer&);
+		AlignedBuffer& operator=(const AlignedBuffer&);
+
+		unsigned char* _block;
+		void* _data;
+	};
+}
+
+#endif
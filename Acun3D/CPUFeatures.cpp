@@ -0,0 +1,101 @@
+#include "CPUFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define X86
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#define X86
+#endif
+
+namespace a3d
+{
+	// CPUID leaf 1
+	static const unsigned int EDX_SSE2 = 1 << 26;
+	static const unsigned int ECX_OSXSAVE = 1 << 27;
+	static const unsigned int ECX_AVX = 1 << 28;
+
+	// CPUID leaf 7
+	static const unsigned int EBX_AVX2 = 1 << 5;
+	static const unsigned int EBX_AVX512F = 1 << 16;
+
+	// XCR0 state components
+	static const unsigned int XCR0_AVX = 0x06;
+	static const unsigned int XCR0_AVX512 = 0xE6;
+
+	bool CPUFeatures::hasSSE2()
+	{
+		unsigned int registers[4];
+		cpuid(1, 0, registers);
+
+		return (registers[3] & EDX_SSE2) != 0;
+	}
+
+	bool CPUFeatures::hasAVX2()
+	{
+		unsigned int registers[4];
+		cpuid(0, 0, registers);
+
+		if (registers[0] < 7)
+			return false;
+
+		cpuid(1, 0, registers);
+
+		if ((registers[2] & (ECX_OSXSAVE | ECX_AVX)) != (ECX_OSXSAVE | ECX_AVX) || !osSavesState(XCR0_AVX))
+			return false;
+
+		cpuid(7, 0, registers);
+
+		return (registers[1] & EBX_AVX2) != 0;
+	}
+
+	bool CPUFeatures::hasAVX512()
+	{
+		unsigned int registers[4];
+		cpuid(0, 0, registers);
+
+		if (registers[0] < 7)
+			return false;
+
+		cpuid(1, 0, registers);
+
+		if ((registers[2] & ECX_OSXSAVE) == 0 || !osSavesState(XCR0_AVX512))
+			return false;
+
+		cpuid(7, 0, registers);
+
+		return (registers[1] & EBX_AVX512F) != 0;
+	}
+
+	/*
+	 * Fills registers with eax, ebx, ecx and edx for the given leaf, or zeros if there's no CPUID
+	 */
+	void CPUFeatures::cpuid(int leaf, int subleaf, unsigned int* registers)
+	{
+		registers[0] = registers[1] = registers[2] = registers[3] = 0;
+
+#if defined(X86) && defined(_MSC_VER)
+		__cpuidex((int*)registers, leaf, subleaf);
+#elif defined(X86)
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	/*
+	 * Whether the operating system saves the given register state on a context switch
+	 * Only valid once OSXSAVE has been checked
+	 */
+	bool CPUFeatures::osSavesState(unsigned int stateMask)
+	{
+		unsigned int xcr0 = 0;
+
+#if defined(X86) && defined(_MSC_VER)
+		xcr0 = (unsigned int)_xgetbv(0);
+#elif defined(X86)
+		unsigned int edx;
+		__asm__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+#endif
+
+		return (xcr0 & stateMask) == stateMask;
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef __CPUFEATURES_H__
+#define __CPUFEATURES_H__
+
+namespace a3d
+{
+	/*
+	 * Queries the instruction sets supported by the CPU and operating system
+	 */
+	class CPUFeatures
+	{
+	public:
+		static bool hasSSE2();
+		static bool hasAVX2();
+		static bool hasAVX512();
+
+	private:
+		static void cpuid(int leaf, int subleaf, unsigned int* registers);
+		static bool osSavesState(unsigned int stateMask);
+	};
+}
+
+#endif
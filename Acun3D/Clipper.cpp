@@ -0,0 +1,199 @@
+#include <algorithm>
+
+#include "Clipper.h"
+
+namespace a3d
+{
+	Clipper::Clipper()
+	{
+		_width = 0;
+		_height = 0;
+		_guardX = 0.5f;
+		_guardY = 0.5f;
+		_reversedDepth = false;
+	}
+
+	/*
+	 * Sets the size of the screen triangles are drawn to, and how many pixels past its left and right,
+	 * and top and bottom, edges vertices may go before triangles are clipped
+	 * A negative guard band clips triangles to that far inside the edges instead
+	 */
+	void Clipper::setViewport(int width, int height, int guardBandX, int guardBandY)
+	{
+		_width = (float)width;
+		_height = (float)height;
+
+		_guardX = 0.5f;
+		_guardY = 0.5f;
+
+		if (width > 0)
+			_guardX += (float)guardBandX / (float)width;
+		if (height > 0)
+			_guardY += (float)guardBandY / (float)height;
+	}
+
+	/*
+	 * Sets whether clip-space depth is reversed, running from w at the near plane to 0 at the far plane
+	 * as the renderer's projection gives it for reversed depth (see DepthFormats)
+	 */
+	void Clipper::setReversedDepth(bool reversed)
+	{
+		_reversedDepth = reversed;
+	}
+
+	/*
+	 * Returns the planes a clip-space position is outside of
+	 */
+	int Clipper::getOutcode(const Vertex& position) const
+	{
+		const float x = position(0, 0);
+		const float y = position(1, 0);
+		const float z = position(2, 0);
+		const float w = position(3, 0);
+
+		int outcode = 0;
+
+		if (z < 0)
+			outcode |= (_reversedDepth ? OUTSIDE_FAR : OUTSIDE_NEAR);
+		if (z > w)
+			outcode |= (_reversedDepth ? OUTSIDE_NEAR : OUTSIDE_FAR);
+
+		if (x < -0.5f * w)
+			outcode |= OUTSIDE_LEFT;
+		if (x > 0.5f * w)
+			outcode |= OUTSIDE_RIGHT;
+		if (y < -0.5f * w)
+			outcode |= OUTSIDE_BOTTOM;
+		if (y > 0.5f * w)
+			outcode |= OUTSIDE_TOP;
+
+		if (x < -_guardX * w)
+			outcode |= OUTSIDE_GUARD_LEFT;
+		if (x > _guardX * w)
+			outcode |= OUTSIDE_GUARD_RIGHT;
+		if (y < -_guardY * w)
+			outcode |= OUTSIDE_GUARD_BOTTOM;
+		if (y > _guardY * w)
+			outcode |= OUTSIDE_GUARD_TOP;
+
+		return outcode;
+	}
+
+	void Clipper::setPosition(ClipVertex& v, const Vertex& position)
+	{
+		v.x = position(0, 0);
+		v.y = position(1, 0);
+		v.z = position(2, 0);
+		v.w = position(3, 0);
+	}
+
+	/*
+	 * Clips the triangle in the first three vertices of polygon against the planes in outcode it crosses,
+	 * leaving the convex polygon left, with its screen positions, in polygon, which has room for MAX_VERTICES
+	 * Returns the number of vertices in the polygon, to be drawn as a fan around the first, or 0 if nothing is left
+	 */
+	int Clipper::clipTriangle(ClipVertex* polygon, int attributeCount, int outcode) const
+	{
+		ClipVertex buffer[MAX_VERTICES];
+
+		ClipVertex* in = polygon;
+		ClipVertex* out = buffer;
+		int count = 3;
+
+		for (int plane = OUTSIDE_NEAR; plane <= OUTSIDE_GUARD_TOP && count > 0; plane <<= 1)
+		{
+			if ((outcode & plane & CLIP_PLANES) == 0)
+				continue;
+
+			count = clipPolygon(in, count, out, attributeCount, plane);
+			std::swap(in, out);
+		}
+
+		if (in != polygon)
+			std::copy(in, in + count, polygon);
+
+		// Nothing left is behind the near plane, so w is positive
+		for (int i = 0; i < count; ++i)
+		{
+			ClipVertex& v = polygon[i];
+
+			v.screenX = (v.x / v.w) * _width + _width / 2.0f;
+			v.screenY = (v.y / v.w) * _height + _height / 2.0f;
+			v.screenZ = v.z / v.w;
+		}
+
+		return count;
+	}
+
+	/*
+	 * Clips a convex polygon against one plane, writing what's inside of it to out
+	 */
+	int Clipper::clipPolygon(const ClipVertex* in, int count, ClipVertex* out, int attributeCount, int plane) const
+	{
+		int outCount = 0;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const ClipVertex& a = in[i];
+			const ClipVertex& b = in[(i + 1) % count];
+
+			const float distanceA = getDistance(a, plane);
+			const float distanceB = getDistance(b, plane);
+
+			if (distanceA >= 0)
+				out[outCount++] = a;
+
+			if ((distanceA >= 0) == (distanceB >= 0))
+				continue;
+
+			// Interpolate from the inside vertex, so an edge shared by two triangles is cut at the same point for both
+			const ClipVertex& from = (distanceA >= 0) ? a : b;
+			const ClipVertex& to = (distanceA >= 0) ? b : a;
+			const float distanceFrom = (distanceA >= 0) ? distanceA : distanceB;
+			const float distanceTo = (distanceA >= 0) ? distanceB : distanceA;
+
+			const float t = distanceFrom / (distanceFrom - distanceTo);
+
+			ClipVertex& v = out[outCount++];
+
+			v.x = from.x + (to.x - from.x) * t;
+			v.y = from.y + (to.y - from.y) * t;
+			v.z = from.z + (to.z - from.z) * t;
+			v.w = from.w + (to.w - from.w) * t;
+
+			for (int j = 0; j < attributeCount; ++j)
+				v.attributes[j] = from.attributes[j] + (to.attributes[j] - from.attributes[j]) * t;
+
+			// Put vertices cut by the depth planes exactly on them, rather than a rounding error past
+			if (plane == OUTSIDE_NEAR)
+				v.z = (_reversedDepth ? v.w : 0);
+			else if (plane == OUTSIDE_FAR)
+				v.z = (_reversedDepth ? 0 : v.w);
+		}
+
+		return outCount;
+	}
+
+	/*
+	 * Returns how far inside of a plane a vertex is, negative if it's outside
+	 */
+	float Clipper::getDistance(const ClipVertex& v, int plane) const
+	{
+		switch (plane)
+		{
+		case OUTSIDE_NEAR:
+			return (_reversedDepth ? v.w - v.z : v.z);
+		case OUTSIDE_FAR:
+			return (_reversedDepth ? v.z : v.w - v.z);
+		case OUTSIDE_GUARD_LEFT:
+			return v.x + _guardX * v.w;
+		case OUTSIDE_GUARD_RIGHT:
+			return _guardX * v.w - v.x;
+		case OUTSIDE_GUARD_BOTTOM:
+			return v.y + _guardY * v.w;
+		case OUTSIDE_GUARD_TOP:
+		default:
+			return _guardY * v.w - v.y;
+		}
+	}
+}
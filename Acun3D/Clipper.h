@@ -0,0 +1,83 @@
+#ifndef __CLIPPER_H__
+#define __CLIPPER_H__
+
+#include "Vertex.h"
+
+namespace a3d
+{
+	/*
+	 * A vertex of a polygon being clipped: its clip-space position, the values interpolated
+	 * along with it, and once the polygon is clipped, where it lands on the screen
+	 */
+	struct ClipVertex
+	{
+		// Most values a vertex can carry
+		static const int MAX_ATTRIBUTES = 9;
+
+		// Clip-space position
+		float x, y, z, w;
+
+		float attributes[MAX_ATTRIBUTES];
+
+		// Screen position and depth, set by clipTriangle
+		float screenX, screenY, screenZ;
+	};
+
+	/*
+	 * Clips triangles in homogeneous space against the near and far planes and a guard band
+	 * around the screen, so that the rasteriser never sees a vertex behind the camera or so far
+	 * off screen that its fixed-point edge functions overflow
+	 * The guard band is wide enough that nearly all triangles crossing the edge of the screen
+	 * are left to the rasteriser's bounding box instead
+	 */
+	class Clipper
+	{
+	public:
+		// Bits of an outcode, for each plane a vertex is outside of
+		static const int OUTSIDE_NEAR = 1;
+		static const int OUTSIDE_FAR = 2;
+		static const int OUTSIDE_LEFT = 4;
+		static const int OUTSIDE_RIGHT = 8;
+		static const int OUTSIDE_BOTTOM = 16;
+		static const int OUTSIDE_TOP = 32;
+		static const int OUTSIDE_GUARD_LEFT = 64;
+		static const int OUTSIDE_GUARD_RIGHT = 128;
+		static const int OUTSIDE_GUARD_BOTTOM = 256;
+		static const int OUTSIDE_GUARD_TOP = 512;
+
+		// Planes triangles are clipped against, the edges of the screen only ever reject them
+		static const int CLIP_PLANES = OUTSIDE_NEAR | OUTSIDE_FAR |
+			OUTSIDE_GUARD_LEFT | OUTSIDE_GUARD_RIGHT | OUTSIDE_GUARD_BOTTOM | OUTSIDE_GUARD_TOP;
+
+		// Most vertices a clipped triangle can have, one more for each plane it's clipped against
+		static const int MAX_VERTICES = 3 + 6;
+
+		Clipper();
+
+		void setViewport(int width, int height, int guardBandX, int guardBandY);
+		void setReversedDepth(bool reversed);
+
+		int getOutcode(const Vertex& position) const;
+
+		static void setPosition(ClipVertex& v, const Vertex& position);
+
+		int clipTriangle(ClipVertex* polygon, int attributeCount, int outcode) const;
+
+	private:
+		int clipPolygon(const ClipVertex* in, int count, ClipVertex* out, int attributeCount, int plane) const;
+		float getDistance(const ClipVertex& v, int plane) const;
+
+		float _width;
+		float _height;
+
+		// Extents of the guard band in normalised device coordinates, where the screen spans -0.5 to 0.5,
+		// less than 0.5 along a side whose middle is all that can be drawn
+		float _guardX;
+		float _guardY;
+
+		// Whether clip-space depth runs from w at the near plane to 0 at the far plane, rather than 0 to w
+		bool _reversedDepth;
+	};
+}
+
+#endif
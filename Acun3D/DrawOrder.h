@@ -0,0 +1,22 @@
+#ifndef __DRAWORDER_H__
+#define __DRAWORDER_H__
+
+namespace a3d
+{
+	namespace DrawOrders
+	{
+		enum DrawOrder
+		{
+			// Models are drawn as soon as they're given
+			IMMEDIATE,
+
+			// Models are queued until endScene and drawn nearest first, with the triangles
+			// of big models roughly nearest first too
+			FRONT_TO_BACK
+		};
+	}
+
+	typedef DrawOrders::DrawOrder DrawOrder;
+}
+
+#endif
@@ -0,0 +1,467 @@
+#ifndef __DRAWSTAGES_H__
+#define __DRAWSTAGES_H__
+
+#include <vector>
+
+#include "Clipper.h"
+#include "Colour.h"
+#include "CullingType.h"
+#include "LightList.h"
+#include "LightingAccuracy.h"
+#include "MD2_Model.h"
+#include "Programs.h"
+#include "Rasteriser.h"
+#include "Triangle.h"
+#include "Vector.h"
+#include "Vertex.h"
+
+namespace a3d
+{
+	/*
+	 * The material and shading stages Renderer::drawTriangles is put together from, one copy of it for each pair
+	 * Each stage works out the values its vertices carry, shading's first and then the material's, which are
+	 * clipped along with them and handed to the Rasteriser::drawTriangle taking that pair's values
+	 * Everything a stage asks of a draw is decided here at compile time, rather than branched on per triangle
+	 */
+	namespace DrawStages
+	{
+		/*
+		 * What a draw's stages are made from
+		 */
+		struct DrawInputs
+		{
+			const md2::MD2_Model* model;
+
+			// View-space lights, and the light drawing without shading lights everything with
+			std::vector<Light*>* lights;
+			std::vector<Light*>* fullBright;
+
+			// The view-space lights compiled for per-pixel lighting
+			const LightList* lightList;
+
+			LightingAccuracy lightingAccuracy;
+			CullingType cullingType;
+
+			// The program set for the draw, if any (see Programs.h)
+			const ProgramBinding* program;
+		};
+
+		/*
+		 * Lines around each triangle's edges, in either winding that isn't culled
+		 */
+		struct WireframeMaterial
+		{
+			static const int ATTRIBUTES = 0;
+
+			// Colour of the lines
+			static const int COLOUR = 0x00FF00FF;
+
+			CullingType cullingType;
+
+			WireframeMaterial(const DrawInputs& inputs)
+				: cullingType(inputs.cullingType)
+			{
+
+			}
+
+			/*
+			 * Returns whether a triangle facing the camera by cos is culled
+			 */
+			bool isCulled(float cos) const
+			{
+				return (cos < 0 && cullingType == CullingTypes::BACK) || (cos > 0 && cullingType == CullingTypes::FRONT);
+			}
+
+			void getAttributes(const Triangle&, int, const Vertex&, float*) const
+			{
+
+			}
+		};
+
+		/*
+		 * Filled triangles facing the camera
+		 */
+		struct SolidMaterial
+		{
+			static const int ATTRIBUTES = 0;
+
+			SolidMaterial(const DrawInputs&)
+			{
+
+			}
+
+			bool isCulled(float cos) const
+			{
+				return cos < 0;
+			}
+
+			void getAttributes(const Triangle&, int, const Vertex&, float*) const
+			{
+
+			}
+		};
+
+		/*
+		 * Filled triangles facing the camera, textured with the model's textures
+		 * Vertices carry U, V and camera-space z, so that U/z, V/z and 1/z can be worked out once clipped
+		 */
+		struct TexturedMaterial : public SolidMaterial
+		{
+			static const int ATTRIBUTES = 3;
+
+			const UV* uvs;
+			unsigned int textureCount;
+			const Image* textures;
+
+			TexturedMaterial(const DrawInputs& inputs)
+				: SolidMaterial(inputs), uvs(inputs.model->getUVs()), textureCount(inputs.model->getTextureCount()),
+				textures(inputs.model->getTextures())
+			{
+
+			}
+
+			void getAttributes(const Triangle& triangle, int corner, const Vertex& cam, float* attributes) const
+			{
+				const UV& uv = uvs[corner == 0 ? triangle.AT : (corner == 1 ? triangle.BT : triangle.CT)];
+
+				attributes[0] = uv.U;
+				attributes[1] = uv.V;
+				attributes[2] = cam.getZ();
+			}
+		};
+
+		/*
+		 * The same colour everywhere, lit only by the full-bright light
+		 */
+		struct UnlitShading
+		{
+			static const int ATTRIBUTES = 0;
+
+			// Whether setVertex is wanted for each vertex
+			static const bool VERTEX_NORMALS = false;
+
+			// Whether the rasteriser lights each pixel with the draw's light list
+			static const bool PER_PIXEL_LIGHTING = false;
+
+			Colour colour;
+
+			UnlitShading(const DrawInputs& inputs)
+			{
+				Vector origin(0, 0, 0);
+
+				colour = md2::MD2_Model::calculateLights(origin, origin, *inputs.fullBright, inputs.lightingAccuracy);
+				colour.clamp(255.0f);
+			}
+
+			void setVertex(int, Vertex&, const Vector&)
+			{
+
+			}
+
+			/*
+			 * Gets ready to draw a triangle, given its camera-space face normal and first vertex
+			 */
+			void setTriangle(Vector&, Vertex&)
+			{
+
+			}
+
+			void getAttributes(int, const Vertex&, float*) const
+			{
+
+			}
+
+			/*
+			 * Fixes up the values of a vertex made by clipping
+			 */
+			void setClipped(float*) const
+			{
+
+			}
+		};
+
+		/*
+		 * One colour for each triangle, lit at its first vertex by its face normal
+		 */
+		struct FlatShading : public UnlitShading
+		{
+			std::vector<Light*>* lights;
+			LightingAccuracy lightingAccuracy;
+
+			FlatShading(const DrawInputs& inputs)
+				: UnlitShading(inputs), lights(inputs.lights), lightingAccuracy(inputs.lightingAccuracy)
+			{
+
+			}
+
+			void setTriangle(Vector& normal, Vertex& cam)
+			{
+				normal.normalise();
+
+				colour = md2::MD2_Model::calculateLights(cam, normal, *lights, lightingAccuracy);
+				colour.clamp(255.0f);
+			}
+		};
+
+		/*
+		 * Colours lit at each vertex and blended across triangles
+		 * Each vertex is lit once per draw, however many triangles share it
+		 */
+		struct SmoothShading : public UnlitShading
+		{
+			static const int ATTRIBUTES = 3;
+			static const bool VERTEX_NORMALS = true;
+
+			std::vector<Light*>* lights;
+			LightingAccuracy lightingAccuracy;
+
+			// Colour of each vertex
+			std::vector<Colour> colours;
+
+			SmoothShading(const DrawInputs& inputs)
+				: UnlitShading(inputs), lights(inputs.lights), lightingAccuracy(inputs.lightingAccuracy),
+				colours(inputs.model->getVertexCount())
+			{
+
+			}
+
+			/*
+			 * Lights a vertex, given its camera-space position and normal
+			 */
+			void setVertex(int vertex, Vertex& cam, const Vector& normal)
+			{
+				Vector normalised = normal.getNormalised();
+
+				colours[vertex] = md2::MD2_Model::calculateLights(cam, normalised, *lights, lightingAccuracy);
+			}
+
+			void getAttributes(int vertex, const Vertex&, float* attributes) const
+			{
+				attributes[0] = colours[vertex]._r;
+				attributes[1] = colours[vertex]._g;
+				attributes[2] = colours[vertex]._b;
+			}
+		};
+
+		/*
+		 * Lighting worked out at each pixel by the rasteriser from the light list, given camera-space positions
+		 * and normals blended across triangles
+		 */
+		struct PhongShading : public UnlitShading
+		{
+			static const int ATTRIBUTES = 6;
+			static const bool VERTEX_NORMALS = true;
+			static const bool PER_PIXEL_LIGHTING = true;
+
+			const LightList* lightList;
+
+			// Normalised camera-space normal of each vertex
+			std::vector<Vector> normals;
+
+			PhongShading(const DrawInputs& inputs)
+				: UnlitShading(inputs), lightList(inputs.lightList), normals(inputs.model->getVertexCount())
+			{
+
+			}
+
+			void setVertex(int vertex, Vertex&, const Vector& normal)
+			{
+				normals[vertex] = normal.getNormalised();
+			}
+
+			void getAttributes(int vertex, const Vertex& cam, float* attributes) const
+			{
+				attributes[0] = cam.getX();
+				attributes[1] = cam.getY();
+				attributes[2] = cam.getZ();
+				attributes[3] = normals[vertex].getX();
+				attributes[4] = normals[vertex].getY();
+				attributes[5] = normals[vertex].getZ();
+			}
+
+			/*
+			 * Normals blended by clipping are normalised again
+			 */
+			void setClipped(float* attributes) const
+			{
+				const Vector normal = Vector(attributes[3], attributes[4], attributes[5]).getNormalised();
+
+				attributes[3] = normal.getX();
+				attributes[4] = normal.getY();
+				attributes[5] = normal.getZ();
+			}
+		};
+
+		/*
+		 * A program's stages: its vertex stage run on each vertex, lit as smooth shading lights it, and its
+		 * fragment stage run by the rasteriser on the values it gives
+		 * Programs can be of your own, so each vertex carries as many values as any program gives, of which
+		 * the rasteriser is handed the program's own
+		 */
+		struct ProgramShading : public UnlitShading
+		{
+			static const int ATTRIBUTES = MAX_PROGRAM_VARYINGS;
+			static const bool VERTEX_NORMALS = true;
+
+			static_assert(ATTRIBUTES + TexturedMaterial::ATTRIBUTES <= ClipVertex::MAX_ATTRIBUTES,
+						"A textured program's vertices carry more values than ClipVertex holds");
+
+			std::vector<Light*>* lights;
+			LightingAccuracy lightingAccuracy;
+
+			ProgramBinding binding;
+
+			// ATTRIBUTES values for each vertex, those the program doesn't give left 0
+			std::vector<float> varyings;
+
+			ProgramShading(const DrawInputs& inputs)
+				: UnlitShading(inputs), lights(inputs.lights), lightingAccuracy(inputs.lightingAccuracy),
+				binding(*inputs.program), varyings(inputs.model->getVertexCount() * ATTRIBUTES)
+			{
+
+			}
+
+			void setVertex(int vertex, Vertex& cam, const Vector& normal)
+			{
+				ProgramVertex in;
+				in.position = cam;
+				in.normal = normal.getNormalised();
+				in.colour = md2::MD2_Model::calculateLights(in.position, in.normal, *lights, lightingAccuracy);
+
+				binding.vertex(binding.program, in, &varyings[vertex * ATTRIBUTES]);
+			}
+
+			void getAttributes(int vertex, const Vertex&, float* attributes) const
+			{
+				for (int i = 0; i < ATTRIBUTES; ++i)
+					attributes[i] = varyings[vertex * ATTRIBUTES + i];
+			}
+		};
+
+		/*
+		 * Draws a triangle of clipped vertices with a material and shading
+		 */
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const SolidMaterial&, const UnlitShading& shading)
+		{
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, shading.colour,
+									b.screenX, b.screenY, b.screenZ, shading.colour,
+									c.screenX, c.screenY, c.screenZ, shading.colour);
+		}
+
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const SolidMaterial&, const SmoothShading&)
+		{
+			const float* p = a.attributes;
+			const float* q = b.attributes;
+			const float* r = c.attributes;
+
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, Colour(p[0], p[1], p[2]),
+									b.screenX, b.screenY, b.screenZ, Colour(q[0], q[1], q[2]),
+									c.screenX, c.screenY, c.screenZ, Colour(r[0], r[1], r[2]));
+		}
+
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const SolidMaterial&, const PhongShading& shading)
+		{
+			const float* p = a.attributes;
+			const float* q = b.attributes;
+			const float* r = c.attributes;
+
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, Vertex(p[0], p[1], p[2]), Vector(p[3], p[4], p[5]),
+									b.screenX, b.screenY, b.screenZ, Vertex(q[0], q[1], q[2]), Vector(q[3], q[4], q[5]),
+									c.screenX, c.screenY, c.screenZ, Vertex(r[0], r[1], r[2]), Vector(r[3], r[4], r[5]),
+									*shading.lightList);
+		}
+
+		// Texture coordinates follow the shading's values, and are passed as U/z, V/z and 1/z
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const TexturedMaterial& material, const UnlitShading& shading)
+		{
+			const float* p = a.attributes;
+			const float* q = b.attributes;
+			const float* r = c.attributes;
+
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, p[0] / p[2], p[1] / p[2], 1 / p[2], shading.colour,
+									b.screenX, b.screenY, b.screenZ, q[0] / q[2], q[1] / q[2], 1 / q[2], shading.colour,
+									c.screenX, c.screenY, c.screenZ, r[0] / r[2], r[1] / r[2], 1 / r[2], shading.colour,
+									material.textureCount, material.textures);
+		}
+
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const TexturedMaterial& material, const SmoothShading&)
+		{
+			const float* p = a.attributes;
+			const float* q = b.attributes;
+			const float* r = c.attributes;
+
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, p[3] / p[5], p[4] / p[5], 1 / p[5], Colour(p[0], p[1], p[2]),
+									b.screenX, b.screenY, b.screenZ, q[3] / q[5], q[4] / q[5], 1 / q[5], Colour(q[0], q[1], q[2]),
+									c.screenX, c.screenY, c.screenZ, r[3] / r[5], r[4] / r[5], 1 / r[5], Colour(r[0], r[1], r[2]),
+									material.textureCount, material.textures);
+		}
+
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const TexturedMaterial& material, const PhongShading& shading)
+		{
+			const float* p = a.attributes;
+			const float* q = b.attributes;
+			const float* r = c.attributes;
+
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, Vertex(p[0], p[1], p[2]), p[6] / p[8], p[7] / p[8], 1 / p[8], Vector(p[3], p[4], p[5]),
+									b.screenX, b.screenY, b.screenZ, Vertex(q[0], q[1], q[2]), q[6] / q[8], q[7] / q[8], 1 / q[8], Vector(q[3], q[4], q[5]),
+									c.screenX, c.screenY, c.screenZ, Vertex(r[0], r[1], r[2]), r[6] / r[8], r[7] / r[8], 1 / r[8], Vector(r[3], r[4], r[5]),
+									material.textureCount, material.textures, *shading.lightList);
+		}
+
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const SolidMaterial&, const ProgramShading& shading)
+		{
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, a.attributes,
+									b.screenX, b.screenY, b.screenZ, b.attributes,
+									c.screenX, c.screenY, c.screenZ, c.attributes, shading.binding);
+		}
+
+		inline void drawTriangle(Rasteriser& rasteriser, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c,
+									const TexturedMaterial& material, const ProgramShading& shading)
+		{
+			const int first = ProgramShading::ATTRIBUTES;
+
+			const float* p = a.attributes + first;
+			const float* q = b.attributes + first;
+			const float* r = c.attributes + first;
+
+			rasteriser.drawTriangle(a.screenX, a.screenY, a.screenZ, a.attributes, p[0] / p[2], p[1] / p[2], 1 / p[2],
+									b.screenX, b.screenY, b.screenZ, b.attributes, q[0] / q[2], q[1] / q[2], 1 / q[2],
+									c.screenX, c.screenY, c.screenZ, c.attributes, r[0] / r[2], r[1] / r[2], 1 / r[2],
+									material.textureCount, material.textures, shading.binding);
+		}
+
+		/*
+		 * Draws a polygon of clipped vertices as a fan of triangles
+		 */
+		template <class Material, class Shading>
+		void drawPolygon(Rasteriser& rasteriser, const ClipVertex* polygon, int count, const Material& material, const Shading& shading)
+		{
+			for (int i = 2; i < count; ++i)
+				drawTriangle(rasteriser, polygon[0], polygon[i - 1], polygon[i], material, shading);
+		}
+
+		/*
+		 * Outlines a polygon, rather than the triangles it would be drawn as
+		 */
+		template <class Shading>
+		void drawPolygon(Rasteriser& rasteriser, const ClipVertex* polygon, int count, const WireframeMaterial&, const Shading&)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				const ClipVertex& a = polygon[i];
+				const ClipVertex& b = polygon[(i + 1) % count];
+
+				rasteriser.drawLine(int(a.screenX), int(a.screenY), int(b.screenX), int(b.screenY), WireframeMaterial::COLOUR);
+			}
+		}
+	}
+}
+
+#endif
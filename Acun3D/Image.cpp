@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "Image.h"
+#include "ThreadPool.h"
 
 namespace a3d
 {
@@ -7,39 +10,793 @@ namespace a3d
 		_data = 0;
 		_width = 0;
 		_height = 0;
+		_levelCount = 0;
+		_format = TextureFormats::BGRA8;
+		_packed = 0;
+		_paletteSize = 0;
+
+		std::fill_n(_layouts, TEXTURE_LAYOUT_COUNT, (int*)0);
 	}
 
-	Image::Image(const char* filename)
+	Image::Image(const char* filename, ThreadPool* pool, TextureLayout layout, TextureQuality quality)
 	{
-		_data = loadImage(filename, &_width, &_height);
+		_data = 0;
+		_width = 0;
+		_height = 0;
+		_levelCount = 0;
+		_format = TextureFormats::BGRA8;
+		_packed = 0;
+		_paletteSize = 0;
+
+		std::fill_n(_layouts, TEXTURE_LAYOUT_COUNT, (int*)0);
+
+		load(filename, pool, layout, quality);
 	}
 
 	Image::~Image()
 	{
 		if (_data != 0)
 			delete[] _data;
+
+		if (_packed != 0)
+			delete[] _packed;
+
+		clearLayouts();
+	}
+
+	/*
+	 * Returns the pixels of a mipmap level, 0 being the full size image, or 0 if the image isn't BGRA8
+	 */
+	const int* Image::getData(int level) const
+	{
+		if (_data == 0)
+			return 0;
+
+		return _data + _levelOffsets[level];
+	}
+
+	int Image::getWidth(int level) const
+	{
+		return (level == 0 ? _width : _levelWidths[level]);
+	}
+
+	int Image::getHeight(int level) const
+	{
+		return (level == 0 ? _height : _levelHeights[level]);
+	}
+
+	/*
+	 * Returns how many mipmap levels the image has, including the full size image, or 0 if none is loaded
+	 */
+	int Image::getLevelCount() const
+	{
+		return _levelCount;
+	}
+
+	TextureFormat Image::getFormat() const
+	{
+		return _format;
+	}
+
+	/*
+	 * Returns the colours INDEXED8 texels index, or 0 for other formats
+	 */
+	const int* Image::getPalette() const
+	{
+		return (_format == TextureFormats::INDEXED8 ? _palette : 0);
+	}
+
+	int Image::getPaletteSize() const
+	{
+		return (_format == TextureFormats::INDEXED8 ? _paletteSize : 0);
+	}
+
+	/*
+	 * Returns how many ints a row of a mipmap level takes up in the image's format, rows of blocks for BC1,
+	 * each row starting on a whole int
+	 */
+	int Image::getPitch(int level) const
+	{
+		const int width = getWidth(level);
+
+		switch (_format)
+		{
+		case TextureFormats::INDEXED8:
+			return (width + 3) / 4;
+
+		case TextureFormats::RGB565:
+			return (width + 1) / 2;
+
+		case TextureFormats::BC1:
+			return (width + 3) / 4 * 2;
+
+		case TextureFormats::BGRA8:
+		default:
+			return width;
+		}
+	}
+
+	/*
+	 * Returns how many rows of a mipmap level getPitch counts, which for BC1 are rows of blocks
+	 */
+	int Image::getRowCount(int level) const
+	{
+		const int height = getHeight(level);
+
+		return (_format == TextureFormats::BC1 ? (height + 3) / 4 : height);
+	}
+
+	/*
+	 * Returns the texels of a mipmap level in a layout, or 0 if they haven't been copied into it
+	 */
+	const int* Image::getTexels(TextureLayout layout, int level) const
+	{
+		if (layout == TextureLayouts::LINEAR)
+		{
+			if (_packed != 0)
+				return _packed + _packedOffsets[level];
+
+			return getData(level);
+		}
+
+		if (_layouts[layout] == 0)
+			return 0;
+
+		return _layouts[layout] + _layoutOffsets[layout][level];
+	}
+
+	bool Image::hasLayout(TextureLayout layout) const
+	{
+		return (getTexels(layout) != 0);
+	}
+
+	/*
+	 * Copies a row of a mipmap level into a layout
+	 */
+	struct Image::LayoutJob
+		: public ThreadPool::Job
+	{
+		LayoutJob(Image& image, TextureLayout layout, int level)
+			: image(image), layout(layout), level(level)
+		{
+
+		}
+
+		virtual void execute(int index, int /* worker */)
+		{
+			image.copyRow(layout, level, index);
+		}
+
+		Image& image;
+		TextureLayout layout;
+		int level;
+	};
+
+	/*
+	 * Copies the levels into another layout for getTexels, if they haven't been already,
+	 * splitting the work between the workers of pool if one is given
+	 * Returns whether the image has the layout, which it can't if it isn't loaded, or is in a format other
+	 * than BGRA8 and the layout isn't LINEAR, as only BGRA8 texels are copied into other layouts
+	 */
+	bool Image::addLayout(TextureLayout layout, ThreadPool* pool)
+	{
+		if (hasLayout(layout))
+			return true;
+
+		if (_data == 0)
+			return false;
+
+		int size = 0;
+
+		for (int level = 0; level < _levelCount; ++level)
+		{
+			_layoutOffsets[layout][level] = size;
+			size += getTexelCount(layout, _levelWidths[level], _levelHeights[level]);
+		}
+
+		// What pads levels out to whole blocks is never read, but is cleared all the same
+		_layouts[layout] = new int[size];
+		std::fill_n(_layouts[layout], size, 0);
+
+		for (int level = 0; level < _levelCount; ++level)
+		{
+			if (pool != 0)
+			{
+				LayoutJob job(*this, layout, level);
+				pool->run(job, _levelHeights[level]);
+			}
+			else
+			{
+				for (int y = 0; y < _levelHeights[level]; ++y)
+					copyRow(layout, level, y);
+			}
+		}
+
+		return true;
+	}
+
+	void Image::clearLayouts()
+	{
+		for (int i = 0; i < TEXTURE_LAYOUT_COUNT; ++i)
+		{
+			if (_layouts[i] != 0)
+				delete[] _layouts[i];
+
+			_layouts[i] = 0;
+		}
+	}
+
+	/*
+	 * Loads an image and builds its mipmaps, then keeps them in the format quality picks, and copies them
+	 * into layout if it isn't LINEAR and the format is BGRA8,
+	 * splitting the work between the workers of pool if one is given
+	 * Returns whether the image loaded, so whether it has layout as well is left to hasLayout, which it
+	 * won't for one other than LINEAR if quality packs it (see addLayout)
+	 */
+	bool Image::load(const char* filename, ThreadPool* pool, TextureLayout layout, TextureQuality quality)
+	{
+		if (_data != 0)
+			delete[] _data;
+
+		if (_packed != 0)
+			delete[] _packed;
+
+		clearLayouts();
+
+		_data = 0;
+		_packed = 0;
+		_format = TextureFormats::BGRA8;
+		_paletteSize = 0;
+		_levelCount = 0;
+
+		int* image = loadImage(filename, &_width, &_height);
+
+		if (image == 0)
+			return false;
+
+		// Lay the levels out one after another
+		int size = 0;
+		int width = _width;
+		int height = _height;
+
+		while (_levelCount < MAX_LEVELS)
+		{
+			_levelOffsets[_levelCount] = size;
+			_levelWidths[_levelCount] = width;
+			_levelHeights[_levelCount] = height;
+			_levelCount++;
+
+			size += width * height;
+
+			if (width == 1 && height == 1)
+				break;
+
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+
+		_data = new int[size];
+		std::copy(image, image + _width * _height, _data);
+
+		delete[] image;
+
+		generateMipmaps(pool);
+
+		const TextureFormat format = chooseFormat(quality);
+
+		if (format != TextureFormats::BGRA8)
+		{
+			encode(format, pool);
+
+			delete[] _data;
+			_data = 0;
+		}
+
+		addLayout(layout, pool);
+
+		return true;
+	}
+
+	/*
+	 * Returns the format quality allows for the image (see TextureQuality), building the palette for INDEXED8
+	 */
+	TextureFormat Image::chooseFormat(TextureQuality quality)
+	{
+		switch (quality)
+		{
+		case TextureQualities::HIGH:
+			return (buildPalette() ? TextureFormats::INDEXED8 : TextureFormats::BGRA8);
+
+		case TextureQualities::MEDIUM:
+			return (buildPalette() ? TextureFormats::INDEXED8 : TextureFormats::RGB565);
+
+		case TextureQualities::LOW:
+			return TextureFormats::BC1;
+
+		case TextureQualities::FULL:
+		default:
+			return TextureFormats::BGRA8;
+		}
+	}
+
+	/*
+	 * Collects the colours of the full size image into the palette, sorted, and returns whether there are
+	 * few enough of them for INDEXED8
+	 */
+	bool Image::buildPalette()
+	{
+		_paletteSize = 0;
+
+		const int count = _width * _height;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const int colour = _data[i];
+			int* end = _palette + _paletteSize;
+			int* position = std::lower_bound(_palette, end, colour);
+
+			if (position != end && *position == colour)
+				continue;
+
+			if (_paletteSize == 256)
+			{
+				_paletteSize = 0;
+				return false;
+			}
+
+			std::copy_backward(position, end, end + 1);
+			*position = colour;
+			_paletteSize++;
+		}
+
+		return (_paletteSize > 0);
+	}
+
+	/*
+	 * Returns the index of the palette's colour nearest colour, which mipmap levels, being averaged,
+	 * may not have exactly
+	 */
+	int Image::findColour(int colour) const
+	{
+		const int* end = _palette + _paletteSize;
+		const int* position = std::lower_bound(_palette, end, colour);
+
+		if (position != end && *position == colour)
+			return (int)(position - _palette);
+
+		int nearest = 0;
+		int nearestDistance = 0x7FFFFFFF;
+
+		for (int i = 0; i < _paletteSize; ++i)
+		{
+			int distance = 0;
+
+			for (int shift = 0; shift < 32; shift += 8)
+			{
+				const int difference = ((colour >> shift) & 0xFF) - ((_palette[i] >> shift) & 0xFF);
+				distance += difference * difference;
+			}
+
+			if (distance < nearestDistance)
+			{
+				nearest = i;
+				nearestDistance = distance;
+			}
+		}
+
+		return nearest;
+	}
+
+	/*
+	 * Encodes a row of a mipmap level, a row of blocks for BC1
+	 */
+	struct Image::EncodeJob
+		: public ThreadPool::Job
+	{
+		EncodeJob(Image& image, int level)
+			: image(image), level(level)
+		{
+
+		}
+
+		virtual void execute(int index, int /* worker */)
+		{
+			image.encodeRow(level, index);
+		}
+
+		Image& image;
+		int level;
+	};
+
+	/*
+	 * Encodes the levels into format, which getTexels then gives for LINEAR
+	 */
+	void Image::encode(TextureFormat format, ThreadPool* pool)
+	{
+		_format = format;
+
+		int size = 0;
+
+		for (int level = 0; level < _levelCount; ++level)
+		{
+			_packedOffsets[level] = size;
+			size += getPitch(level) * getRowCount(level);
+		}
+
+		// What pads rows out to whole ints is never read, but is cleared all the same
+		_packed = new int[size];
+		std::fill_n(_packed, size, 0);
+
+		for (int level = 0; level < _levelCount; ++level)
+		{
+			if (pool != 0)
+			{
+				EncodeJob job(*this, level);
+				pool->run(job, getRowCount(level));
+			}
+			else
+			{
+				for (int y = 0; y < getRowCount(level); ++y)
+					encodeRow(level, y);
+			}
+		}
+	}
+
+	/*
+	 * Encodes a row of a mipmap level from its BGRA8 texels, a row of blocks for BC1
+	 */
+	void Image::encodeRow(int level, int y)
+	{
+		const int width = _levelWidths[level];
+
+		const int* row = _data + _levelOffsets[level] + y * width;
+		int* packed = _packed + _packedOffsets[level] + y * getPitch(level);
+
+		switch (_format)
+		{
+		case TextureFormats::INDEXED8:
+			for (int x = 0; x < width; ++x)
+				packed[x >> 2] |= (int)((unsigned int)findColour(row[x]) << ((x & 3) * 8));
+			break;
+
+		case TextureFormats::RGB565:
+			for (int x = 0; x < width; ++x)
+				packed[x >> 1] |= (int)((unsigned int)packRGB565(row[x]) << ((x & 1) * 16));
+			break;
+
+		case TextureFormats::BC1:
+			for (int x = 0; x < (width + 3) / 4; ++x)
+				encodeBlock(level, x, y);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	/*
+	 * Encodes a 4x4 block of a mipmap level into BC1, repeating the last row and column of a level that
+	 * doesn't fill it
+	 * The endpoints span the block's colours along the channel that varies most, each other channel running
+	 * the same way or the opposite way as it tends to, and each texel picks the nearest of the four colours
+	 */
+	void Image::encodeBlock(int level, int blockX, int blockY)
+	{
+		const int width = _levelWidths[level];
+		const int height = _levelHeights[level];
+		const int* texels = _data + _levelOffsets[level];
+
+		int colours[16][3];
+		int low[3] = { 255, 255, 255 };
+		int high[3] = { 0, 0, 0 };
+		int sum[3] = { 0, 0, 0 };
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int x = std::min(blockX * 4 + (i & 3), width - 1);
+			const int y = std::min(blockY * 4 + (i >> 2), height - 1);
+			const int texel = texels[y * width + x];
+
+			for (int c = 0; c < 3; ++c)
+			{
+				colours[i][c] = (texel >> (c * 8)) & 0xFF;
+
+				low[c] = std::min(low[c], colours[i][c]);
+				high[c] = std::max(high[c], colours[i][c]);
+				sum[c] += colours[i][c];
+			}
+		}
+
+		int axis = 0;
+		for (int c = 1; c < 3; ++c)
+		{
+			if (high[c] - low[c] > high[axis] - low[axis])
+				axis = c;
+		}
+
+		// Channels that fall as the axis rises run from high to low
+		int first[3];
+		int second[3];
+
+		for (int c = 0; c < 3; ++c)
+		{
+			int covariance = 0;
+			for (int i = 0; i < 16; ++i)
+				covariance += (colours[i][c] * 16 - sum[c]) * (colours[i][axis] * 16 - sum[axis]);
+
+			first[c] = (covariance < 0 ? low[c] : high[c]);
+			second[c] = (covariance < 0 ? high[c] : low[c]);
+		}
+
+		int endpoints[2] =
+		{
+			packRGB565(first[0] | (first[1] << 8) | (first[2] << 16)),
+			packRGB565(second[0] | (second[1] << 8) | (second[2] << 16))
+		};
+
+		// BC1 decoders take the first endpoint being the smaller as its transparent mode, so it never is
+		if (endpoints[0] < endpoints[1])
+			std::swap(endpoints[0], endpoints[1]);
+
+		unsigned int selectors = 0;
+
+		if (endpoints[0] != endpoints[1])
+		{
+			// The four colours: the endpoints, then one and two thirds of the way from the first to the second
+			int palette[4][3];
+
+			for (int e = 0; e < 2; ++e)
+			{
+				const int colour = unpackRGB565(endpoints[e]);
+
+				for (int c = 0; c < 3; ++c)
+					palette[e][c] = (colour >> (c * 8)) & 0xFF;
+			}
+
+			for (int c = 0; c < 3; ++c)
+			{
+				palette[2][c] = (palette[0][c] * 2 + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + palette[1][c] * 2) / 3;
+			}
+
+			for (int i = 0; i < 16; ++i)
+			{
+				int nearest = 0;
+				int nearestDistance = 0x7FFFFFFF;
+
+				for (int p = 0; p < 4; ++p)
+				{
+					int distance = 0;
+
+					for (int c = 0; c < 3; ++c)
+					{
+						const int difference = colours[i][c] - palette[p][c];
+						distance += difference * difference;
+					}
+
+					if (distance < nearestDistance)
+					{
+						nearest = p;
+						nearestDistance = distance;
+					}
+				}
+
+				selectors |= (unsigned int)nearest << (i * 2);
+			}
+		}
+
+		int* block = _packed + _packedOffsets[level] + blockY * getPitch(level) + blockX * 2;
+
+		block[0] = (int)((unsigned int)endpoints[0] | ((unsigned int)endpoints[1] << 16));
+		block[1] = (int)selectors;
 	}
 
-	const int* Image::getData() const
+	/*
+	 * Box filters a row of a mipmap level from the level before it
+	 */
+	struct Image::MipmapJob
+		: public ThreadPool::Job
 	{
-		return _data;
+		MipmapJob(Image& image, int level)
+			: image(image), level(level)
+		{
+
+		}
+
+		virtual void execute(int index, int /* worker */)
+		{
+			image.downsampleRow(level, index);
+		}
+
+		Image& image;
+		int level;
+	};
+
+	/*
+	 * Builds each mipmap level from the one before it, a row at a time
+	 */
+	void Image::generateMipmaps(ThreadPool* pool)
+	{
+		for (int level = 1; level < _levelCount; ++level)
+		{
+			if (pool != 0)
+			{
+				MipmapJob job(*this, level);
+				pool->run(job, _levelHeights[level]);
+			}
+			else
+			{
+				for (int y = 0; y < _levelHeights[level]; ++y)
+					downsampleRow(level, y);
+			}
+		}
 	}
 
-	int Image::getWidth() const
+	/*
+	 * Averages each 2x2 block of the level before into a pixel of a row of a mipmap level
+	 * Where the level before is an odd size, its last row or column is left out, and where it's
+	 * 1 pixel across, that pixel is used twice
+	 */
+	void Image::downsampleRow(int level, int y)
 	{
-		return _width;
+		const int* source = _data + _levelOffsets[level - 1];
+		const int sourceWidth = _levelWidths[level - 1];
+		const int sourceHeight = _levelHeights[level - 1];
+
+		int* row = _data + _levelOffsets[level] + y * _levelWidths[level];
+
+		const int* top = source + std::min(y * 2, sourceHeight - 1) * sourceWidth;
+		const int* bottom = source + std::min(y * 2 + 1, sourceHeight - 1) * sourceWidth;
+
+		// Two channels are summed at once in each half of an int, with room for four of them
+		const unsigned int mask = 0x00FF00FF;
+		const unsigned int round = 0x00020002;
+
+		for (int x = 0; x < _levelWidths[level]; ++x)
+		{
+			const int left = std::min(x * 2, sourceWidth - 1);
+			const int right = std::min(x * 2 + 1, sourceWidth - 1);
+
+			const unsigned int a = top[left];
+			const unsigned int b = top[right];
+			const unsigned int c = bottom[left];
+			const unsigned int d = bottom[right];
+
+			const unsigned int rb = ((a & mask) + (b & mask) + (c & mask) + (d & mask) + round) >> 2;
+			const unsigned int ag = (((a >> 8) & mask) + ((b >> 8) & mask) + ((c >> 8) & mask) + ((d >> 8) & mask) + round) >> 2;
+
+			row[x] = (int)((rb & mask) | ((ag & mask) << 8));
+		}
 	}
 
-	int Image::getHeight() const
+	/*
+	 * Copies a row of a mipmap level into a layout
+	 */
+	void Image::copyRow(TextureLayout layout, int level, int y)
 	{
-		return _height;
+		const int width = _levelWidths[level];
+		const int height = _levelHeights[level];
+
+		const int* row = _data + _levelOffsets[level] + y * width;
+		int* texels = _layouts[layout] + _layoutOffsets[layout][level];
+
+		for (int x = 0; x < width; ++x)
+			texels[getTexelIndex(layout, x, y, width, height)] = row[x];
+	}
+
+	/*
+	 * Returns where texel (x, y) of a level width by height texels is in layout
+	 */
+	int Image::getTexelIndex(TextureLayout layout, int x, int y, int width, int height)
+	{
+		switch (layout)
+		{
+		case TextureLayouts::TILED:
+			{
+				const int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+				const int tile = (y / TILE_SIZE) * tilesX + x / TILE_SIZE;
+
+				return tile * TILE_SIZE * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+			}
+
+		case TextureLayouts::MORTON:
+			{
+				// Interleave the bits both coordinates have, and put the rest of the longer one's above them
+				const int bits = getMortonBits(width, height);
+				const int mask = (1 << bits) - 1;
+
+				const int square = (int)(spreadBits(x & mask) | (spreadBits(y & mask) << 1));
+
+				return square + (((x >> bits) + (y >> bits)) << (bits * 2));
+			}
+
+		case TextureLayouts::LINEAR:
+		default:
+			return y * width + x;
+		}
+	}
+
+	/*
+	 * Returns how many texels a level width by height texels takes up in layout, including any padding
+	 */
+	int Image::getTexelCount(TextureLayout layout, int width, int height)
+	{
+		switch (layout)
+		{
+		case TextureLayouts::TILED:
+			return ((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE * TILE_SIZE;
+
+		case TextureLayouts::MORTON:
+			{
+				// Padded out to powers of two
+				int paddedWidth = 1;
+				while (paddedWidth < width)
+					paddedWidth *= 2;
+
+				int paddedHeight = 1;
+				while (paddedHeight < height)
+					paddedHeight *= 2;
+
+				return paddedWidth * paddedHeight;
+			}
+
+		case TextureLayouts::LINEAR:
+		default:
+			return width * height;
+		}
+	}
+
+	/*
+	 * Returns how many bits of x and y are interleaved in a MORTON level width by height texels,
+	 * which is the log2 of the shorter side rounded up
+	 */
+	int Image::getMortonBits(int width, int height)
+	{
+		const int side = (width < height ? width : height);
+
+		int bits = 0;
+		while ((1 << bits) < side)
+			bits++;
+
+		return bits;
+	}
+
+	/*
+	 * Spreads the low 16 bits of value out to the even bits
+	 */
+	unsigned int Image::spreadBits(unsigned int value)
+	{
+		value &= 0x0000FFFF;
+		value = (value | (value << 8)) & 0x00FF00FF;
+		value = (value | (value << 4)) & 0x0F0F0F0F;
+		value = (value | (value << 2)) & 0x33333333;
+		value = (value | (value << 1)) & 0x55555555;
+
+		return value;
+	}
+
+	/*
+	 * Rounds a BGRA8 colour to RGB565
+	 */
+	int Image::packRGB565(int colour)
+	{
+		const int blue = (((colour & 0xFF) * 31 + 127) / 255);
+		const int green = ((((colour >> 8) & 0xFF) * 63 + 127) / 255);
+		const int red = ((((colour >> 16) & 0xFF) * 31 + 127) / 255);
+
+		return (red << 11) | (green << 5) | blue;
 	}
 
-	bool Image::load(const char* filename)
+	/*
+	 * Widens an RGB565 texel to an opaque BGRA8 colour, repeating each channel's top bits below it
+	 */
+	int Image::unpackRGB565(int texel)
 	{
-		_data = loadImage(filename, &_width, &_height);
+		const int red = (texel >> 11) & 31;
+		const int green = (texel >> 5) & 63;
+		const int blue = texel & 31;
 
-		return (_data != 0);
+		return (int)0xFF000000 | (((red << 3) | (red >> 2)) << 16) | (((green << 2) | (green >> 4)) << 8) | (blue << 3) | (blue >> 2);
 	}
 
 	int* Image::loadImage(const char* filename, int* width, int* height)
@@ -4,28 +4,109 @@
 #include <il.h>
 #include <string.h>
 
+#include "TextureLayout.h"
+#include "TextureFormat.h"
+#include "TextureQuality.h"
+
 namespace a3d
 {
+	class ThreadPool;
+
+	/*
+	 * A loaded image along with its mipmaps, each level half the size of the one before down to 1x1,
+	 * kept one after another after the full size image
+	 * The levels are always kept in rows for getData, and can be copied into other layouts for getTexels,
+	 * which are kept until the image is loaded again so that samplers reading them stay valid
+	 * An image loaded in a format other than BGRA8 keeps only the levels in that format, in rows, which
+	 * getTexels gives for LINEAR, and has no getData or other layouts
+	 */
 	class Image
 	{
 	public:
+		// Enough levels for an image 32768 pixels across
+		static const int MAX_LEVELS = 16;
+
+		// Width and height in texels of a block of a TILED layout
+		static const int TILE_SIZE = 4;
+
 		Image();
-		Image(const char* filename);
+		Image(const char* filename, ThreadPool* pool = 0, TextureLayout layout = TextureLayouts::LINEAR,
+				TextureQuality quality = TextureQualities::FULL);
 		~Image();
 
-		const int* getData() const;
-		int getWidth() const;
-		int getHeight() const;
+		const int* getData(int level = 0) const;
+		int getWidth(int level = 0) const;
+		int getHeight(int level = 0) const;
+		int getLevelCount() const;
+
+		TextureFormat getFormat() const;
+		const int* getPalette() const;
+		int getPaletteSize() const;
+		int getPitch(int level = 0) const;
 
-		bool load(const char* filename);
+		const int* getTexels(TextureLayout layout, int level = 0) const;
+		bool hasLayout(TextureLayout layout) const;
+		bool addLayout(TextureLayout layout, ThreadPool* pool = 0);
+
+		bool load(const char* filename, ThreadPool* pool = 0, TextureLayout layout = TextureLayouts::LINEAR,
+					TextureQuality quality = TextureQualities::FULL);
+
+		static int getTexelIndex(TextureLayout layout, int x, int y, int width, int height);
+		static int getTexelCount(TextureLayout layout, int width, int height);
+		static int getMortonBits(int width, int height);
+		static unsigned int spreadBits(unsigned int value);
+
+		static int packRGB565(int colour);
+		static int unpackRGB565(int texel);
 
 		static int* loadImage(const char* filename, int* width = 0, int* height = 0);
 
 	private:
+		struct MipmapJob;
+		friend struct MipmapJob;
+
+		struct LayoutJob;
+		friend struct LayoutJob;
+
+		struct EncodeJob;
+		friend struct EncodeJob;
+
+		void generateMipmaps(ThreadPool* pool);
+		void downsampleRow(int level, int y);
+		void copyRow(TextureLayout layout, int level, int y);
+		void clearLayouts();
+
+		TextureFormat chooseFormat(TextureQuality quality);
+		bool buildPalette();
+		int findColour(int colour) const;
+		void encode(TextureFormat format, ThreadPool* pool);
+		void encodeRow(int level, int y);
+		void encodeBlock(int level, int blockX, int blockY);
+		int getRowCount(int level) const;
+
 		int* _data;
 		int _width;
 		int _height;
 
+		int _levelCount;
+		int _levelOffsets[MAX_LEVELS];
+		int _levelWidths[MAX_LEVELS];
+		int _levelHeights[MAX_LEVELS];
+
+		// The levels in each layout they've been copied into, or 0, and where each level starts
+		// LINEAR is getData's
+		int* _layouts[TEXTURE_LAYOUT_COUNT];
+		int _layoutOffsets[TEXTURE_LAYOUT_COUNT][MAX_LEVELS];
+
+		// The levels in a format other than BGRA8, or 0, and where each level starts
+		TextureFormat _format;
+		int* _packed;
+		int _packedOffsets[MAX_LEVELS];
+
+		// INDEXED8's colours, sorted
+		int _palette[256];
+		int _paletteSize;
+
 		static bool _ilInitialised;
 	};
 }
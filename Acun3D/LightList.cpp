@@ -0,0 +1,427 @@
+#include "LightList.h"
+#include "LightingMath.h"
+#include "AmbientLight.h"
+#include "DirectionalLight.h"
+#include "PointLight.h"
+#include "Spotlight.h"
+
+namespace a3d
+{
+	/*
+	 * Empties the block
+	 */
+	void LightBlock::clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+		directionX.clear();
+		directionY.clear();
+		directionZ.clear();
+		cosFOV.clear();
+		exponent.clear();
+		r.clear();
+		g.clear();
+		b.clear();
+		inverseRangeSquared.clear();
+		boundsX.clear();
+		boundsY.clear();
+		boundsZ.clear();
+		boundsRadius.clear();
+	}
+
+	/*
+	 * Adds a copy of a light in another block of the same type
+	 */
+	void LightBlock::append(const LightBlock& block, int light)
+	{
+		x.push_back(block.x[light]);
+		y.push_back(block.y[light]);
+		z.push_back(block.z[light]);
+
+		// Only spotlights have directions, cones and exponents
+		if (!block.cosFOV.empty())
+		{
+			directionX.push_back(block.directionX[light]);
+			directionY.push_back(block.directionY[light]);
+			directionZ.push_back(block.directionZ[light]);
+			cosFOV.push_back(block.cosFOV[light]);
+			exponent.push_back(block.exponent[light]);
+		}
+
+		r.push_back(block.r[light]);
+		g.push_back(block.g[light]);
+		b.push_back(block.b[light]);
+
+		inverseRangeSquared.push_back(block.inverseRangeSquared[light]);
+		boundsX.push_back(block.boundsX[light]);
+		boundsY.push_back(block.boundsY[light]);
+		boundsZ.push_back(block.boundsZ[light]);
+		boundsRadius.push_back(block.boundsRadius[light]);
+	}
+
+	/*
+	 * Returns whether a light in a block can reach anything in the camera-space box from min to max, which
+	 * it can if it has no range or its bounding sphere touches the box
+	 */
+	bool reaches(const LightBlock& block, int light, const float* min, const float* max)
+	{
+		const float radius = block.boundsRadius[light];
+
+		if (radius <= 0)
+			return true;
+
+		const float centre[3] = { block.boundsX[light], block.boundsY[light], block.boundsZ[light] };
+
+		// Distance squared from the centre to the nearest point of the box
+		float distanceSquared = 0;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			float distance = 0;
+
+			if (centre[i] < min[i])
+				distance = min[i] - centre[i];
+			else if (centre[i] > max[i])
+				distance = centre[i] - max[i];
+
+			distanceSquared += distance * distance;
+		}
+
+		return distanceSquared <= radius * radius;
+	}
+
+	LightList::LightList()
+		: _accuracy(LightingAccuracies::EXACT), _shape(0)
+	{
+
+	}
+
+	/*
+	 * Replaces the list with lights, whose maths is to be done to accuracy
+	 */
+	void LightList::compile(const std::vector<Light*>& lights, LightingAccuracy accuracy)
+	{
+		_directional.clear();
+		_point.clear();
+		_spot.clear();
+
+		_accuracy = accuracy;
+		_ambient = Colour(0, 0, 0);
+
+		for (unsigned int i = 0; i < lights.size(); ++i)
+		{
+			const Light& light = *lights[i];
+
+			switch (light.getType())
+			{
+			case LightTypes::AMBIENT:
+				{
+					Colour colour = light.getColour();
+					colour *= ((const AmbientLight&)light).getIntesity();
+
+					_ambient += colour;
+				}
+				break;
+
+			case LightTypes::DIRECTIONAL:
+				{
+					Vector direction = ((const DirectionalLight&)light).getDirection();
+					LightingMath::normalise(direction, accuracy);
+
+					add(_directional, direction, light.getColour(), 0);
+				}
+				break;
+
+			case LightTypes::POINT:
+				{
+					const PointLight& pointLight = (const PointLight&)light;
+
+					add(_point, pointLight.getPosition(), light.getColour(), pointLight.getRange());
+				}
+				break;
+
+			case LightTypes::SPOT:
+				{
+					const Spotlight& spotlight = (const Spotlight&)light;
+
+					add(_spot, spotlight.getPosition(), light.getColour(), spotlight.getRange());
+
+					_spot.directionX.push_back(spotlight.getDirection().getX());
+					_spot.directionY.push_back(spotlight.getDirection().getY());
+					_spot.directionZ.push_back(spotlight.getDirection().getZ());
+					_spot.cosFOV.push_back(spotlight.getCosFOV());
+					_spot.exponent.push_back(spotlight.getExponent());
+
+					// The cone is lit out to the range, so a narrower sphere than the range's bounds it
+					// Its cosine is against the direction as given, which needn't be normalised
+					const float range = spotlight.getRange();
+					Vector direction = spotlight.getDirection();
+					const float cosAngle = spotlight.getCosFOV() / direction.length();
+
+					if (range > 0 && cosAngle > 0)
+					{
+						direction.normalise();
+
+						float offset;
+						float radius;
+
+						if (cosAngle > 0.70710678f)
+						{
+							// Under 45 degrees, the sphere through the apex and the circle the cone ends in
+							radius = range / (2.0f * cosAngle);
+							offset = radius;
+						}
+						else
+						{
+							// The sphere around the circle the cone ends in
+							radius = range * sqrt(1.0f - cosAngle * cosAngle);
+							offset = range * cosAngle;
+						}
+
+						_spot.boundsX.back() += direction.getX() * offset;
+						_spot.boundsY.back() += direction.getY() * offset;
+						_spot.boundsZ.back() += direction.getZ() * offset;
+						_spot.boundsRadius.back() = radius;
+					}
+				}
+				break;
+			}
+		}
+
+		updateShape();
+	}
+
+	/*
+	 * Replaces the list with the lights of another that can reach anything in the camera-space box from min to max,
+	 * leaving out the point lights and spotlights with a range that can't
+	 * Returns how many lights are left out
+	 */
+	int LightList::cull(const LightList& lights, const float* min, const float* max)
+	{
+		_accuracy = lights._accuracy;
+		_ambient = lights._ambient;
+		_directional = lights._directional;
+
+		_point.clear();
+		_spot.clear();
+
+		int culled = 0;
+
+		for (int i = 0; i < lights._point.getCount(); ++i)
+		{
+			if (reaches(lights._point, i, min, max))
+				_point.append(lights._point, i);
+			else
+				++culled;
+		}
+
+		for (int i = 0; i < lights._spot.getCount(); ++i)
+		{
+			if (reaches(lights._spot, i, min, max))
+				_spot.append(lights._spot, i);
+			else
+				++culled;
+		}
+
+		updateShape();
+
+		return culled;
+	}
+
+	/*
+	 * Adds a light to a block, bounded by a sphere of its range around its position if it has one
+	 */
+	void LightList::add(LightBlock& block, const Vector& position, const Colour& colour, float range)
+	{
+		block.x.push_back(position.getX());
+		block.y.push_back(position.getY());
+		block.z.push_back(position.getZ());
+
+		block.r.push_back(colour._r);
+		block.g.push_back(colour._g);
+		block.b.push_back(colour._b);
+
+		block.inverseRangeSquared.push_back(LightingMath::getInverseRangeSquared(range));
+		block.boundsX.push_back(position.getX());
+		block.boundsY.push_back(position.getY());
+		block.boundsZ.push_back(position.getZ());
+		block.boundsRadius.push_back(range > 0 ? range : 0);
+	}
+
+	/*
+	 * Works out which blocks have lights in them, and whether any of those lights has a range
+	 */
+	void LightList::updateShape()
+	{
+		_shape = 0;
+
+		if (_directional.getCount() > 0)
+			_shape |= DIRECTIONAL_LIGHTS;
+		if (_point.getCount() > 0)
+			_shape |= POINT_LIGHTS;
+		if (_spot.getCount() > 0)
+			_shape |= SPOTLIGHTS;
+
+		const LightBlock* blocks[] = { &_point, &_spot };
+
+		for (int i = 0; i < 2; ++i)
+		{
+			for (int j = 0; j < blocks[i]->getCount(); ++j)
+			{
+				if (blocks[i]->inverseRangeSquared[j] > 0)
+					_shape |= ATTENUATED;
+			}
+		}
+	}
+
+	LightingAccuracy LightList::getAccuracy() const
+	{
+		return _accuracy;
+	}
+
+	/*
+	 * Returns which blocks have lights in them, as DIRECTIONAL_LIGHTS, POINT_LIGHTS and SPOTLIGHTS bits, along with
+	 * ATTENUATED if any of them has a range
+	 */
+	int LightList::getShape() const
+	{
+		return _shape;
+	}
+
+	/*
+	 * Returns the sum of the ambient lights
+	 */
+	const Colour& LightList::getAmbient() const
+	{
+		return _ambient;
+	}
+
+	const LightBlock& LightList::getDirectionalLights() const
+	{
+		return _directional;
+	}
+
+	const LightBlock& LightList::getPointLights() const
+	{
+		return _point;
+	}
+
+	const LightBlock& LightList::getSpotlights() const
+	{
+		return _spot;
+	}
+
+	/*
+	 * Returns the colour the lights give a point from its camera-space position and normal,
+	 * as MD2_Model::calculateLights does
+	 */
+	Colour LightList::calculate(const Vector& position, const Vector& normal) const
+	{
+		Colour colour = _ambient;
+
+		Vector cameraDirection = position;
+		LightingMath::normalise(cameraDirection, _accuracy);
+
+		for (int i = 0; i < _directional.getCount(); ++i)
+		{
+			const Vector direction(_directional.x[i], _directional.y[i], _directional.z[i]);
+
+			addLight(colour, normal, cameraDirection, direction, 1.0f, _directional, i);
+		}
+
+		for (int i = 0; i < _point.getCount(); ++i)
+		{
+			Vector direction(position.getX() - _point.x[i], position.getY() - _point.y[i], position.getZ() - _point.z[i]);
+			const float attenuation = LightingMath::attenuate(direction.lengthSquared(), _point.inverseRangeSquared[i]);
+			LightingMath::normalise(direction, _accuracy);
+
+			addLight(colour, normal, cameraDirection, direction, attenuation, _point, i);
+		}
+
+		for (int i = 0; i < _spot.getCount(); ++i)
+		{
+			Vector direction(position.getX() - _spot.x[i], position.getY() - _spot.y[i], position.getZ() - _spot.z[i]);
+			const float attenuation = LightingMath::attenuate(direction.lengthSquared(), _spot.inverseRangeSquared[i]);
+			LightingMath::normalise(direction, _accuracy);
+
+			const float dot = direction.dot(Vector(_spot.directionX[i], _spot.directionY[i], _spot.directionZ[i]));
+
+			float spotFactor = 0;
+			if (dot >= _spot.cosFOV[i])
+				spotFactor = LightingMath::power(dot, _spot.exponent[i], _accuracy);
+
+			if (spotFactor < 0)
+				spotFactor = 0;
+
+			addLight(colour, normal, cameraDirection, direction, spotFactor * attenuation, _spot, i);
+		}
+
+		colour.clamp(1.0f);
+
+		return colour;
+	}
+
+	/*
+	 * Adds the diffuse and specular light of a light in a block to colour, given the direction from it to the point,
+	 * scaled by spotFactor, which includes how far a light with a range has faded
+	 */
+	void LightList::addLight(Colour& colour, const Vector& normal, const Vector& cameraDirection, const Vector& lightDirection,
+								float spotFactor, const LightBlock& block, int light) const
+	{
+		const float cosLightNormal = lightDirection.dot(normal);
+
+		const float diffuse = (cosLightNormal + 1.0f) / 2.0f;
+
+		Vector reflected = normal * (2.0f * cosLightNormal);
+		reflected = reflected - lightDirection;
+
+		float specular = reflected.dot(cameraDirection);
+		if (specular < 0)
+			specular = 0;
+		else
+			specular = LightingMath::power(specular, LightingMath::SPECULAR_EXPONENT, _accuracy);
+
+		const float total = ((specular * LightingMath::SPECULAR_COEFFICIENT)
+								+ (diffuse * LightingMath::DIFFUSE_COEFFICIENT)) * spotFactor;
+
+		colour += Colour(block.r[light] * total, block.g[light] * total, block.b[light] * total);
+	}
+
+	/*
+	 * Lists are equal if they light everything the same
+	 */
+	bool LightList::operator== (const LightList& other) const
+	{
+		const LightBlock* blocks[] = { &_directional, &_point, &_spot };
+		const LightBlock* otherBlocks[] = { &other._directional, &other._point, &other._spot };
+
+		if (_accuracy != other._accuracy || _ambient._r != other._ambient._r || _ambient._g != other._ambient._g
+			|| _ambient._b != other._ambient._b)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const LightBlock& a = *blocks[i];
+			const LightBlock& b = *otherBlocks[i];
+
+			if (a.x != b.x || a.y != b.y || a.z != b.z || a.directionX != b.directionX || a.directionY != b.directionY
+				|| a.directionZ != b.directionZ || a.cosFOV != b.cosFOV || a.exponent != b.exponent
+				|| a.r != b.r || a.g != b.g || a.b != b.b || a.inverseRangeSquared != b.inverseRangeSquared
+				|| a.boundsX != b.boundsX || a.boundsY != b.boundsY || a.boundsZ != b.boundsZ
+				|| a.boundsRadius != b.boundsRadius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool LightList::operator!= (const LightList& other) const
+	{
+		return !(*this == other);
+	}
+}
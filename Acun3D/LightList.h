@@ -0,0 +1,112 @@
+#ifndef __LIGHTLIST_H__
+#define __LIGHTLIST_H__
+
+#include <vector>
+
+#include "Light.h"
+#include "Colour.h"
+#include "Vector.h"
+#include "LightingAccuracy.h"
+
+namespace a3d
+{
+	/*
+	 * Lights of one type laid out an array to a value, so that a kernel can light a SIMD.h vector of pixels
+	 * against each in turn without looking at its type
+	 */
+	struct LightBlock
+	{
+		// Positions of point lights and spotlights, directions of directional lights
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+
+		// Directions of spotlights, the cosines of their cones and their exponents
+		std::vector<float> directionX;
+		std::vector<float> directionY;
+		std::vector<float> directionZ;
+		std::vector<float> cosFOV;
+		std::vector<float> exponent;
+
+		// Colours
+		std::vector<float> r;
+		std::vector<float> g;
+		std::vector<float> b;
+
+		// 1 / range squared of point lights and spotlights (see LightingMath::attenuate), 0 for those without a range
+		std::vector<float> inverseRangeSquared;
+
+		// A camera-space sphere around everything each light with a range reaches, or a radius of 0 for the rest
+		std::vector<float> boundsX;
+		std::vector<float> boundsY;
+		std::vector<float> boundsZ;
+		std::vector<float> boundsRadius;
+
+		int getCount() const
+		{
+			return (int)r.size();
+		}
+
+		void clear();
+		void append(const LightBlock& block, int light);
+	};
+
+	/*
+	 * The view-space lights of a draw compiled for per-pixel lighting, with their maths done to an accuracy
+	 * Ambient lights are summed into one colour and the rest are packed into a block for each type, with
+	 * directional lights' directions normalised up front
+	 * calculate lights a point at a time, and SpanKernel.h lights a SIMD.h vector of them, with a kernel built for
+	 * each accuracy and shape
+	 * Lights with a range fade out at it, so a list can be culled down to the lights reaching part of the view
+	 */
+	class LightList
+	{
+	public:
+		// Bits of a list's shape, for each block with lights in it
+		static const int DIRECTIONAL_LIGHTS = 1;
+		static const int POINT_LIGHTS = 2;
+		static const int SPOTLIGHTS = 4;
+
+		// Bit of a list's shape for a point light or spotlight with a range
+		static const int ATTENUATED = 8;
+
+		// Number of shapes a list can have
+		static const int SHAPE_COUNT = 16;
+
+		LightList();
+
+		void compile(const std::vector<Light*>& lights, LightingAccuracy accuracy);
+		int cull(const LightList& lights, const float* min, const float* max);
+
+		LightingAccuracy getAccuracy() const;
+		int getShape() const;
+
+		const Colour& getAmbient() const;
+		const LightBlock& getDirectionalLights() const;
+		const LightBlock& getPointLights() const;
+		const LightBlock& getSpotlights() const;
+
+		Colour calculate(const Vector& position, const Vector& normal) const;
+
+		bool operator== (const LightList& other) const;
+		bool operator!= (const LightList& other) const;
+
+	private:
+		void add(LightBlock& block, const Vector& position, const Colour& colour, float range);
+		void updateShape();
+		void addLight(Colour& colour, const Vector& normal, const Vector& cameraDirection, const Vector& lightDirection,
+						float spotFactor, const LightBlock& block, int light) const;
+
+		LightingAccuracy _accuracy;
+
+		// Which blocks have lights in them
+		int _shape;
+
+		Colour _ambient;
+		LightBlock _directional;
+		LightBlock _point;
+		LightBlock _spot;
+	};
+}
+
+#endif
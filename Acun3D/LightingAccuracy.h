@@ -0,0 +1,32 @@
+#ifndef __LIGHTINGACCURACY_H__
+#define __LIGHTINGACCURACY_H__
+
+namespace a3d
+{
+	namespace LightingAccuracies
+	{
+		// How closely lighting follows the standard library's maths (see LightingMath.h)
+		// The bounds are the largest difference from EXACT in any channel of a lit colour, out of 255, as
+		// TestProject's LightingAccuracyCheck.cpp measures them
+		enum LightingAccuracy
+		{
+			// pow and sqrt from the standard library, in doubles where it takes them
+			EXACT,
+
+			// Whole powers by repeated squaring and float square roots, within 1
+			FAST,
+
+			// As FAST, with reciprocal square roots estimated, from the float's bits or by the CPU, and refined,
+			// within 10 for spotlight exponents up to 64, as the specular and spotlight powers magnify the
+			// estimates' error, though a point right on the edge of a spotlight's cone may fall either side of it
+			APPROXIMATE
+		};
+	}
+
+	typedef LightingAccuracies::LightingAccuracy LightingAccuracy;
+
+	// Number of lighting accuracies
+	const int LIGHTING_ACCURACY_COUNT = LightingAccuracies::APPROXIMATE + 1;
+}
+
+#endif
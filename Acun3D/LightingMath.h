@@ -0,0 +1,137 @@
+#ifndef __LIGHTINGMATH_H__
+#define __LIGHTINGMATH_H__
+
+#include <math.h>
+#include <string.h>
+
+#include "LightingAccuracy.h"
+#include "Vector.h"
+
+namespace a3d
+{
+	namespace LightingMath
+	{
+		// Largest exponent taken as a whole power, beyond which pow is used
+		const int MAX_WHOLE_EXPONENT = 1024;
+
+		// Shininess of the specular highlight, and how much of a light its specular and diffuse terms give
+		const int SPECULAR_EXPONENT = 32;
+		const float SPECULAR_COEFFICIENT = 1.0f;
+		const float DIFFUSE_COEFFICIENT = 0.7f;
+
+		/*
+		 * Returns whether an exponent is taken as a whole power, rather than with pow, at accuracies other than EXACT
+		 */
+		inline bool isWholeExponent(int exponent)
+		{
+			return exponent >= 0;
+		}
+
+		inline bool isWholeExponent(float exponent)
+		{
+			return exponent >= 0 && exponent <= MAX_WHOLE_EXPONENT && exponent == (float)(int)exponent;
+		}
+
+		/*
+		 * Returns x to a whole power, squaring x for each bit of the exponent
+		 */
+		inline float powWhole(float x, unsigned int exponent)
+		{
+			float result = 1.0f;
+
+			while (exponent != 0)
+			{
+				if (exponent & 1)
+					result *= x;
+
+				x *= x;
+				exponent >>= 1;
+			}
+
+			return result;
+		}
+
+		/*
+		 * Returns x to a whole power, as the specular term takes it
+		 */
+		inline float power(float x, int exponent, LightingAccuracy accuracy)
+		{
+			if (accuracy == LightingAccuracies::EXACT || !isWholeExponent(exponent))
+				return (float)pow(x, exponent);
+
+			return powWhole(x, (unsigned int)exponent);
+		}
+
+		/*
+		 * Returns x to a power, as a spotlight's exponent takes it, which is a whole power where it can be
+		 */
+		inline float power(float x, float exponent, LightingAccuracy accuracy)
+		{
+			if (accuracy == LightingAccuracies::EXACT || !isWholeExponent(exponent))
+				return pow(x, exponent);
+
+			return powWhole(x, (unsigned int)exponent);
+		}
+
+		/*
+		 * Returns 1 / sqrt(x)
+		 * APPROXIMATE estimates it from the float's bits and takes a Newton-Raphson step tuned for the estimate,
+		 * which is within 0.066% (Moroz et al. 2018)
+		 */
+		inline float reciprocalSqrt(float x, LightingAccuracy accuracy)
+		{
+			if (accuracy != LightingAccuracies::APPROXIMATE)
+				return 1.0f / sqrt(x);
+
+			int bits;
+			memcpy(&bits, &x, sizeof(bits));
+
+			bits = 0x5F1FFFF9 - (bits >> 1);
+
+			float y;
+			memcpy(&y, &bits, sizeof(y));
+
+			return y * 0.703952253f * (2.38924456f - x * y * y);
+		}
+
+		/*
+		 * Returns how much of a light with a range reaches a point its distance squared away, given
+		 * 1 / range squared, or 1 for a light without a range, whose inverseRangeSquared is 0
+		 * The light falls off smoothly to nothing at its range, so leaving it out beyond that changes nothing
+		 */
+		inline float attenuate(float distanceSquared, float inverseRangeSquared)
+		{
+			const float falloff = 1.0f - distanceSquared * inverseRangeSquared;
+
+			return falloff > 0 ? falloff * falloff : 0;
+		}
+
+		/*
+		 * Returns 1 / range squared for attenuate, or 0 for a range of 0
+		 */
+		inline float getInverseRangeSquared(float range)
+		{
+			return range > 0 ? 1.0f / (range * range) : 0;
+		}
+
+		/*
+		 * Scales a vector to length 1, as Vector::normalise does for EXACT
+		 */
+		inline void normalise(Vector& v, LightingAccuracy accuracy)
+		{
+			if (accuracy == LightingAccuracies::EXACT)
+			{
+				v.normalise();
+				return;
+			}
+
+			const float scale = reciprocalSqrt(v.lengthSquared(), accuracy);
+
+			v.setX(v.getX() * scale);
+			v.setY(v.getY() * scale);
+			v.setZ(v.getZ() * scale);
+		}
+	}
+}
+
+#endif
@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "MD2_Model.h"
+#include "LightingMath.h"
 
 namespace a3d
 {
@@ -10,6 +13,8 @@ namespace a3d
 			_triangles = 0;
 
 			_uvs = 0;
+			_uvCount = 0;
+			_uvsInTexels = false;
 			_textures = 0;
 
 			_frameCount = 0;
@@ -18,6 +23,8 @@ namespace a3d
 			_textureId = 0;
 			_scale = 1.0f;
 
+			_boundsRadius = 0;
+
 			setAnimation();
 		}
 
@@ -36,7 +43,10 @@ namespace a3d
 				delete[] _textures;
 		}
 
-		bool MD2_Model::loadModel(const char* filename)
+		/*
+		 * Loads a model and its skins, which are kept in the format textureQuality picks (see Image::load)
+		 */
+		bool MD2_Model::loadModel(const char* filename, TextureQuality textureQuality)
 		{
 			std::ifstream in;
 			MD2_Header header;
@@ -80,7 +90,7 @@ namespace a3d
 					_textures = new Image[_skinCount];
 					for (int i = 0, j = 0; i < _skinCount; ++i, ++j)
 					{
-						bool success = _textures[i].load(textureNames[i]);
+						bool success = _textures[i].load(textureNames[i], 0, TextureLayouts::LINEAR, textureQuality);
 
 						if (!success)
 						{
@@ -108,20 +118,48 @@ namespace a3d
 					}
 				}
 
+				// Work out a bounding sphere around the box enclosing every frame
+				if (_vertexCount * _frameCount > 0)
+				{
+					a3d::Vector minimum = _vertices[0];
+					a3d::Vector maximum = _vertices[0];
+
+					for (int i = 1; i < _vertexCount * _frameCount; ++i)
+					{
+						for (int j = 0; j < 3; ++j)
+						{
+							minimum(j, 0) = std::min(minimum(j, 0), _vertices[i](j, 0));
+							maximum(j, 0) = std::max(maximum(j, 0), _vertices[i](j, 0));
+						}
+					}
+
+					_boundsCentre = (minimum + maximum) / 2.0f;
+					_boundsRadius = (maximum - _boundsCentre).length();
+				}
+
 				// Read texture coordinates
 				TextureCoords* textureCoords = new TextureCoords[header.texCoordCount];
 				in.seekg(header.texCoordOffset);
 				in.read((char*)textureCoords, header.texCoordCount * sizeof(TextureCoords));
 
-				// Store them to the model
+				// Store them to the model, normalised from texels of the skin to 0 .. 1 across it, taking the
+				// skin's size from the first skin if the header doesn't give it, or else from setTexture
 				if (header.texCoordCount > 0)
 				{
-					_uvs = new UV[header.texCoordCount];
-					for (int i = 0; i < header.texCoordCount; ++i)
+					_uvCount = header.texCoordCount;
+					_uvs = new UV[_uvCount];
+					for (int i = 0; i < _uvCount; ++i)
 					{
 						_uvs[i].U = textureCoords[i].s;
 						_uvs[i].V = textureCoords[i].t;
 					}
+
+					_uvsInTexels = true;
+
+					if (header.skinWidth > 0 && header.skinHeight > 0)
+						normaliseUVs(header.skinWidth, header.skinHeight);
+					else if (_skinCount > 0)
+						normaliseUVs(_textures[0].getWidth(), _textures[0].getHeight());
 				}
 
 				// Read triangles
@@ -180,13 +218,17 @@ namespace a3d
 			return true;
 		}
 		
-		Colour MD2_Model::calculateLights(a3d::Vector& position, a3d::Vector& normal, std::vector<Light*>& lights)
+		/*
+		 * Returns the colour the lights give a point, with its maths done to accuracy (see LightingMath.h)
+		 */
+		Colour MD2_Model::calculateLights(a3d::Vector& position, a3d::Vector& normal, std::vector<Light*>& lights,
+											LightingAccuracy accuracy)
 		{
 			Colour colour(0, 0, 0);
 
 			for (unsigned int i = 0; i < lights.size(); ++i)
 			{
-				colour += calculateLight(position, normal, *lights[i]);
+				colour += calculateLight(position, normal, *lights[i], accuracy);
 			}
 
 			colour.clamp(1.0f);
@@ -194,12 +236,8 @@ namespace a3d
 			return colour;
 		}
 
-		Colour MD2_Model::calculateLight(a3d::Vector& position, a3d::Vector& normal, Light& light)
+		Colour MD2_Model::calculateLight(a3d::Vector& position, a3d::Vector& normal, Light& light, LightingAccuracy accuracy)
 		{
-			static const int specularExponent = 32;
-			static const float specularCoefficient = 1.0f;
-			static const float diffuseCoefficient = 0.7f;
-
 			LightType type = light.getType();
 				a3d::Vector lightDirection(0, 0, 0);
 
@@ -221,17 +259,22 @@ namespace a3d
 
 				float total = 0;
 
+				// How much of a light with a range reaches the point
+				float attenuation = 1;
+
 				if (type == LightTypes::SPOT)
 				{
 					Spotlight& spotlight = (Spotlight&)light;
 
 					lightDirection = position - spotlight.getPosition();
-					lightDirection.normalise();
+					attenuation = LightingMath::attenuate(lightDirection.lengthSquared(),
+															LightingMath::getInverseRangeSquared(spotlight.getRange()));
+					LightingMath::normalise(lightDirection, accuracy);
 
 					dot = lightDirection.dot(spotlight.getDirection());
 
-					if (dot >= cos(spotlight.getFOV()))
-						spotFactor = pow(dot, spotlight.getExponent());
+					if (dot >= spotlight.getCosFOV())
+						spotFactor = LightingMath::power(dot, spotlight.getExponent(), accuracy);
 					else
 						spotFactor = 0;
 
@@ -246,17 +289,19 @@ namespace a3d
 				if (type == LightTypes::POINT)
 				{
 					lightDirection = position - ((PointLight&)light).getPosition();
-					lightDirection.normalise();
+					attenuation = LightingMath::attenuate(lightDirection.lengthSquared(),
+															LightingMath::getInverseRangeSquared(((PointLight&)light).getRange()));
+					LightingMath::normalise(lightDirection, accuracy);
 				}
 				else if (type == LightTypes::DIRECTIONAL)
 				{
 					lightDirection = ((DirectionalLight&)light).getDirection();
-					lightDirection.normalise();
+					LightingMath::normalise(lightDirection, accuracy);
 				}
 
 
 				a3d::Vector cameraDirection = position;
-				cameraDirection.normalise();
+				LightingMath::normalise(cameraDirection, accuracy);
 
 				float cosLightNormal = lightDirection.dot(normal);
 
@@ -269,12 +314,13 @@ namespace a3d
 				if (specular < 0)
 					specular = 0;
 				else
-					specular = (float)pow(specular, specularExponent);
+					specular = LightingMath::power(specular, LightingMath::SPECULAR_EXPONENT, accuracy);
 
-				total = (specular * specularCoefficient) + (diffuse * diffuseCoefficient);
+				total = (specular * LightingMath::SPECULAR_COEFFICIENT) + (diffuse * LightingMath::DIFFUSE_COEFFICIENT);
 		
-				// Take account of if it's a spot light
+				// Take account of if it's a spot light, and of how far a light with a range has faded
 				total *= spotFactor;
+				total *= attenuation;
 
 				// Take account of the colour of the light
 				lightColour *= total;
@@ -283,7 +329,7 @@ namespace a3d
 			}
 		}
 
-		void MD2_Model::setTexture(const char* filename)
+		void MD2_Model::setTexture(const char* filename, TextureQuality quality)
 		{
 			if (_skinCount == 0)
 			{
@@ -293,11 +339,49 @@ namespace a3d
 					delete _textures;
 
 				_textures = new Image[1];
-				bool success = _textures->load(filename);
+				bool success = _textures->load(filename, 0, TextureLayouts::LINEAR, quality);
 
 				if (!success)
 					_skinCount--;
+				else if (_uvsInTexels)
+					normaliseUVs(_textures->getWidth(), _textures->getHeight());
+			}
+		}
+
+		/*
+		 * Brings texture coordinates still in texels of the skin to 0 .. 1 across it, once a skin of
+		 * width x height texels gives its size
+		 */
+		void MD2_Model::normaliseUVs(int width, int height)
+		{
+			if (width <= 0 || height <= 0)
+				return;
+
+			const float scaleU = 1.0f / width;
+			const float scaleV = 1.0f / height;
+
+			for (int i = 0; i < _uvCount; ++i)
+			{
+				_uvs[i].U *= scaleU;
+				_uvs[i].V *= scaleV;
 			}
+
+			_uvsInTexels = false;
+		}
+
+		/*
+		 * Copies the model's textures into another layout, if they haven't been already (see Image::addLayout)
+		 * Returns whether every texture has the layout, which those loaded in a format other than BGRA8
+		 * don't unless it's LINEAR
+		 */
+		bool MD2_Model::addTextureLayout(TextureLayout layout)
+		{
+			bool success = true;
+
+			for (int i = 0; i < _skinCount; ++i)
+				success = _textures[i].addLayout(layout) && success;
+
+			return success;
 		}
 
 		void MD2_Model::processVertices(a3d::Vertex* vertexBuffer, long time)
@@ -421,6 +505,19 @@ namespace a3d
 			return _animation.curFrame;
 		}
 
+		/*
+		 * Returns the centre of a sphere enclosing every frame of the model, at its current scale
+		 */
+		a3d::Vector MD2_Model::getBoundsCentre() const
+		{
+			return _boundsCentre * _scale;
+		}
+
+		float MD2_Model::getBoundsRadius() const
+		{
+			return _boundsRadius * _scale;
+		}
+
 		a3d::Vector MD2_Model::standardNormals[] =
 		{
 			#include "MD2_Normals.h"
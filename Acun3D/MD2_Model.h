@@ -16,6 +16,7 @@
 #include "DirectionalLight.h"
 #include "AmbientLight.h"
 #include "Spotlight.h"
+#include "LightingAccuracy.h"
 
 namespace a3d
 {
@@ -27,11 +28,13 @@ namespace a3d
 			MD2_Model();
 			~MD2_Model();
 
-			bool loadModel(const char* filename);
+			bool loadModel(const char* filename, TextureQuality textureQuality = TextureQualities::FULL);
 
-			static Colour calculateLights(a3d::Vector& position, a3d::Vector& normal, std::vector<Light*>& lights);
+			static Colour calculateLights(a3d::Vector& position, a3d::Vector& normal, std::vector<Light*>& lights,
+											LightingAccuracy accuracy = LightingAccuracies::EXACT);
 
-			void setTexture(const char* filename);
+			void setTexture(const char* filename, TextureQuality quality = TextureQualities::FULL);
+			bool addTextureLayout(TextureLayout layout);
 
 			void processVertices(a3d::Vertex* vertexBuffer, long time);
 			const a3d::Triangle* getFaces() const;
@@ -47,14 +50,18 @@ namespace a3d
 			int getTriangleCount() const;
 			int getCurrentFrame() const;
 
+			a3d::Vector getBoundsCentre() const;
+			float getBoundsRadius() const;
+
 			static a3d::Vector standardNormals[];
 
 		private:
 			void animate(long time);
 			void interpolate(a3d::Vertex* vertexBuffer) const;
 			bool loadTexture(const char* filename);
+			void normaliseUVs(int width, int height);
 
-			static Colour calculateLight(a3d::Vector& position, a3d::Vector& normal, Light& light);
+			static Colour calculateLight(a3d::Vector& position, a3d::Vector& normal, Light& light, LightingAccuracy accuracy);
 			
 			int _skinCount;
 			int _frameCount;
@@ -65,11 +72,17 @@ namespace a3d
 			a3d::Vertex* _vertices;
 
 			UV* _uvs;
+			int _uvCount;
+			bool _uvsInTexels;
 			Image* _textures;
 
 			unsigned int _textureId;
 			AnimationState _animation;
 			float _scale;
+
+			// Bounding sphere of every frame, before scaling
+			a3d::Vector _boundsCentre;
+			float _boundsRadius;
 		};
 	}
 }
@@ -14,6 +14,9 @@ namespace a3d
 	}
 
 	typedef MaterialTypes::MaterialType MaterialType;
+
+	// Number of material types
+	const int MATERIAL_TYPE_COUNT = MaterialTypes::TEXTURED + 1;
 }
 
 #endif
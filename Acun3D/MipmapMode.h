@@ -0,0 +1,24 @@
+#ifndef __MIPMAPMODE_H__
+#define __MIPMAPMODE_H__
+
+namespace a3d
+{
+	namespace MipmapModes
+	{
+		enum MipmapMode
+		{
+			// Textures are always read from their full size image
+			NONE,
+
+			// Each triangle reads the mipmap level nearest its texels' size on screen at its centre
+			TRIANGLE,
+
+			// Each group of pixels the kernels shade together picks its own level, as a GPU does for a 2x2 quad
+			GROUP
+		};
+	}
+
+	typedef MipmapModes::MipmapMode MipmapMode;
+}
+
+#endif
@@ -2,8 +2,8 @@
 
 namespace a3d
 {
-	PointLight::PointLight(Vector position, Colour colour)
-		: Light(LightTypes::POINT, colour), _position(position)
+	PointLight::PointLight(Vector position, Colour colour, float range)
+		: Light(LightTypes::POINT, colour), _position(position), _range(range)
 	{
 
 	}
@@ -12,4 +12,12 @@ namespace a3d
 	{
 		return _position;
 	}
+
+	/*
+	 * Returns the distance the light fades out over (see LightingMath::attenuate), or 0 if it reaches everything
+	 */
+	float PointLight::getRange() const
+	{
+		return _range;
+	}
 }
\ No newline at end of file
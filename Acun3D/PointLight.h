@@ -9,12 +9,15 @@ namespace a3d
 		: public Light
 	{
 	public:
-		PointLight(Vector position, Colour colour);
+		PointLight(Vector position, Colour colour, float range = 0);
 		
 		const Vector& getPosition() const;
+		float getRange() const;
 
 		Vector _position;
 	private:
+		// Distance the light fades out over, or 0 for a light that reaches everything undimmed
+		float _range;
 	};
 }
 
@@ -0,0 +1,25 @@
+#ifndef __PROGRAMKERNELS_H__
+#define __PROGRAMKERNELS_H__
+
+// Builds the kernels of programs of your own (see Programs.h) for one path, so they're drawn with whichever path
+// the rasteriser takes, as the programs in Programs.h are
+// Each program needs a file of your own per path, set up for its instruction set as RasteriserScalar.cpp,
+// RasteriserSSE2.cpp, RasteriserAVX2.cpp, RasteriserAVX512.cpp and RasteriserNEON.cpp are, which includes this
+// and then the program, and specialises getProgramKernels (see ProgramType.h) for the program and that path:
+//
+//     template <>
+//     const ProgramKernelTable* getProgramKernels<MyProgram, RasterPaths::AVX2>()
+//     {
+//     #ifdef SIMD_AVX2
+//         return getProgramKernelTable<simd::avx2::float8, MyProgram>();
+//     #else
+//         return 0;
+//     #endif
+//     }
+//
+// The specialisations are declared alongside the program, so the file calling Renderer::setProgram with it
+// needs nothing more than the program's header
+
+#include "SpanKernel.h"
+
+#endif
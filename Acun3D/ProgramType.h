@@ -0,0 +1,136 @@
+#ifndef __PROGRAMTYPE_H__
+#define __PROGRAMTYPE_H__
+
+#include <type_traits>
+
+#include "Clipper.h"
+#include "RasterPath.h"
+
+namespace a3d
+{
+	struct ProgramVertex;
+	struct ProgramKernelTable;
+
+	/*
+	 * The programs in Programs.h, which each instruction set's kernels are built for, and CUSTOM for
+	 * programs of your own
+	 */
+	namespace ProgramTypes
+	{
+		enum ProgramType
+		{
+			// Lit colour multiplied by a tint
+			TINT,
+
+			// Lit colour faded into a fog colour with distance
+			FOG,
+
+			// Lit colour with light added around the silhouette
+			RIM_LIGHT,
+
+			// A program of your own, whose kernels are built by files of your own (see ProgramKernels.h)
+			CUSTOM
+		};
+	}
+
+	typedef ProgramTypes::ProgramType ProgramType;
+
+	// Number of program types each instruction set's kernels are built for
+	const int PROGRAM_TYPE_COUNT = ProgramTypes::RIM_LIGHT + 1;
+
+	// Most varyings a program's vertex stage can give, leaving room for a textured draw's u, v and z
+	const int MAX_PROGRAM_VARYINGS = ClipVertex::MAX_ATTRIBUTES - 3;
+
+	/*
+	 * The program each type in Programs.h is, which Programs.h fills in
+	 */
+	template <ProgramType TYPE>
+	struct RegisteredProgram
+	{
+		typedef void Program;
+	};
+
+	/*
+	 * Returns the kernels of a CUSTOM program for a path, built over its SIMD.h backend, or 0 if the compiler
+	 * can't build for it
+	 * Specialised for each path other than AUTO by a file of your own built for it (see ProgramKernels.h)
+	 */
+	template <class Program, RasterPath PATH>
+	const ProgramKernelTable* getProgramKernels();
+
+	/*
+	 * A program as the renderer and rasteriser draw with it: which one it is, how many varyings its vertex stage
+	 * gives each vertex, its values, which its stages read, its vertex stage, and for a CUSTOM program its kernels
+	 * for each path
+	 */
+	struct ProgramBinding
+	{
+		ProgramType type;
+		int varyings;
+
+		// The program, or 0 for none
+		const void* program;
+
+		void (*vertex)(const void* program, const ProgramVertex& in, float* varyings);
+
+		// Kernels of a CUSTOM program for each path, or 0 for one of the instruction sets' own
+		const ProgramKernelTable* kernels[RASTER_PATH_COUNT];
+
+		ProgramBinding()
+			: type(ProgramTypes::TINT), varyings(0), program(0), vertex(0)
+		{
+			for (int i = 0; i < RASTER_PATH_COUNT; ++i)
+				kernels[i] = 0;
+		}
+
+		template <class Program>
+		static ProgramBinding bind(const Program& program)
+		{
+			static_assert(Program::VARYINGS <= MAX_PROGRAM_VARYINGS, "A program gives at most MAX_PROGRAM_VARYINGS varyings");
+			static_assert(Program::TYPE == ProgramTypes::CUSTOM
+						|| std::is_same<typename RegisteredProgram<Program::TYPE>::Program, Program>::value,
+						"A program that isn't the one Programs.h registers for its TYPE has to be CUSTOM");
+
+			ProgramBinding binding;
+			binding.type = Program::TYPE;
+			binding.varyings = Program::VARYINGS;
+			binding.program = &program;
+			binding.vertex = &runVertex<Program>;
+			CustomKernels<Program, Program::TYPE == ProgramTypes::CUSTOM>::get(binding.kernels);
+
+			return binding;
+		}
+
+	private:
+		template <class Program>
+		static void runVertex(const void* program, const ProgramVertex& in, float* varyings)
+		{
+			static_cast<const Program*>(program)->vertex(in, varyings);
+		}
+
+		// Only CUSTOM programs have kernels of their own, so the others don't need getProgramKernels specialised
+		template <class Program, bool CUSTOM>
+		struct CustomKernels
+		{
+			static void get(const ProgramKernelTable**)
+			{
+
+			}
+		};
+
+		template <class Program>
+		struct CustomKernels<Program, true>
+		{
+			static void get(const ProgramKernelTable** kernels)
+			{
+				kernels[RasterPaths::SCALAR] = getProgramKernels<Program, RasterPaths::SCALAR>();
+				kernels[RasterPaths::SSE2] = getProgramKernels<Program, RasterPaths::SSE2>();
+				kernels[RasterPaths::AVX2] = getProgramKernels<Program, RasterPaths::AVX2>();
+				kernels[RasterPaths::AVX512] = getProgramKernels<Program, RasterPaths::AVX512>();
+				kernels[RasterPaths::NEON] = getProgramKernels<Program, RasterPaths::NEON>();
+			}
+		};
+	};
+}
+
+#endif
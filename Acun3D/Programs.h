@@ -0,0 +1,180 @@
+#ifndef __PROGRAMS_H__
+#define __PROGRAMS_H__
+
+// Programs draw what MaterialType and ShadingType can't, through Renderer::setProgram
+// A program has a vertex stage, run by the renderer for each vertex of a draw, which gives the vertex
+// VARYINGS values, and a fragment stage, run by the rasteriser's kernels for a SIMD.h vector of pixels
+// at a time with those values interpolated across the screen, which gives the pixels' colour
+// Each instruction set's file builds kernels for every program addPrograms lists, so a new program of the
+// library's is a type in ProgramTypes, a struct here, a RegisteredProgram for it and a line in addPrograms
+// A program of your own has TYPE ProgramTypes::CUSTOM instead, and files of your own build its kernels for each
+// instruction set through ProgramKernels.h
+// Fragment stages are built for those instruction sets, so they should use nothing but SIMD.h and the
+// program's own values
+
+#include <math.h>
+
+#include "ProgramType.h"
+#include "Colour.h"
+#include "Vector.h"
+
+namespace a3d
+{
+	/*
+	 * What a program's vertex stage is given for a vertex: its camera-space position and normal, which
+	 * is normalised, and its colour lit by the draw's lights as smooth shading lights it
+	 */
+	struct ProgramVertex
+	{
+		Vector position;
+		Vector normal;
+		Colour colour;
+	};
+
+	/*
+	 * Each program is a struct of the values it's drawn with, giving:
+	 *   TYPE                                  its ProgramType, or ProgramTypes::CUSTOM for one of your own
+	 *   VARYINGS                              how many values its vertex stage gives each vertex, at most
+	 *                                         MAX_PROGRAM_VARYINGS so a textured draw can add u, v and z
+	 *   vertex(in, varyings)                  the vertex stage, writing VARYINGS values for a ProgramVertex
+	 *   fragment(varyings, colour)            the fragment stage, over a SIMD.h float vector type F
+	 *                                         colour holds the texel's b, g and r from 0 to 1 for a textured draw,
+	 *                                         otherwise 1, and receives the pixels' b, g and r, which are clamped
+	 */
+
+	/*
+	 * Multiplies the lit colour by a tint, at each vertex
+	 */
+	struct TintProgram
+	{
+		static const ProgramType TYPE = ProgramTypes::TINT;
+
+		// Tinted b, g and r
+		static const int VARYINGS = 3;
+
+		Colour tint;
+
+		void vertex(const ProgramVertex& in, float* varyings) const
+		{
+			varyings[0] = in.colour._b * tint._b;
+			varyings[1] = in.colour._g * tint._g;
+			varyings[2] = in.colour._r * tint._r;
+		}
+
+		template <class F>
+		void fragment(const F* varyings, F* colour) const
+		{
+			for (int i = 0; i < 3; ++i)
+				colour[i] = colour[i] * varyings[i];
+		}
+	};
+
+	/*
+	 * Fades the lit colour linearly into a fog colour between two distances in front of the camera
+	 */
+	struct FogProgram
+	{
+		static const ProgramType TYPE = ProgramTypes::FOG;
+
+		// Lit b, g and r, and distance in front of the camera
+		static const int VARYINGS = 4;
+
+		Colour fogColour;
+
+		// Distances the fog starts and becomes solid at
+		float start;
+		float end;
+
+		void vertex(const ProgramVertex& in, float* varyings) const
+		{
+			varyings[0] = in.colour._b;
+			varyings[1] = in.colour._g;
+			varyings[2] = in.colour._r;
+
+			// The camera looks down -z
+			varyings[3] = -in.position.getZ();
+		}
+
+		template <class F>
+		void fragment(const F* varyings, F* colour) const
+		{
+			const F zero(0.0f);
+			const F one(1.0f);
+
+			const F fog = min(max((varyings[3] - F(start)) * F(1.0f / (end - start)), zero), one);
+			const F clear = one - fog;
+
+			colour[0] = colour[0] * varyings[0] * clear + F(fogColour._b) * fog;
+			colour[1] = colour[1] * varyings[1] * clear + F(fogColour._g) * fog;
+			colour[2] = colour[2] * varyings[2] * clear + F(fogColour._r) * fog;
+		}
+	};
+
+	/*
+	 * Adds light to the lit colour where the surface turns away from the camera, brightest at the silhouette
+	 */
+	struct RimLightProgram
+	{
+		static const ProgramType TYPE = ProgramTypes::RIM_LIGHT;
+
+		// Lit b, g and r, and how much rim light there is
+		static const int VARYINGS = 4;
+
+		Colour rimColour;
+
+		// Power the rim light falls off from the silhouette with
+		float exponent;
+
+		void vertex(const ProgramVertex& in, float* varyings) const
+		{
+			varyings[0] = in.colour._b;
+			varyings[1] = in.colour._g;
+			varyings[2] = in.colour._r;
+
+			// Cosine of the angle between the normal and the direction to the camera
+			Vector fromCamera = in.position.getNormalised();
+			const float facing = -in.normal.dot(fromCamera);
+
+			varyings[3] = (float)pow(1.0f - (facing > 0 ? facing : 0), exponent);
+		}
+
+		template <class F>
+		void fragment(const F* varyings, F* colour) const
+		{
+			colour[0] = colour[0] * varyings[0] + F(rimColour._b) * varyings[3];
+			colour[1] = colour[1] * varyings[1] + F(rimColour._g) * varyings[3];
+			colour[2] = colour[2] * varyings[2] + F(rimColour._r) * varyings[3];
+		}
+	};
+
+	template <>
+	struct RegisteredProgram<ProgramTypes::TINT>
+	{
+		typedef TintProgram Program;
+	};
+
+	template <>
+	struct RegisteredProgram<ProgramTypes::FOG>
+	{
+		typedef FogProgram Program;
+	};
+
+	template <>
+	struct RegisteredProgram<ProgramTypes::RIM_LIGHT>
+	{
+		typedef RimLightProgram Program;
+	};
+
+	/*
+	 * Calls table.add with a null pointer to each program, for table to build what it needs for them
+	 */
+	template <class Table>
+	void addPrograms(Table& table)
+	{
+		table.add((const TintProgram*)0);
+		table.add((const FogProgram*)0);
+		table.add((const RimLightProgram*)0);
+	}
+}
+
+#endif
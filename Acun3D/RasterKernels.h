@@ -0,0 +1,229 @@
+#ifndef __RASTERKERNELS_H__
+#define __RASTERKERNELS_H__
+
+#include "TriangleSetup.h"
+#include "RasterPath.h"
+
+namespace a3d
+{
+	namespace KernelModes
+	{
+		enum KernelMode
+		{
+			// Depth tests, then writes depth and colour
+			DRAW,
+
+			// Depth tests and writes depth only, for a depth pre-pass
+			DEPTH_ONLY,
+
+			// Writes colour where the depth is exactly what's in the depth buffer,
+			// for shading after a depth pre-pass
+			DEPTH_EQUAL
+		};
+	}
+
+	typedef KernelModes::KernelMode KernelMode;
+
+	// Number of kernel modes
+	const int KERNEL_MODE_COUNT = KernelModes::DEPTH_EQUAL + 1;
+
+	namespace DepthFormats
+	{
+		enum DepthFormat
+		{
+			// 32-bit float depth, 0 at the near plane and 1 at the far plane
+			FLOAT32,
+
+			// 32-bit float depth running from 1 at the near plane to 0 at the far plane, as the renderer's
+			// projection gives it for this format, so float precision, finest near 0, goes to the far plane
+			// where perspective depth needs it most
+			// Larger is nearer, so it's tested the other way around and cleared to 0
+			REVERSED_FLOAT32,
+
+			// Depth scaled to 0 .. 65535 and rounded
+			UNORM16,
+
+			// Depth scaled to 0 .. 16777215 and rounded, packed into three bytes
+			UNORM24
+		};
+	}
+
+	typedef DepthFormats::DepthFormat DepthFormat;
+
+	// Number of depth formats
+	const int DEPTH_FORMAT_COUNT = DepthFormats::UNORM24 + 1;
+
+	namespace FramebufferLayouts
+	{
+		enum FramebufferLayout
+		{
+			// Rows of pixels one after another, drawn straight into the target
+			LINEAR,
+
+			// Tiles of LAYOUT_TILE_WIDTH by LAYOUT_TILE_HEIGHT pixels one after another, in rows of tiles,
+			// each row of a tile a cache line of float depth, drawn into buffers of the rasteriser's own
+			// and copied into the target by endScene
+			TILED
+		};
+	}
+
+	typedef FramebufferLayouts::FramebufferLayout FramebufferLayout;
+
+	// Size in pixels of the tiles of the TILED layout, which are powers of two, at least as wide as
+	// the widest SIMD.h vector and at least as tall as a cell of the hierarchical depth buffer
+	const int LAYOUT_TILE_WIDTH = 16;
+	const int LAYOUT_TILE_HEIGHT = 8;
+
+	/*
+	 * Returns the index of pixel (x, y) in a buffer laid out as layout, width pixels wide, which for the TILED layout
+	 * is a whole number of tiles
+	 */
+	inline int getPixelOffset(FramebufferLayout layout, int width, int x, int y)
+	{
+		if (layout == FramebufferLayouts::LINEAR)
+			return y * width + x;
+
+		const int tileRow = y / LAYOUT_TILE_HEIGHT;
+		const int tileX = x & ~(LAYOUT_TILE_WIDTH - 1);
+
+		return (tileRow * width + tileX) * LAYOUT_TILE_HEIGHT
+				+ (y & (LAYOUT_TILE_HEIGHT - 1)) * LAYOUT_TILE_WIDTH + (x & (LAYOUT_TILE_WIDTH - 1));
+	}
+
+	/*
+	 * Counts of how the blocks of the triangles' bounding boxes were handled
+	 */
+	struct RasterStats
+	{
+		// Blocks skipped because they were outside an edge
+		unsigned int rejectedBlocks;
+
+		// Blocks inside all three edges, drawn without testing them
+		unsigned int acceptedBlocks;
+
+		// Blocks crossed by an edge, tested a pixel at a time
+		unsigned int partialBlocks;
+
+		// Blocks, and triangles in each tile they touch, found to be hidden by the hierarchical depth buffer
+		unsigned int occludedBlocks;
+		unsigned int occludedTriangles;
+
+		// Triangles dropped by setup for covering no pixels, and triangles drawn by the small-triangle
+		// kernels in each tile they touch
+		unsigned int emptyTriangles;
+		unsigned int smallTriangles;
+
+		// Pixels lit by the deferred shading pass
+		unsigned int resolvedPixels;
+
+		// Point lights and spotlights put in the light lists of tiles, and those with a range left out of them
+		unsigned int tileLights;
+		unsigned int culledLights;
+	};
+
+	/*
+	 * Where a kernel draws: the colour and depth buffers, the part of them it may touch (max exclusive),
+	 * the size of the blocks it walks the bounding box in and the counters it adds to
+	 */
+	struct RasterTarget
+	{
+		// Width and height of the cells of the hierarchical depth buffer
+		static const int HI_Z_SIZE = 8;
+
+		unsigned int* pixels;
+
+		// Depth buffer, in the format of the kernel drawing to it
+		void* depth;
+
+		// How the colour, depth and visibility buffers are laid out, and their width in pixels
+		FramebufferLayout layout;
+		int width;
+
+		// Visibility buffer that VISIBILITY triangles write their ids to and other triangles clear,
+		// or 0 if nothing in the scene is being deferred
+		unsigned int* ids;
+
+		// For a depth pre-pass, the prepassId of the triangle in front at each pixel, which DEPTH_ONLY kernels write
+		// and DEPTH_EQUAL kernels shade only where it's their triangle's, so that of several equally deep triangles
+		// only the one drawing them in order would have left is shaded, or 0 for DRAW kernels
+		unsigned int* prepassIds;
+
+		int clipMinX, clipMinY;
+		int clipMaxX, clipMaxY;
+
+		// Hierarchical depth buffer: the furthest depth in each cell of the depth buffer, hiZWidth cells to a row,
+		// and the furthest in the clip rectangle
+		// Depths are kept so that nearer is smaller whatever the format, which for REVERSED_FLOAT32 means
+		// negated, so the furthest is the largest of what's kept and the smallest of the depths themselves
+		// Kernels skip anything entirely behind it, and mark the cells they draw to so they can be brought
+		// up to date once the tile's triangles are done
+		float* hiZ;
+		unsigned char* hiZDirty;
+		int hiZWidth;
+		float* clipDepth;
+
+		int blockSize;
+		RasterStats* stats;
+	};
+
+	/*
+	 * Returns a lower bound on the depth of a triangle over the pixels (minX, minY) - (maxX, maxY), max exclusive,
+	 * kept the way the hierarchical depth buffer keeps it, negated for reversed depth
+	 */
+	float getMinDepth(const TriangleSetup& t, bool reversed, int minX, int minY, int maxX, int maxY);
+
+	/*
+	 * Rasterises the part of a set up triangle inside the target's clip rectangle
+	 */
+	typedef void (*RasteriseFunction)(const TriangleSetup& t, const RasterTarget& target);
+
+	/*
+	 * Sets up the triangles of a batch for a screen of width by height pixels
+	 */
+	typedef void (*SetupFunction)(TriangleBatch& batch, int width, int height);
+
+	/*
+	 * Returns the coverage mask (see TriangleSetup) of a set up triangle whose bounding box is no bigger than
+	 * SMALL_SIZE square
+	 */
+	typedef unsigned int (*CoverageFunction)(const TriangleSetup& t);
+
+	/*
+	 * A program's kernels for PROGRAM and PROGRAM_TEXTURED triangles, indexed by DepthFormat, KernelMode
+	 * then the triangle's type less PROGRAM
+	 * Triangles with a coverage mask are drawn by smallKernels and everything else by kernels, as below
+	 */
+	struct ProgramKernelTable
+	{
+		RasteriseFunction kernels[DEPTH_FORMAT_COUNT][KERNEL_MODE_COUNT][2];
+		RasteriseFunction smallKernels[DEPTH_FORMAT_COUNT][KERNEL_MODE_COUNT][2];
+	};
+
+	/*
+	 * An instruction set's kernels for each type of triangle, indexed by DepthFormat, KernelMode then TriangleType
+	 * Triangles with a coverage mask are drawn by smallKernels, which shade only the pixels in it,
+	 * and everything else by kernels, which walk the bounding box in blocks
+	 * PROGRAM and PROGRAM_TEXTURED triangles are drawn by the kernels in programs for their ProgramType instead,
+	 * or for a CUSTOM program by those it was bound with
+	 * Triangles are set up for them a batch at a time by setup
+	 */
+	struct RasterKernels
+	{
+		RasteriseFunction kernels[DEPTH_FORMAT_COUNT][KERNEL_MODE_COUNT][TRIANGLE_TYPE_COUNT];
+		RasteriseFunction smallKernels[DEPTH_FORMAT_COUNT][KERNEL_MODE_COUNT][TRIANGLE_TYPE_COUNT];
+
+		ProgramKernelTable programs[PROGRAM_TYPE_COUNT];
+
+		SetupFunction setup;
+		CoverageFunction coverage;
+	};
+
+	// Each set lives in its own file built for that instruction set, and is 0 if the compiler couldn't target it
+	const RasterKernels* getScalarKernels();
+	const RasterKernels* getSSE2Kernels();
+	const RasterKernels* getAVX2Kernels();
+	const RasterKernels* getAVX512Kernels();
+	const RasterKernels* getNEONKernels();
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __RASTERPATH_H__
+#define __RASTERPATH_H__
+
+namespace a3d
+{
+	namespace RasterPaths
+	{
+		// The instruction sets the rasteriser's kernels are built for
+		enum RasterPath
+		{
+			AUTO,
+			SCALAR,
+			SSE2,
+			AVX2,
+			AVX512,
+			NEON
+		};
+	}
+
+	typedef RasterPaths::RasterPath RasterPath;
+
+	// Number of raster paths, counting AUTO
+	const int RASTER_PATH_COUNT = RasterPaths::NEON + 1;
+}
+
+#endif
@@ -1,39 +1,77 @@
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <limits>
+#include <algorithm>
 
 #include "Rasteriser.h"
-
-#define SSE2
-
-#ifdef SSE2
-#define SSE
-#include <emmintrin.h>
-#endif
-
-#ifdef SSE
-#include <xmmintrin.h>
-#endif
+#include "CPUFeatures.h"
 
 namespace a3d
 {
 	Rasteriser::Rasteriser()
 	{
-		_pixelBuffer = 0;
-		_depthBuffer = 0;
+		initialise();
+	}
+
+	Rasteriser::Rasteriser(Pixel* pixelBuffer, int width, int height, DepthFormat depthFormat)
+	{
+		initialise();
+		setTarget(pixelBuffer, width, height, depthFormat);
 	}
 
-	Rasteriser::Rasteriser(Pixel* pixelBuffer, int width, int height)
+	Rasteriser::~Rasteriser()
+	{
+
+	}
+
+	/*
+	 * Sets the members both constructors start from, with no target
+	 */
+	void Rasteriser::initialise()
 	{
 		_pixelBuffer = 0;
+		_colourBuffer = 0;
 		_depthBuffer = 0;
-
-		setTarget(pixelBuffer, width, height);
+		_depthFormat = DepthFormats::FLOAT32;
+		_hiZWidth = 0;
+		_hiZHeight = 0;
+		_idBuffer = 0;
+		_layout = FramebufferLayouts::LINEAR;
+		_bufferWidth = 0;
+		_bufferHeight = 0;
+		_idBufferInUse = false;
+		_deferredShading = false;
+		_depthPrepass = false;
+		_prepassIds = 0;
+		_width = 0;
+		_height = 0;
+		_tilesX = 0;
+		_tilesY = 0;
+		_blockSize = DEFAULT_BLOCK_SIZE;
+		_perspectiveSpan = 0;
+		_textureFilter = TextureFilters::POINT;
+		_textureAddressMode = TextureAddressModes::CLAMP;
+		_mipmapMode = MipmapModes::NONE;
+		_textureLayout = TextureLayouts::LINEAR;
+		_batch = TriangleBatch();
+		_stats.resize(_workers.getWorkerCount(), RasterStats());
+		_tileLights.resize(_workers.getWorkerCount());
+
+		setRasterPath(RasterPaths::AUTO);
 	}
 
 	void Rasteriser::setPixel(int x, int y, int colour)
 	{
+		// Queued triangles have to land first, apart from those kept for a depth pre-pass
+		if (_batch.count > 0 || !_triangles.empty())
+			flush();
+
 		if (x >= 0 && y >= 0 && x < _width && y < _height)
-			_pixelBuffer[y * _width + x] = colour;
+		{
+			clearTile((y / TILE_SIZE) * _tilesX + x / TILE_SIZE);
+			((Pixel*)_colourBuffer)[getPixelOffset(_layout, _bufferWidth, x, y)] = colour;
+		}
 	}
 
 	template <class T>
@@ -71,26 +109,193 @@ namespace a3d
 		return n;
 	}
 
-	void Rasteriser::setTarget(Pixel* pixelBuffer, int width, int height)
+	void Rasteriser::setTarget(Pixel* pixelBuffer, int width, int height, DepthFormat depthFormat)
 	{
-		if (_depthBuffer != 0)
-			delete[] _depthBuffer;
+		flush();
 
 		_pixelBuffer = pixelBuffer;
-		_depthBuffer = new float[width * height];
+		_depthFormat = depthFormat;
 		_width = width;
 		_height = height;
 
+		allocateBuffers();
+
+		// Set up the hierarchical depth buffer
+		_hiZWidth = (width + RasterTarget::HI_Z_SIZE - 1) / RasterTarget::HI_Z_SIZE;
+		_hiZHeight = (height + RasterTarget::HI_Z_SIZE - 1) / RasterTarget::HI_Z_SIZE;
+		_hiZ.resize(_hiZWidth * _hiZHeight);
+		_hiZDirty.assign(_hiZWidth * _hiZHeight, 0);
+
+		// Set up the tile bins
+		_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+		_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+		_bins.clear();
+		_bins.resize(_tilesX * _tilesY);
+		_tileDepth.resize(_tilesX * _tilesY);
+		_tileClears.resize(_tilesX * _tilesY);
+
 		beginScene(Pixel(255, 255, 255, 0));
 	}
 
 	/*
-	 * Clears the colour and depth buffer
+	 * Allocates the buffers the kernels draw to for the target's size, depth format and layout
+	 * The TILED layout pads them to a whole number of tiles and has a colour buffer of its own
+	 */
+	void Rasteriser::allocateBuffers()
+	{
+		if (_layout == FramebufferLayouts::TILED)
+		{
+			_bufferWidth = (_width + LAYOUT_TILE_WIDTH - 1) & ~(LAYOUT_TILE_WIDTH - 1);
+			_bufferHeight = (_height + LAYOUT_TILE_HEIGHT - 1) & ~(LAYOUT_TILE_HEIGHT - 1);
+		}
+		else
+		{
+			_bufferWidth = _width;
+			_bufferHeight = _height;
+		}
+
+		const int pixels = _bufferWidth * _bufferHeight;
+
+		_depthBuffer = (unsigned char*)_depthStorage.allocate(pixels * getDepthFormatSize(_depthFormat));
+		_idBuffer = (unsigned int*)_idStorage.allocate(pixels * sizeof(unsigned int));
+
+		_prepassStorage.release();
+		_prepassIds = 0;
+
+		if (_layout == FramebufferLayouts::TILED)
+		{
+			_colourBuffer = (unsigned int*)_colourStorage.allocate(pixels * sizeof(unsigned int));
+		}
+		else
+		{
+			_colourStorage.release();
+			_colourBuffer = (unsigned int*)_pixelBuffer;
+		}
+	}
+
+	/*
+	 * Starts a scene cleared to colour, and clears the counters
+	 * Anything still queued or deferred would be cleared away, so it is dropped
+	 * The buffers aren't cleared straight away: each tile is cleared by the worker that first draws to it, while it's
+	 * working on it, and endScene clears the colour of whatever nothing was drawn to, so the pixel buffer isn't ready
+	 * until then
+	 * The depth of tiles nothing is drawn to is never touched
 	 */
 	void Rasteriser::beginScene(Pixel colour)
 	{
-		std::fill_n(_pixelBuffer, _width * _height, *(Pixel*)&colour);
-		std::fill_n(_depthBuffer, _width * _height, std::numeric_limits<float>::infinity());
+		_clearColour = colour;
+
+		startScene(CLEAR_COLOUR | CLEAR_DEPTH);
+	}
+
+	/*
+	 * Starts a scene without clearing the colour buffer, for when something drawn over the whole screen will cover it
+	 */
+	void Rasteriser::beginScene()
+	{
+		startScene(CLEAR_DEPTH);
+	}
+
+	void Rasteriser::startScene(unsigned char clears)
+	{
+		_batch.count = 0;
+		_batch.attributeCount = 0;
+
+		_triangles.clear();
+		for (unsigned int i = 0; i < _bins.size(); ++i)
+			_bins[i].clear();
+
+		_idBufferInUse = false;
+		_deferredTriangles.clear();
+		_keptLights.clear();
+
+		_tileClears.assign(_tileClears.size(), clears);
+		clearHiZ();
+
+		_stats.assign(_stats.size(), RasterStats());
+	}
+
+	/*
+	 * Marks the depth buffer to be cleared to the furthest depth its format holds, and clears
+	 * the hierarchical depth buffer with it
+	 */
+	void Rasteriser::clearDepth()
+	{
+		for (unsigned int i = 0; i < _tileClears.size(); ++i)
+			_tileClears[i] |= CLEAR_DEPTH;
+
+		clearHiZ();
+	}
+
+	void Rasteriser::clearHiZ()
+	{
+		// Reversed depth is cleared to 0, kept negated (see RasterTarget)
+		const float furthest = (_depthFormat == DepthFormats::REVERSED_FLOAT32 ? 0.0f : std::numeric_limits<float>::infinity());
+
+		std::fill(_hiZ.begin(), _hiZ.end(), furthest);
+		std::fill(_tileDepth.begin(), _tileDepth.end(), furthest);
+	}
+
+	/*
+	 * Carries out whatever clears of a tile are still waiting, before it's drawn to
+	 */
+	void Rasteriser::clearTile(int tile)
+	{
+		const unsigned char clears = _tileClears[tile];
+
+		if (clears == 0)
+			return;
+
+		const int tileX = (tile % _tilesX) * TILE_SIZE;
+		const int tileY = (tile / _tilesX) * TILE_SIZE;
+		const int tileWidth = min(tileX + TILE_SIZE, _bufferWidth) - tileX;
+		const int tileMaxY = min(tileY + TILE_SIZE, _height);
+
+		// Each row of a LINEAR tile is a run of pixels, as is each row of layout tiles in a TILED one
+		const int rowHeight = (_layout == FramebufferLayouts::TILED ? LAYOUT_TILE_HEIGHT : 1);
+		const int runLength = tileWidth * rowHeight;
+
+		const unsigned int colour = *(unsigned int*)&_clearColour;
+
+		const int depthSize = getDepthFormatSize(_depthFormat);
+		const bool floatDepth = (_depthFormat == DepthFormats::FLOAT32 || _depthFormat == DepthFormats::REVERSED_FLOAT32);
+		const float furthest = (_depthFormat == DepthFormats::REVERSED_FLOAT32 ? 0.0f : std::numeric_limits<float>::infinity());
+
+		for (int y = tileY; y < tileMaxY; y += rowHeight)
+		{
+			const int offset = getPixelOffset(_layout, _bufferWidth, tileX, y);
+
+			if (clears & CLEAR_COLOUR)
+				std::fill_n(_colourBuffer + offset, runLength, colour);
+
+			if (clears & CLEAR_DEPTH)
+			{
+				if (floatDepth)
+					std::fill_n((float*)_depthBuffer + offset, runLength, furthest);
+				else
+					memset(_depthBuffer + offset * depthSize, 0xFF, runLength * depthSize);
+			}
+		}
+
+		_tileClears[tile] = 0;
+	}
+
+	/*
+	 * Clears a tile's part of the pre-pass's record of which triangle is in front, so that what an earlier
+	 * pre-pass left there is never taken for one of the triangles about to be drawn
+	 */
+	void Rasteriser::clearPrepassIds(int tile)
+	{
+		const int tileX = (tile % _tilesX) * TILE_SIZE;
+		const int tileY = (tile / _tilesX) * TILE_SIZE;
+		const int tileWidth = min(tileX + TILE_SIZE, _bufferWidth) - tileX;
+		const int tileMaxY = min(tileY + TILE_SIZE, _height);
+
+		const int rowHeight = (_layout == FramebufferLayouts::TILED ? LAYOUT_TILE_HEIGHT : 1);
+
+		for (int y = tileY; y < tileMaxY; y += rowHeight)
+			std::fill_n(_prepassIds + getPixelOffset(_layout, _bufferWidth, tileX, y), tileWidth * rowHeight, 0);
 	}
 
 	void Rasteriser::drawLine(int x1, int y1, int x2, int y2, int colour)
@@ -137,1149 +342,1579 @@ namespace a3d
 	}
 
 	/*
-	 * Calculates initial value, dx and dy for interpolation
-	 * returns the initial value, stores the dx and dy in the last two arguments
+	 * Adds a triangle to the batch waiting to be set up, and fills in what its setup doesn't work out
+	 * Setting up a full batch makes room for it first
+	 * Returns its index in the batch, for its attributes to be filled in
 	 */
-	template <class T>
-	T calculateInterpolants(float initialx, float initialy,
-							float x1, float y1, T z1,
-							float x2, float y2, T z2,
-							float x3, float y3, T z3,
-							T* dx, T* dy)
-	{
-		// Ax + By + Cz + D = 0 where z is any dimension common to the
-		// three points of the triangle (z-coordinate, colour, texture coordinate)
-		// Incrementally, the initial value of z is (A * -minX + B * -minY -D) / C,
-		// the difference for each X is -A/C, and the difference for each Y is -B/C
-
-		// Calculate plane equation coefficients
-		T Ac = (z2 - z3) * y1 + (z3 - z1) * y2 + (z1 - z2) * y3;
-		T Bc = z1 * (x2 - x3) + z2 * (x3 - x1) + z3 * (x1 - x2);
-		float C = x1 * (y2 - y3) + x2 * (y3 - y1) + x3 * (y1 - y2);
-		T Dc = - ((z3 * y2 - z2 * y3) * x1 + (z1 * y3 - z3 * y1) * x2 + (z2 * y1 - z1 * y2) * x3);
-
-		// Calculate initial value, dx and dy
-		T initial = (Ac * -initialx + Bc * -initialy - Dc) / C;
-		T rdx = -Ac / C;
-		T rdy = -Bc / C;
-
-		// Return values
-		*dx = rdx;
-		*dy = rdy;
-
-		return initial;		
+	int Rasteriser::addTriangle(TriangleType type, int attributeCount,
+								float x1, float y1, float z1,
+								float x2, float y2, float z2,
+								float x3, float y3, float z3)
+	{
+		if (_batch.count == TriangleBatch::SIZE)
+			setupBatch();
+
+		const int i = _batch.count++;
+
+		_batch.x[0][i] = x1;
+		_batch.y[0][i] = y1;
+		_batch.x[1][i] = x2;
+		_batch.y[1][i] = y2;
+		_batch.x[2][i] = x3;
+		_batch.y[2][i] = y3;
+
+		_batch.z[0][i] = z1;
+		_batch.z[1][i] = z2;
+		_batch.z[2][i] = z3;
+
+		_batch.attributeCount = max(_batch.attributeCount, attributeCount);
+		_batch.deferred[i] = false;
+
+		TriangleSetup& t = _batch.setups[i];
+		t.type = type;
+		t.sampler = Sampler();
+		t.textureSpan = 1;
+		t.textureAttribute = -1;
+		t.lights = 0;
+		t.program = 0;
+		t.programKernels = 0;
+
+		return i;
 	}
-	
+
 	/*
-	 * Draws a triangle using half-space equations to determine area and a plane equation
-	 * derivation to interpolate colour values
-	 * Optimised with incremental calculations and SSE/SSE2 instructions
+	 * Sets the values at each vertex of one of a batched triangle's attributes
 	 */
-	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, Colour c1,
-							float x2f, float y2f, float z2, Colour c2,
-							float x3f, float y3f, float z3, Colour c3)
+	void setAttribute(TriangleBatch& batch, int triangle, int attribute, float v1, float v2, float v3)
+	{
+		batch.attributes[attribute][0][triangle] = v1;
+		batch.attributes[attribute][1][triangle] = v2;
+		batch.attributes[attribute][2][triangle] = v3;
+	}
+
+	/*
+	 * Sets b, g and r in the three attributes starting at attribute
+	 */
+	void setAttributes(TriangleBatch& batch, int triangle, int attribute, const Colour& c1, const Colour& c2, const Colour& c3)
+	{
+		setAttribute(batch, triangle, attribute, c1._b, c2._b, c3._b);
+		setAttribute(batch, triangle, attribute + 1, c1._g, c2._g, c3._g);
+		setAttribute(batch, triangle, attribute + 2, c1._r, c2._r, c3._r);
+	}
+
+	/*
+	 * Sets x, y and z in the three attributes starting at attribute
+	 */
+	void setAttributes(TriangleBatch& batch, int triangle, int attribute, const Vector& v1, const Vector& v2, const Vector& v3)
+	{
+		setAttribute(batch, triangle, attribute, v1.getX(), v2.getX(), v3.getX());
+		setAttribute(batch, triangle, attribute + 1, v1.getY(), v2.getY(), v3.getY());
+		setAttribute(batch, triangle, attribute + 2, v1.getZ(), v2.getZ(), v3.getZ());
+	}
+
+	// Most a textured triangle's texture coordinates can be out by, in texels, where they're stepped affinely
+	const float MAX_TEXTURE_ERROR = 0.5f;
+
+	/*
+	 * Returns how many pixels apart along a row a batched triangle's texture coordinates can be worked out exactly
+	 * and stepped affinely in between, while staying within MAX_TEXTURE_ERROR of the exact ones
+	 * That's a power of two no more than maxSpan, or 1 if they have to be worked out at every pixel
+	 * first is the attribute holding u / z, followed by v / z and 1 / z
+	 */
+	int getTextureSpan(const TriangleBatch& batch, int triangle, int first, int maxSpan)
 	{
-		if (_pixelBuffer)
+		const TriangleSetup& t = batch.setups[triangle];
+		const Interpolant& uoz = t.attributes[first];
+		const Interpolant& voz = t.attributes[first + 1];
+		const Interpolant& ooz = t.attributes[first + 2];
+
+		// 1 / z is linear across the screen and has the same sign at each vertex, so it's smallest
+		// in size at one of them
+		const float ooz1 = batch.attributes[first + 2][0][triangle];
+		const float ooz2 = batch.attributes[first + 2][1][triangle];
+		const float ooz3 = batch.attributes[first + 2][2][triangle];
+		const float minOoz = min(fabs(ooz1), fabs(ooz2), fabs(ooz3));
+
+		if (!(minOoz > 0) || !(ooz1 * ooz2 > 0) || !(ooz1 * ooz3 > 0))
+			return 1;
+
+		// Texture coordinates across a triangle lie between those at its vertices
+		float maxU = 0;
+		float maxV = 0;
+
+		for (int i = 0; i < 3; ++i)
 		{
-			const int y1 = (int)(16.0f * y1f + 0.5f);
-			const int y2 = (int)(16.0f * y2f + 0.5f);
-			const int y3 = (int)(16.0f * y3f + 0.5f);
-
-			const int x1 = (int)(16.0f * x1f + 0.5f);
-			const int x2 = (int)(16.0f * x2f + 0.5f);
-			const int x3 = (int)(16.0f * x3f + 0.5f);
-
-			// Precalculate half-space function coefficients (so they can be calculated incrementally in the loop)
-			const int dy1 = x1 - x2;
-			const int dy2 = x2 - x3;
-			const int dy3 = x3 - x1;
-
-			const int dx1 = y1 - y2;
-			const int dx2 = y2 - y3;
-			const int dx3 = y3 - y1;
-			
-			const int fdx1 = dx1 << 4;
-			const int fdx2 = dx2 << 4;
-			const int fdx3 = dx3 << 4;
-			
-			const int fdy1 = dy1 << 4;
-			const int fdy2 = dy2 << 4;
-			const int fdy3 = dy3 << 4;
-
-			// Work out min and max X and Y
-			int minX = (min((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int maxX = (max((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int minY = (min((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-			int maxY = (max((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-
-			// Make sure it's not outside of the screen
-			if (minX < 0)
-				minX = 0;
-			if (minY < 0)
-				minY = 0;
-			if (maxX >= _width)
-				maxX = _width - 1;
-			if (maxY >= _height)
-				maxY = _height - 1;
-			
-			// Calculate half-space initial values
-			int check1 = (int)((dy1 * (minY << 4)) - (dy1 * y1) - (dx1 * (minX << 4)) + (dx1 * x1));
-			int check2 = (int)((dy2 * (minY << 4)) - (dy2 * y2) - (dx2 * (minX << 4)) + (dx2 * x2));
-			int check3 = (int)((dy3 * (minY << 4)) - (dy3 * y3) - (dx3 * (minX << 4)) + (dx3 * x3));
-
-			// Extend values if required for fill convention purposes
-			if (dx1 < 0 || (dx1 == 0 && dy1 > 0))
-				check1++;
-			if (dx2 < 0 || (dx2 == 0 && dy2 > 0))
-				check2++;
-			if (dx3 < 0 || (dx3 == 0 && dy3 > 0)) 
-				check3++;
-
-			// Calculate initial colour value and dx/dy
-			Colour dxC;
-			Colour dyC;
-			Colour initialC = calculateInterpolants((float)minX, (float)minY, x1f, y1f, c1,
-													x2f, y2f, c2, x3f, y3f, c3, &dxC, &dyC);
-
-			// The same for z-coordinate for z-buffering
-			float dxZ;
-			float dyZ;
-			float initialZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, z1,
-													x2f, y2f, z2, x3f, y3f, z3, &dxZ, &dyZ);
-						
-#ifdef SSE
-			__m128 checkf = { (float)check1, (float)check2, (float)check3 };
-
-			// Load interpolants __m128s for fast floating point addition
-			__m128 colourf = { initialC._b, initialC._g, initialC._r, initialZ };
-			__m128 dxcf = { dxC._b, dxC._g, dxC._r, dxZ };
-			__m128 dycf = { dyC._b, dyC._g, dyC._r, dyZ };
-#endif
-
-			// Calculate address offset of initial position in buffer
-			unsigned int* buffer = (unsigned int*)_pixelBuffer + minY * _width;
-			float* depthBuffer = _depthBuffer + minY * _width;
-
-			for (int y = minY; y < maxY; y++)
+			const float vertexOoz = batch.attributes[first + 2][i][triangle];
+
+			maxU = max(maxU, fabs(batch.attributes[first][i][triangle] / vertexOoz));
+			maxV = max(maxV, fabs(batch.attributes[first + 1][i][triangle] / vertexOoz));
+		}
+
+		// Along a row, u = (u / z) / (1 / z) changes by u' = ((u / z)' - u (1 / z)') / (1 / z) a pixel,
+		// and has a second derivative of -2 u' (1 / z)' / (1 / z)
+		// Stepping it linearly between exact values span pixels apart is out by at most span^2 / 8 of that
+		const float depthGradient = fabs(ooz.dx) / minOoz;
+		const float gradientU = (fabs(uoz.dx) + maxU * fabs(ooz.dx)) / minOoz;
+		const float gradientV = (fabs(voz.dx) + maxV * fabs(ooz.dx)) / minOoz;
+
+		const float error = depthGradient * max(gradientU, gradientV) / 4.0f;
+
+		int span = maxSpan;
+		while (span > 1 && span * span * error > MAX_TEXTURE_ERROR)
+			span /= 2;
+
+		return span;
+	}
+
+	/*
+	 * Sets up the batched triangles together with the kernels' setup, and queues those with anything to draw
+	 * A triangle small enough for the small-triangle kernels has its coverage worked out, and is dropped
+	 * if it falls between pixels
+	 */
+	void Rasteriser::setupBatch()
+	{
+		if (_batch.count == 0)
+			return;
+
+		_kernels->setup(_batch, _width, _height);
+
+		// Queueing can flush, which comes back here, so the batch is emptied first
+		const int count = _batch.count;
+		_batch.count = 0;
+		_batch.attributeCount = 0;
+
+		for (int i = 0; i < count; ++i)
+		{
+			if (!_batch.visible[i])
+				continue;
+
+			TriangleSetup& t = _batch.setups[i];
+			t.coverage = 0;
+
+			if (_perspectiveSpan != 0 && t.textureAttribute >= 0)
+				t.textureSpan = getTextureSpan(_batch, i, t.textureAttribute, _perspectiveSpan);
+
+			if (t.sampler.getMipmapMode() == MipmapModes::TRIANGLE)
 			{
-				// Create temporary copies of our incremental values because they'll be needed in the next iteration
-				int check1Temp = check1;
-				int check2Temp = check2;
-				int check3Temp = check3;
-				
-				float z;
-#ifdef SSE
-				__m128 currentColourf = colourf;
-#else
-				z = initialZ;
-				Colour currentC = initialC;
-#endif
-
-				for (int x = minX; x < maxX; x++)
+				const float centreX = (_batch.x[0][i] + _batch.x[1][i] + _batch.x[2][i]) / 3.0f;
+				const float centreY = (_batch.y[0][i] + _batch.y[1][i] + _batch.y[2][i]) / 3.0f;
+				t.sampler = t.sampler.getLevelSampler(t.getTextureLevel(t.textureAttribute, centreX, centreY));
+			}
+
+			if (t.maxX - t.minX <= TriangleSetup::SMALL_SIZE && t.maxY - t.minY <= TriangleSetup::SMALL_SIZE)
+			{
+				t.coverage = _kernels->coverage(t);
+
+				if (t.coverage == 0)
 				{
-					if (check1Temp > 0 &&
-						check2Temp > 0 &&
-						check3Temp > 0)
-					{
-#ifdef SSE
-						z = currentColourf.m128_f32[3];
-#endif
-						// If on top of screen
-						if (depthBuffer[x] > z)
-						{						
-							depthBuffer[x] = z;
-
-							int i1;
-							int i2;
-							int i3;
-
-#ifdef SSE2
-							// Scale the values to the range 0 .. 255.0f
-							static const __m128 twofivefive = { 255.0f, 255.0f, 255.0f, 255.0f };
-							__m128 colour = _mm_mul_ps(currentColourf, twofivefive);
-
-							// Convert our floating point colours to 32-bit integers
-							__m128i intsOut = _mm_cvtps_epi32(colour);
-
-							// Get the low-order bytes of each component
-							i1 = intsOut.m128i_i8[0];
-							i2 = intsOut.m128i_i8[4];
-							i3 = intsOut.m128i_i8[8];
-#else
-#ifdef SSE
-							// Scale the values to the range 0 .. 255.0f
-							static const __m128 twofivefive = { 255.0f, 255.0f, 255.0f, 255.0f };
-							__m128 colour = _mm_mul_ps(currentColourf, twofivefive);
-
-							float f = colour.m128_f32[0];		// Prepare float for conversion
-							__asm fld f									// Push it onto the FLU stack
-							__asm fistp i1								// Magic it to an int
-
-							f = colour.m128_f32[1];
-							__asm fld f
-							__asm fistp i2
-
-							f = colour.m128_f32[2];
-							__asm fld f
-							__asm fistp i3
-#else
-							// Scale the values to the range 0 .. 255.0f
-							i1 = (int)(currentC._b * 255.0f);
-							i2 = (int)(currentC._g * 255.0f);
-							i3 = (int)(currentC._r * 255.0f);
-#endif
-#endif
-
-							((unsigned char*)&buffer[x])[0] = i1;
-							((unsigned char*)&buffer[x])[1] = i2;
-							((unsigned char*)&buffer[x])[2] = i3;
-						}
-					}
-
-					// Increment values in x
-					check1Temp -= fdx1;
-					check2Temp -= fdx2;
-					check3Temp -= fdx3;
-
-#ifdef SSE
-					currentColourf = _mm_add_ps(currentColourf, dxcf);
-#else
-					currentC += dxC;
-					z += dxZ;
-#endif
+					_stats[0].emptyTriangles++;
+					continue;
 				}
+			}
 
-				buffer += _width;
-				depthBuffer += _width;
+			if (_batch.deferred[i])
+				submitDeferred(t);
+			else
+				submit(t);
+		}
+	}
 
-				// Increment values in y
+	/*
+	 * Returns a sampler reading an image with the current filter, address mode, mipmap mode and layout,
+	 * or LINEAR if the image hasn't been copied into the layout, which is kept for as long as triangles
+	 * are drawn with the same image
+	 */
+	const Sampler& Rasteriser::getSampler(const Image& image)
+	{
+		const TextureLayout layout = (image.hasLayout(_textureLayout) ? _textureLayout : TextureLayouts::LINEAR);
 
-				check1 += fdy1;
-				check2 += fdy2;
-				check3 += fdy3;
+		if (_sampler.getImage() != &image || _sampler.getData() != image.getTexels(layout))
+			_sampler = Sampler(image, _textureFilter, _textureAddressMode, _mipmapMode, layout);
 
-#ifdef SSE
-				colourf = _mm_add_ps(colourf, dycf);
-#else
-				initialC += dyC;
-				initialZ += dyZ;
-#endif
-			}
-		}
+		return _sampler;
 	}
 
 	/*
-	 * Draws a textured triangle with colour interpolation
-	 * uoz = u / z
-	 * yoz = y / z
-	 * zr = 1 / z
+	 * Returns a lower bound on the depth of a triangle over the pixels (minX, minY) - (maxX, maxY), max exclusive,
+	 * negated for reversed depth the way the hierarchical depth buffer keeps it (see RasterTarget)
+	 * The depth is linear, so it's smallest at a corner, and a margin covers the rounding
+	 * of the kernels' incremental interpolation
 	 */
-	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, float uoz1, float voz1, float zr1, Colour c1,
-							float x2f, float y2f, float z2, float uoz2, float voz2, float zr2, Colour c2,
-							float x3f, float y3f, float z3, float uoz3, float voz3, float zr3, Colour c3,
-							unsigned int textureCount, const Image* textures)
+	float getMinDepth(const TriangleSetup& t, bool reversed, int minX, int minY, int maxX, int maxY)
+	{
+		const float x0 = (float)(minX - t.minX);
+		const float y0 = (float)(minY - t.minY);
+		const float x1 = (float)(maxX - 1 - t.minX);
+		const float y1 = (float)(maxY - 1 - t.minY);
+
+		const float sign = (reversed ? -1.0f : 1.0f);
+		const float dx = t.z.dx * sign;
+		const float dy = t.z.dy * sign;
+
+		float z = t.z.value * sign;
+		z += (dx < 0 ? dx * x1 : dx * x0);
+		z += (dy < 0 ? dy * y1 : dy * y0);
+
+		const float scale = fabs(t.z.value) + fabs(t.z.dx) * max(fabs(x0), fabs(x1))
+							+ fabs(t.z.dy) * max(fabs(y0), fabs(y1));
+
+		return z - scale * 1e-5f;
+	}
+
+	/*
+	 * Queues a set up triangle and adds it to the bin of every tile its bounding box touches,
+	 * apart from those where the hierarchical depth buffer shows it's hidden
+	 */
+	void Rasteriser::submit(const TriangleSetup& t)
 	{
-		if (_pixelBuffer)
+		unsigned int index = _triangles.size();
+		_triangles.push_back(t);
+
+		// 0 is left for pixels no kept triangle is in front at
+		_triangles.back().prepassId = index + 1;
+
+		int minTileX = t.minX / TILE_SIZE;
+		int minTileY = t.minY / TILE_SIZE;
+		int maxTileX = (t.maxX - 1) / TILE_SIZE;
+		int maxTileY = (t.maxY - 1) / TILE_SIZE;
+
+		const float minDepth = getMinDepth(t, _depthFormat == DepthFormats::REVERSED_FLOAT32, t.minX, t.minY, t.maxX, t.maxY);
+		bool binned = false;
+
+		for (int y = minTileY; y <= maxTileY; ++y)
 		{
-			const int y1 = (int)(16.0f * y1f + 0.5f);
-			const int y2 = (int)(16.0f * y2f + 0.5f);
-			const int y3 = (int)(16.0f * y3f + 0.5f);
-
-			const int x1 = (int)(16.0f * x1f + 0.5f);
-			const int x2 = (int)(16.0f * x2f + 0.5f);
-			const int x3 = (int)(16.0f * x3f + 0.5f);
-
-			// Precalculate half-space function coefficients (so they can be calculated incrementally in the loop)
-			const int dy1 = x1 - x2;
-			const int dy2 = x2 - x3;
-			const int dy3 = x3 - x1;
-
-			const int dx1 = y1 - y2;
-			const int dx2 = y2 - y3;
-			const int dx3 = y3 - y1;
-			
-			const int fdx1 = dx1 << 4;
-			const int fdx2 = dx2 << 4;
-			const int fdx3 = dx3 << 4;
-			
-			const int fdy1 = dy1 << 4;
-			const int fdy2 = dy2 << 4;
-			const int fdy3 = dy3 << 4;
-
-			// Work out min and max X and Y
-			int minX = (min((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int maxX = (max((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int minY = (min((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-			int maxY = (max((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-
-			// Make sure it's not outside of the screen
-			if (minX < 0)
-				minX = 0;
-			if (minY < 0)
-				minY = 0;
-			if (maxX >= _width)
-				maxX = _width - 1;
-			if (maxY >= _height)
-				maxY = _height - 1;
-			
-			// Calculate half-space initial values
-			int check1 = (int)((dy1 * (minY << 4)) - (dy1 * y1) - (dx1 * (minX << 4)) + (dx1 * x1));
-			int check2 = (int)((dy2 * (minY << 4)) - (dy2 * y2) - (dx2 * (minX << 4)) + (dx2 * x2));
-			int check3 = (int)((dy3 * (minY << 4)) - (dy3 * y3) - (dx3 * (minX << 4)) + (dx3 * x3));
-
-			// Extend values if required for fill convention purposes
-			if (dx1 < 0 || (dx1 == 0 && dy1 > 0))
-				check1++;
-			if (dx2 < 0 || (dx2 == 0 && dy2 > 0))
-				check2++;
-			if (dx3 < 0 || (dx3 == 0 && dy3 > 0)) 
-				check3++;
-
-			// Calculate initial colour value and dx/dy
-			Colour dxC;
-			Colour dyC;
-			Colour initialC = calculateInterpolants((float)minX, (float)minY, x1f, y1f, c1,
-													x2f, y2f, c2, x3f, y3f, c3, &dxC, &dyC);
-
-			// The same for z-coordinate for z-buffering
-			float dxZ;
-			float dyZ;
-			float initialZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, z1,
-													x2f, y2f, z2, x3f, y3f, z3, &dxZ, &dyZ);
-
-			// U / Z interpolation
-			float dxUOZ;
-			float dyUOZ;
-			float initialUOZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, uoz1,
-												x2f, y2f, uoz2, x3f, y3f, uoz3, &dxUOZ, &dyUOZ);
-
-			// V / Z interpolation
-			float dxVOZ;
-			float dyVOZ;
-			float initialVOZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, voz1,
-													x2f, y2f, voz2, x3f, y3f, voz3, &dxVOZ, &dyVOZ);
-
-			// 1 / Z interpolation
-			float dxOOZ;
-			float dyOOZ;
-			float initialOOZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, zr1,
-													x2f, y2f, zr2, x3f, y3f, zr3, &dxOOZ, &dyOOZ);
-						
-#ifdef SSE
-			__m128 checkf = { (float)check1, (float)check2, (float)check3 };
-
-			// Load interpolants __m128s for fast floating point conversion
-			__m128 colourf = { initialC._b, initialC._g, initialC._r, initialZ };
-			__m128 dxcf = { dxC._b, dxC._g, dxC._r, dxZ };
-			__m128 dycf = { dyC._b, dyC._g, dyC._r, dyZ };
-
-			// Load UV interpolants too
-			__m128 initialUVf = { initialUOZ, initialVOZ, initialOOZ, 0 };
-			__m128 dxUVf = { dxUOZ, dxVOZ, dxOOZ, 0 };
-			__m128 dyUVf = { dyUOZ, dyVOZ, dyOOZ, 0 };
-#endif
-
-			// Calculate address offset of initial position in buffer
-			unsigned int* buffer = (unsigned int*)_pixelBuffer + minY * _width;
-			float* depthBuffer = _depthBuffer + minY * _width;
-
-			for (int y = minY; y < maxY; y++)
+			for (int x = minTileX; x <= maxTileX; ++x)
 			{
-				// Create temporary copies of our incremental values because they'll be needed in the next iteration
-				int check1Temp = check1;
-				int check2Temp = check2;
-				int check3Temp = check3;
-
-				float UOZ = initialUOZ;
-				float VOZ = initialVOZ;
-				float OOZ = initialOOZ;
-				
-				float z;
-#ifdef SSE
-				__m128 currentColourf = colourf;
-				__m128 UVf = initialUVf;
-#else
-				z = initialZ;
-				Colour currentC = initialC;
-#endif
-
-				for (int x = minX; x < maxX; x++)
+				const int tile = y * _tilesX + x;
+
+				if (minDepth > _tileDepth[tile])
 				{
-					if (check1Temp > 0 &&
-						check2Temp > 0 &&
-						check3Temp > 0)
-					{
-#ifdef SSE
-						z = currentColourf.m128_f32[3];
-#endif
-						// If on top of screen
-						if (depthBuffer[x] > z)
-						{						
-							depthBuffer[x] = z;
-
-							int i1;
-							int i2;
-							int i3;
-
-							// Perspective-corrected U and V coordinates
-							int tU;
-							int tV;
-
-#ifdef SSE2
-							// Calculate perspective-correct texture coordinates
-							float f;
-
-							f = UVf.m128_f32[0] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tU
-							
-							f = UVf.m128_f32[1] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tV
-							
-							if (tU < 0)
-								tU = 0;
-							if (tV < 0)
-								tV = 0;
-							if (tU >= textures[0].getWidth())
-								tU = textures[0].getWidth() - 1;
-							if (tV >= textures[0].getHeight())
-								tV = textures[0].getHeight() - 1;
-
-							// Get texture colour at current (U,V) and multiply with light colour
-							unsigned char* texture = (unsigned char*)&textures[0].getData()[(tV * textures[0].getWidth()) + tU];
-							__m128 textureColour = { texture[0], texture[1], texture[2], 0 };
-
-							// Scale it to the range 0 .. 1.0f
-							static const __m128 twofivefive = { 255.0f, 255.0f, 255.0f, 255.0f };
-							textureColour = _mm_div_ps(textureColour, twofivefive);
-
-							// Multiply with light colour
-							__m128 colour = _mm_mul_ps(currentColourf, textureColour);
-
-							// Multiply by 255.0f
-							colour = _mm_mul_ps(colour, twofivefive);
-
-							// Clamp to 255.0f
-							colour = _mm_min_ps(colour, twofivefive);
-
-							// Convert our floating point colours to 32-bit integers
-							__m128i intsOut = _mm_cvtps_epi32(colour);
-
-							// Get the low-order bytes of each component
-							i1 = intsOut.m128i_i8[0];
-							i2 = intsOut.m128i_i8[4];
-							i3 = intsOut.m128i_i8[8];
-
-#else
-#ifdef SSE
-							// Calculate perspective-correct texture coordinates
-							float f;
-
-							f = UVf.m128_f32[0] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tU
-							
-							f = UVf.m128_f32[1] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tV
-							
-							if (tU < 0)
-								tU = 0;
-							if (tV < 0)
-								tV = 0;
-							if (tU >= textures[0].getWidth())
-								tU = textures[0].getWidth() - 1;
-							if (tV >= textures[0].getHeight())
-								tV = textures[0].getHeight() - 1;
-
-							// Get texture colour at current (U,V) and multiply with light colour
-							unsigned char* texture = (unsigned char*)&textures[0].getData()[(tV * textures[0].getWidth()) + tU];
-							__m128 textureColour = { texture[0], texture[1], texture[2], 0 };
-
-							// Dive it by 255.0f to get it in the range 0 .. 1.0f
-							static const __m128 twofivefive = _mm_set_ps(255.0f, 255.0f, 255.0f, 255.0f);
-							textureColour = _mm_div_ps(textureColour, twofivefive);
-
-							// Blend light colour with texture colour by way of multiply
-							__m128 colour = _mm_mul_ps(currentColourf, textureColour);
-
-							// Multiply by 255.0f
-							colour = _mm_mul_ps(colour, twofivefive);
-
-							// Clamp to 255.0f
-							colour = _mm_min_ps(colour, twofivefive);
-
-							f = colour.m128_f32[0];						// Prepare float for conversion
-							__asm fld f									// Push it onto the FLU stack
-							__asm fistp i1								// Magic it to an int
-
-							f = colour.m128_f32[1];
-							__asm fld f
-							__asm fistp i2
-
-							f = colour.m128_f32[2];
-							__asm fld f
-							__asm fistp i3
-#else
-							Colour colour = currentC;
-
-							// Calculate perspective-correct U and V
-							tU = (int)(UOZ / OOZ);
-							tV = (int)(VOZ / OOZ);
-							
-							if (tU < 0)
-								tU = 0;
-							if (tV < 0)
-								tV = 0;
-							if (tU >= textures[0].getWidth())
-								tU = textures[0].getWidth() - 1;
-							if (tV >= textures[0].getHeight())
-								tV = textures[0].getHeight() - 1;
-
-							unsigned char* texture = (unsigned char*)&textures[0].getData()[(tV * textures[0].getWidth()) + tU];
-							Colour textureColour(texture[2], texture[1], texture[0]);
-							textureColour /= 255.0f;
-
-							colour *= textureColour;
-							colour *= 255.0f;
-							colour.clamp(255.0f);
-
-							i1 = (int)colour._b;
-							i2 = (int)colour._g;
-							i3 = (int)colour._r;
-#endif
-#endif
-
-							((unsigned char*)&buffer[x])[0] = i1;
-							((unsigned char*)&buffer[x])[1] = i2;
-							((unsigned char*)&buffer[x])[2] = i3;
-						}
-					}
-
-					// Increment values in x
-					check1Temp -= fdx1;
-					check2Temp -= fdx2;
-					check3Temp -= fdx3;
-
-#ifdef SSE
-					currentColourf = _mm_add_ps(currentColourf, dxcf);
-					UVf = _mm_add_ps(UVf, dxUVf);
-#else
-					currentC += dxC;
-
-					z += dxZ;
-
-					// Interpolate u/z, v/z and 1/z
-					UOZ += dxUOZ;
-					VOZ += dxVOZ;
-					OOZ += dxOOZ;
-#endif
+					_stats[0].occludedTriangles++;
 				}
+				else
+				{
+					_bins[tile].push_back(index);
+					binned = true;
+				}
+			}
+		}
 
-				buffer += _width;
-				depthBuffer += _width;
+		if (!binned)
+			_triangles.pop_back();
 
-				// Increment values in y
+		if (_triangles.size() >= MAX_QUEUED_TRIANGLES)
+			flush();
+	}
 
-				check1 += fdy1;
-				check2 += fdy2;
-				check3 += fdy3;
+	/*
+	 * Keeps a Phong triangle to be lit by endScene, and queues a VISIBILITY triangle in its place
+	 * which draws its depth and index to the visibility buffer
+	 */
+	void Rasteriser::submitDeferred(const TriangleSetup& t)
+	{
+		// Anything drawn before now has nothing deferred underneath it
+		if (!_idBufferInUse)
+		{
+			std::fill_n(_idBuffer, _bufferWidth * _bufferHeight, 0);
+			_idBufferInUse = true;
+		}
 
+		_deferredTriangles.push_back(t);
 
-#ifdef SSE
-				colourf = _mm_add_ps(colourf, dycf);
-				initialUVf = _mm_add_ps(initialUVf, dyUVf);
-#else
-				initialC += dyC;
+		TriangleSetup visibility = t;
+		visibility.type = TriangleTypes::VISIBILITY;
+		visibility.id = _deferredTriangles.size();
 
-				initialZ += dyZ;
+		submit(visibility);
+	}
+
+	/*
+	 * Returns a copy of a light list that lasts until the end of the scene, as the caller may change it before then
+	 * Consecutive triangles usually come from the same draw, so they share a copy, and a copy given back
+	 * is kept as it is
+	 */
+	const LightList* Rasteriser::keepLights(const LightList& lights)
+	{
+		if (!_keptLights.empty() && &_keptLights.back() == &lights)
+			return &lights;
+
+		if (_keptLights.empty() || _keptLights.back() != lights)
+			_keptLights.push_back(lights);
+
+		return &_keptLights.back();
+	}
+
+	/*
+	 * Rasterises one tile's worth of triangles
+	 * Every tile is owned by a single worker and draws its triangles in submission order,
+	 * so the output doesn't depend on the number of workers
+	 */
+	struct Rasteriser::TileJob
+		: public ThreadPool::Job
+	{
+		TileJob(Rasteriser& rasteriser, const std::vector<int>& tiles, KernelMode mode)
+			: rasteriser(rasteriser), tiles(tiles), mode(mode)
+		{
 
-				initialUOZ += dyUOZ;
-				initialVOZ += dyVOZ;
-				initialOOZ += dyOOZ;
-#endif
-			}
 		}
+
+		virtual void execute(int index, int worker)
+		{
+			rasteriser.rasteriseTile(tiles[index], worker, mode);
+		}
+
+		Rasteriser& rasteriser;
+		const std::vector<int>& tiles;
+		KernelMode mode;
+	};
+
+	/*
+	 * Rasterises all queued triangles across the worker threads
+	 * Triangles kept for a depth pre-pass are left for endScene
+	 */
+	void Rasteriser::flush()
+	{
+		setupBatch();
+
+		if (_depthPrepass || _triangles.empty())
+			return;
+
+		rasteriseBins(KernelModes::DRAW);
+		clearBins();
 	}
-	
+
 	/*
-	 * Draws a triangle and interpolates the normals to generate lighting per pixel
+	 * Rasterises the queued triangles of every tile with the given kernels
 	 */
-	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, const Vertex& cam1, const Vector& n1,
-							float x2f, float y2f, float z2, const Vertex& cam2, const Vector& n2,
-							float x3f, float y3f, float z3, const Vertex& cam3, const Vector& n3, std::vector<Light*>& lights)
+	void Rasteriser::rasteriseBins(KernelMode mode)
 	{
-		if (_pixelBuffer)
+		// Only hand out tiles that have something in them
+		std::vector<int> tiles;
+		for (unsigned int i = 0; i < _bins.size(); ++i)
 		{
-			const int y1 = (int)(16.0f * y1f + 0.5f);
-			const int y2 = (int)(16.0f * y2f + 0.5f);
-			const int y3 = (int)(16.0f * y3f + 0.5f);
-
-			const int x1 = (int)(16.0f * x1f + 0.5f);
-			const int x2 = (int)(16.0f * x2f + 0.5f);
-			const int x3 = (int)(16.0f * x3f + 0.5f);
-
-			// Precalculate half-space function coefficients (so they can be calculated incrementally in the loop)
-			const int dy1 = x1 - x2;
-			const int dy2 = x2 - x3;
-			const int dy3 = x3 - x1;
-
-			const int dx1 = y1 - y2;
-			const int dx2 = y2 - y3;
-			const int dx3 = y3 - y1;
-			
-			const int fdx1 = dx1 << 4;
-			const int fdx2 = dx2 << 4;
-			const int fdx3 = dx3 << 4;
-			
-			const int fdy1 = dy1 << 4;
-			const int fdy2 = dy2 << 4;
-			const int fdy3 = dy3 << 4;
-
-			// Work out min and max X and Y
-			int minX = (min((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int maxX = (max((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int minY = (min((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-			int maxY = (max((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-
-			// Make sure it's not outside of the screen
-			if (minX < 0)
-				minX = 0;
-			if (minY < 0)
-				minY = 0;
-			if (maxX >= _width)
-				maxX = _width - 1;
-			if (maxY >= _height)
-				maxY = _height - 1;
-			
-			// Calculate half-space initial values
-			int check1 = (int)((dy1 * (minY << 4)) - (dy1 * y1) - (dx1 * (minX << 4)) + (dx1 * x1));
-			int check2 = (int)((dy2 * (minY << 4)) - (dy2 * y2) - (dx2 * (minX << 4)) + (dx2 * x2));
-			int check3 = (int)((dy3 * (minY << 4)) - (dy3 * y3) - (dx3 * (minX << 4)) + (dx3 * x3));
-
-			// Extend values if required for fill convention purposes
-			if (dx1 < 0 || (dx1 == 0 && dy1 > 0))
-				check1++;
-			if (dx2 < 0 || (dx2 == 0 && dy2 > 0))
-				check2++;
-			if (dx3 < 0 || (dx3 == 0 && dy3 > 0)) 
-				check3++;
-
-			// Calculate initial normals
-			Vector dxN;
-			Vector dyN;
-			Vector initialN = calculateInterpolants((float)minX, (float)minY, x1f, y1f, n1,
-													x2f, y2f, n2, x3f, y3f, n3, &dxN, &dyN);
-
-			// The same for z-coordinate for z-buffering
-			float dxZ;
-			float dyZ;
-			float initialZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, z1,
-													x2f, y2f, z2, x3f, y3f, z3, &dxZ, &dyZ);
-
-			// Also camera space z needs to be interpolated for perspective correct textures/lighting
-			// Camera-space z is too imprecise for z-buffering :<
-			Vertex dxCam;
-			Vertex dyCam;
-			Vertex initialCam = calculateInterpolants((float)minX, (float)minY, x1f, y1f, cam1,
-													x2f, y2f, cam2, x3f, y3f, cam3, &dxCam, &dyCam);
-						
-#ifdef SSE
-			// Load interpolants __m128s for fast floating point addition
-			__m128 normalf = { initialN.getX(), initialN.getY(), initialN.getZ(), initialZ };
-			__m128 dxnf = { dxN.getX(), dxN.getY(), dxN.getZ(), dxZ };
-			__m128 dynf = { dyN.getX(), dyN.getY(), dyN.getZ(), dyZ };
-
-			// Temporary vector to store normal for calculations
-			Vector currentNormal;
-#endif
-
-			// Calculate address offset of initial position in buffer
-			unsigned int* buffer = (unsigned int*)_pixelBuffer + minY * _width;
-			float* depthBuffer = _depthBuffer + minY * _width;
-
-			// Temporary vertex to store position for calculations
-			Vertex currentPosition;
-
-			for (int y = minY; y < maxY; y++)
-			{
-				// Create temporary copies of our incremental values because they'll be needed in the next iteration
-				int check1Temp = check1;
-				int check2Temp = check2;
-				int check3Temp = check3;
-				
-				float z;
-				Vertex camSpacePos = initialCam;
-#ifdef SSE
-				__m128 currentNormalf = normalf;
-#else
-				z = initialZ;
-				Vector currentNormal = initialN;
-#endif
-
-				for (int x = minX; x < maxX; x++)
-				{
-					if (check1Temp > 0 &&
-						check2Temp > 0 &&
-						check3Temp > 0)
-					{
-#ifdef SSE
-						z = currentNormalf.m128_f32[3];
-#endif
-						// If on top of screen
-						if (depthBuffer[x] >= z)
-						{						
-							depthBuffer[x] = z;
-							
-#ifdef SSE
-							currentNormal.setX(currentNormalf.m128_f32[0]);
-							currentNormal.setY(currentNormalf.m128_f32[1]);
-							currentNormal.setZ(currentNormalf.m128_f32[2]);
-#endif
-
-							Colour c = md2::MD2_Model::calculateLights(camSpacePos, currentNormal, lights);
-
-							int i1;
-							int i2;
-							int i3;
-
-#ifdef SSE
-							__m128 colours = { c._b, c._g, c._r, 0 };
-#endif
-
-#ifdef SSE2
-							// Scale the values to the range 0 .. 255.0f
-							static const __m128 twofivefive = { 255.0f, 255.0f, 255.0f, 255.0f };
-							__m128 colour = _mm_mul_ps(colours, twofivefive);
-
-							// Convert our floating point colours to 32-bit integers
-							__m128i intsOut = _mm_cvtps_epi32(colour);
-
-							// Get the low-order bytes of each component
-							i1 = intsOut.m128i_i8[0];
-							i2 = intsOut.m128i_i8[4];
-							i3 = intsOut.m128i_i8[8];
-#else
-#ifdef SSE
-							// Scale the values to the range 0 .. 255.0f
-							static const __m128 twofivefive = { 255.0f, 255.0f, 255.0f, 255.0f };
-							__m128 colour = _mm_mul_ps(colours, twofivefive);
-
-							float f = colour.m128_f32[0];		// Prepare float for conversion
-							__asm fld f									// Push it onto the FLU stack
-							__asm fistp i1								// Magic it to an int
-
-							f = colour.m128_f32[1];
-							__asm fld f
-							__asm fistp i2
-
-							f = colour.m128_f32[2];
-							__asm fld f
-							__asm fistp i3
-#else
-							// Scale the values to the range 0 .. 255.0f
-							i1 = (int)(c._b * 255.0f);
-							i2 = (int)(c._g * 255.0f);
-							i3 = (int)(c._r * 255.0f);
-#endif
-#endif
-
-							((unsigned char*)&buffer[x])[0] = i1;
-							((unsigned char*)&buffer[x])[1] = i2;
-							((unsigned char*)&buffer[x])[2] = i3;
-						}
-					}
-
-					// Increment values in x
-					check1Temp -= fdx1;
-					check2Temp -= fdx2;
-					check3Temp -= fdx3;
-
-					camSpacePos += dxCam;
-
-#ifdef SSE
-					currentNormalf = _mm_add_ps(currentNormalf, dxnf);
-#else
-					currentNormal += dxN;
-					z += dxZ;
-#endif
-				}
+			if (!_bins[i].empty())
+				tiles.push_back(i);
+		}
+
+		TileJob job(*this, tiles, mode);
+		_workers.run(job, tiles.size());
+	}
+
+	void Rasteriser::clearBins()
+	{
+		_triangles.clear();
+		for (unsigned int i = 0; i < _bins.size(); ++i)
+			_bins[i].clear();
+	}
+
+	/*
+	 * Draws the depth of every triangle kept for the pre-pass, then shades each of them only where
+	 * it's what ended up in the depth buffer
+	 */
+	void Rasteriser::drawPrepass()
+	{
+		setupBatch();
+
+		if (_triangles.empty())
+			return;
 
-				buffer += _width;
-				depthBuffer += _width;
+		if (_prepassIds == 0)
+			_prepassIds = (unsigned int*)_prepassStorage.allocate(_bufferWidth * _bufferHeight * sizeof(unsigned int));
 
-				// Increment values in y
+		rasteriseBins(KernelModes::DEPTH_ONLY);
+		rasteriseBins(KernelModes::DEPTH_EQUAL);
+		clearBins();
+	}
 
-				check1 += fdy1;
-				check2 += fdy2;
-				check3 += fdy3;
+	void Rasteriser::rasteriseTile(int tile, int worker, KernelMode mode)
+	{
+		RasterTarget target;
+		target.pixels = _colourBuffer;
+		target.depth = _depthBuffer;
+		target.layout = _layout;
+		target.width = _bufferWidth;
+		target.ids = (_idBufferInUse ? _idBuffer : 0);
+		target.prepassIds = (mode != KernelModes::DRAW ? _prepassIds : 0);
+		target.clipMinX = (tile % _tilesX) * TILE_SIZE;
+		target.clipMinY = (tile / _tilesX) * TILE_SIZE;
+		target.clipMaxX = min(target.clipMinX + TILE_SIZE, _width);
+		target.clipMaxY = min(target.clipMinY + TILE_SIZE, _height);
+		target.blockSize = _blockSize;
+		target.hiZ = &_hiZ[0];
+		target.hiZDirty = &_hiZDirty[0];
+		target.hiZWidth = _hiZWidth;
+		target.clipDepth = &_tileDepth[tile];
+		target.stats = &_stats[worker];
+
+		// The tile belongs to this worker, so it's cleared here where it's about to be drawn to
+		clearTile(tile);
+
+		if (mode == KernelModes::DEPTH_ONLY)
+			clearPrepassIds(tile);
+
+		const RasteriseFunction* kernels = _kernels->kernels[_depthFormat][mode];
+		const RasteriseFunction* smallKernels = _kernels->smallKernels[_depthFormat][mode];
+		const std::vector<unsigned int>& bin = _bins[tile];
+
+		// Phong triangles whose lights have ranges are lit with those reaching the tile, by a copy
+		// of the triangle pointing at them
+		unsigned int culledLists = 0;
+		TriangleSetup culled;
+
+		for (unsigned int i = 0; i < bin.size(); ++i)
+		{
+			const TriangleSetup* t = &_triangles[bin[i]];
 
-				initialCam += dyCam;
+			if (mode != KernelModes::DEPTH_ONLY && (t->type == TriangleTypes::PHONG || t->type == TriangleTypes::PHONG_TEXTURED)
+				&& (t->lights->getShape() & LightList::ATTENUATED) != 0)
+			{
+				culled = *t;
+				culled.lights = cullLights(tile, worker, i, culledLists);
+				t = &culled;
+			}
 
-#ifdef SSE
-				normalf = _mm_add_ps(normalf, dynf);
-#else
-				initialN += dyN;
-				initialZ += dyZ;
-#endif
+			if (t->type >= TriangleTypes::PROGRAM)
+			{
+				const int textured = t->type - TriangleTypes::PROGRAM;
+				const ProgramKernelTable& program = (t->programKernels != 0 ? *t->programKernels
+																		: _kernels->programs[t->programType]);
+
+				if (t->coverage != 0)
+					program.smallKernels[_depthFormat][mode][textured](*t, target);
+				else
+					program.kernels[_depthFormat][mode][textured](*t, target);
 			}
+			else if (t->coverage != 0)
+				smallKernels[t->type](*t, target);
+			else
+				kernels[t->type](*t, target);
 		}
+
+		updateHiZ(tile);
 	}
-	
+
 	/*
-	 * Draws a textured triangle and interpolates the normals to generate lighting per pixel
+	 * Returns the lights of one of a tile's triangles culled down to those reaching the tile's Phong triangles
+	 * lit by them, from that triangle on, which are culled the first time the list is asked for in the tile
+	 * count is how many lists the worker has culled for the tile, which starts at 0
+	 * Camera-space position is interpolated linearly across the screen, so over a triangle's part of the tile
+	 * it stays between its values at the corners, which are taken a pixel further out to allow for rounding
+	 * The box around them bounds the tile's lit pixels in depth as well as across the screen
 	 */
-	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, const Vertex& cam1, float uoz1, float voz1, float zr1, const Vector& n1,
-								float x2f, float y2f, float z2, const Vertex& cam2, float uoz2, float voz2, float zr2, const Vector& n2,
-								float x3f, float y3f, float z3, const Vertex& cam3, float uoz3, float voz3, float zr3, const Vector& n3,
-								unsigned int textureCount, const Image* textures, std::vector<Light*>& lights)
+	const LightList* Rasteriser::cullLights(int tile, int worker, unsigned int first, unsigned int& count)
 	{
-		if (_pixelBuffer)
+		const std::vector<unsigned int>& bin = _bins[tile];
+		const LightList* lights = _triangles[bin[first]].lights;
+
+		const unsigned int culled = count;
+		TileLights& tileLights = _tileLights[worker][findTileLights(worker, lights, count)];
+
+		if (count == culled)
+			return &tileLights.culled;
+
+		const int tileMinX = (tile % _tilesX) * TILE_SIZE;
+		const int tileMinY = (tile / _tilesX) * TILE_SIZE;
+		const int tileMaxX = min(tileMinX + TILE_SIZE, _width);
+		const int tileMaxY = min(tileMinY + TILE_SIZE, _height);
+
+		for (unsigned int i = first; i < bin.size(); ++i)
 		{
-			const int y1 = (int)(16.0f * y1f + 0.5f);
-			const int y2 = (int)(16.0f * y2f + 0.5f);
-			const int y3 = (int)(16.0f * y3f + 0.5f);
-
-			const int x1 = (int)(16.0f * x1f + 0.5f);
-			const int x2 = (int)(16.0f * x2f + 0.5f);
-			const int x3 = (int)(16.0f * x3f + 0.5f);
-
-			// Precalculate half-space function coefficients (so they can be calculated incrementally in the loop)
-			const int dy1 = x1 - x2;
-			const int dy2 = x2 - x3;
-			const int dy3 = x3 - x1;
-
-			const int dx1 = y1 - y2;
-			const int dx2 = y2 - y3;
-			const int dx3 = y3 - y1;
-			
-			const int fdx1 = dx1 << 4;
-			const int fdx2 = dx2 << 4;
-			const int fdx3 = dx3 << 4;
-			
-			const int fdy1 = dy1 << 4;
-			const int fdy2 = dy2 << 4;
-			const int fdy3 = dy3 << 4;
-
-			// Work out min and max X and Y
-			int minX = (min((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int maxX = (max((int)x1, (int)x2, (int)x3) + 0xF) >> 4;
-			int minY = (min((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-			int maxY = (max((int)y1, (int)y2, (int)y3) + 0xF) >> 4;
-
-			// Make sure it's not outside of the screen
-			if (minX < 0)
-				minX = 0;
-			if (minY < 0)
-				minY = 0;
-			if (maxX >= _width)
-				maxX = _width - 1;
-			if (maxY >= _height)
-				maxY = _height - 1;
-			
-			// Calculate half-space initial values
-			int check1 = (int)((dy1 * (minY << 4)) - (dy1 * y1) - (dx1 * (minX << 4)) + (dx1 * x1));
-			int check2 = (int)((dy2 * (minY << 4)) - (dy2 * y2) - (dx2 * (minX << 4)) + (dx2 * x2));
-			int check3 = (int)((dy3 * (minY << 4)) - (dy3 * y3) - (dx3 * (minX << 4)) + (dx3 * x3));
-
-			// Extend values if required for fill convention purposes
-			if (dx1 < 0 || (dx1 == 0 && dy1 > 0))
-				check1++;
-			if (dx2 < 0 || (dx2 == 0 && dy2 > 0))
-				check2++;
-			if (dx3 < 0 || (dx3 == 0 && dy3 > 0)) 
-				check3++;
-
-			// Calculate initial normals
-			Vector dxN;
-			Vector dyN;
-			Vector initialN = calculateInterpolants((float)minX, (float)minY, x1f, y1f, n1,
-													x2f, y2f, n2, x3f, y3f, n3, &dxN, &dyN);
-
-			// The same for z-coordinate for z-buffering
-			float dxZ;
-			float dyZ;
-			float initialZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, z1,
-													x2f, y2f, z2, x3f, y3f, z3, &dxZ, &dyZ);
-
-			// Also camera space z needs to be interpolated for perspective correct textures/lighting
-			// Camera-space z is too imprecise for z-buffering :<
-			Vertex dxCam;
-			Vertex dyCam;
-			Vertex initialCam = calculateInterpolants((float)minX, (float)minY, x1f, y1f, cam1,
-													x2f, y2f, cam2, x3f, y3f, cam3, &dxCam, &dyCam);
-
-			// U / Z interpolation
-			float dxUOZ;
-			float dyUOZ;
-			float initialUOZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, uoz1,
-												x2f, y2f, uoz2, x3f, y3f, uoz3, &dxUOZ, &dyUOZ);
-
-			// V / Z interpolation
-			float dxVOZ;
-			float dyVOZ;
-			float initialVOZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, voz1,
-													x2f, y2f, voz2, x3f, y3f, voz3, &dxVOZ, &dyVOZ);
-
-			// 1 / Z interpolation
-			float dxOOZ;
-			float dyOOZ;
-			float initialOOZ = calculateInterpolants((float)minX, (float)minY, x1f, y1f, zr1,
-													x2f, y2f, zr2, x3f, y3f, zr3, &dxOOZ, &dyOOZ);
-						
-#ifdef SSE
-			// Load interpolants __m128s for fast floating point addition
-			__m128 normalf = { initialN.getX(), initialN.getY(), initialN.getZ(), initialZ };
-			__m128 dxnf = { dxN.getX(), dxN.getY(), dxN.getZ(), dxZ };
-			__m128 dynf = { dyN.getX(), dyN.getY(), dyN.getZ(), dyZ };
-
-			// Load UV interpolants too
-			__m128 initialUVf = { initialUOZ, initialVOZ, initialOOZ, 0 };
-			__m128 dxUVf = { dxUOZ, dxVOZ, dxOOZ, 0 };
-			__m128 dyUVf = { dyUOZ, dyVOZ, dyOOZ, 0 };
-
-			// Temporary vector to store normal for calculations
-			Vector currentNormal;
-#endif
-
-			// Calculate address offset of initial position in buffer
-			unsigned int* buffer = (unsigned int*)_pixelBuffer + minY * _width;
-			float* depthBuffer = _depthBuffer + minY * _width;
-
-			// Temporary vertex to store position for calculations
-			Vertex currentPosition;
-
-			for (int y = minY; y < maxY; y++)
-			{
-				// Create temporary copies of our incremental values because they'll be needed in the next iteration
-				int check1Temp = check1;
-				int check2Temp = check2;
-				int check3Temp = check3;
-				
-				float z;
-				Vertex camSpacePos = initialCam;
-#ifdef SSE
-				__m128 currentNormalf = normalf;
-				__m128 UVf = initialUVf;
-#else
-				z = initialZ;
-				Vector currentNormal = initialN;
-
-				float UOZ = initialUOZ;
-				float VOZ = initialVOZ;
-				float OOZ = initialOOZ;
-#endif
-
-				for (int x = minX; x < maxX; x++)
-				{
-					if (check1Temp > 0 &&
-						check2Temp > 0 &&
-						check3Temp > 0)
-					{
-#ifdef SSE
-						z = currentNormalf.m128_f32[3];
-#endif
-						// If on top of screen
-						if (depthBuffer[x] >= z)
-						{						
-							depthBuffer[x] = z;
-							
-#ifdef SSE
-							currentNormal.setX(currentNormalf.m128_f32[0]);
-							currentNormal.setY(currentNormalf.m128_f32[1]);
-							currentNormal.setZ(currentNormalf.m128_f32[2]);
-#endif
-
-							Colour currentC = md2::MD2_Model::calculateLights(camSpacePos, currentNormal, lights);
-
-							int i1;
-							int i2;
-							int i3;
-
-							int tU;
-							int tV;
-
-#ifdef SSE
-							__m128 currentColourf = { currentC._b, currentC._g, currentC._r, 0 };
-#endif
-
-#ifdef SSE2
-							// Calculate perspective-correct texture coordinates
-							float f;
-
-							f = UVf.m128_f32[0] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tU
-							
-							f = UVf.m128_f32[1] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tV
-							
-							if (tU < 0)
-								tU = 0;
-							if (tV < 0)
-								tV = 0;
-							if (tU >= textures[0].getWidth())
-								tU = textures[0].getWidth() - 1;
-							if (tV >= textures[0].getHeight())
-								tV = textures[0].getHeight() - 1;
-
-							// Get texture colour at current (U,V) and multiply with light colour
-							unsigned char* texture = (unsigned char*)&textures[0].getData()[(tV * textures[0].getWidth()) + tU];
-							__m128 textureColour = { texture[0], texture[1], texture[2], 0 };
-
-							// Scale it to the range 0 .. 1.0f
-							static const __m128 twofivefive = { 255.0f, 255.0f, 255.0f, 255.0f };
-							textureColour = _mm_div_ps(textureColour, twofivefive);
-
-							// Multiply with light colour
-							__m128 colour = _mm_mul_ps(currentColourf, textureColour);
-
-							// Multiply by 255.0f
-							colour = _mm_mul_ps(colour, twofivefive);
-
-							// Clamp to 255.0f
-							colour = _mm_min_ps(colour, twofivefive);
-
-							// Convert our floating point colours to 32-bit integers
-							__m128i intsOut = _mm_cvtps_epi32(colour);
-
-							// Get the low-order bytes of each component
-							i1 = intsOut.m128i_i8[0];
-							i2 = intsOut.m128i_i8[4];
-							i3 = intsOut.m128i_i8[8];
-
-#else
-#ifdef SSE
-							// Calculate perspective-correct texture coordinates
-							float f;
-
-							f = UVf.m128_f32[0] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tU
-							
-							f = UVf.m128_f32[1] / UVf.m128_f32[2];
-							__asm fld f
-							__asm fistp tV
-							
-							if (tU < 0)
-								tU = 0;
-							if (tV < 0)
-								tV = 0;
-							if (tU >= textures[0].getWidth())
-								tU = textures[0].getWidth() - 1;
-							if (tV >= textures[0].getHeight())
-								tV = textures[0].getHeight() - 1;
-
-							// Get texture colour at current (U,V) and multiply with light colour
-							unsigned char* texture = (unsigned char*)&textures[0].getData()[(tV * textures[0].getWidth()) + tU];
-							__m128 textureColour = { texture[0], texture[1], texture[2], 0 };
-
-							// Scale it to the range 0 .. 1.0f
-							static const __m128 twofivefive = { 255.0f, 255.0f, 255.0f, 255.0f };
-							textureColour = _mm_div_ps(textureColour, twofivefive);
-
-							// Blend them by way of multiply
-							__m128 colour = _mm_mul_ps(currentColourf, textureColour);
-
-							// Multiply by 255.0f
-							colour = _mm_mul_ps(colour, twofivefive);
-
-							// Clamp to 255.0f
-							colour = _mm_min_ps(colour, twofivefive);
-
-							f = colour.m128_f32[0];						// Prepare float for conversion
-							__asm fld f									// Push it onto the FLU stack
-							__asm fistp i1								// Magic it to an int
-
-							f = colour.m128_f32[1];
-							__asm fld f
-							__asm fistp i2
-
-							f = colour.m128_f32[2];
-							__asm fld f
-							__asm fistp i3
-#else
-							Colour colour = currentC;
-
-							// Calculate perspective-correct U and V
-							tU = (int)(UOZ / OOZ);
-							tV = (int)(VOZ / OOZ);
-							
-							if (tU < 0)
-								tU = 0;
-							if (tV < 0)
-								tV = 0;
-							if (tU >= textures[0].getWidth())
-								tU = textures[0].getWidth() - 1;
-							if (tV >= textures[0].getHeight())
-								tV = textures[0].getHeight() - 1;
-
-							unsigned char* texture = (unsigned char*)&textures[0].getData()[(tV * textures[0].getWidth()) + tU];
-							Colour textureColour(texture[2], texture[1], texture[0]);
-							textureColour /= 255.0f;
-
-							colour *= textureColour;
-							colour *= 255.0f;
-							colour.clamp(250.0f);
-
-							i1 = (int)colour._b;
-							i2 = (int)colour._g;
-							i3 = (int)colour._r;
-#endif
-#endif
-
-							((unsigned char*)&buffer[x])[0] = i1;
-							((unsigned char*)&buffer[x])[1] = i2;
-							((unsigned char*)&buffer[x])[2] = i3;
-						}
-					}
-
-					// Increment values in x
-					check1Temp -= fdx1;
-					check2Temp -= fdx2;
-					check3Temp -= fdx3;
-
-					camSpacePos += dxCam;
-
-#ifdef SSE
-					currentNormalf = _mm_add_ps(currentNormalf, dxnf);
-					UVf = _mm_add_ps(UVf, dxUVf);
-#else
-					currentNormal += dxN;
-					z += dxZ;
-
-					// Interpolate u/z, v/z and 1/z
-					UOZ += dxUOZ;
-					VOZ += dxVOZ;
-					OOZ += dxOOZ;
-#endif
-				}
+			const TriangleSetup& t = _triangles[bin[i]];
 
-				buffer += _width;
-				depthBuffer += _width;
+			if (t.lights != lights || (t.type != TriangleTypes::PHONG && t.type != TriangleTypes::PHONG_TEXTURED))
+				continue;
 
-				// Increment values in y
+			// Corners relative to (minX, minY), where the interpolants are given
+			const float x0 = (float)(max(t.minX, tileMinX) - t.minX - 1);
+			const float y0 = (float)(max(t.minY, tileMinY) - t.minY - 1);
+			const float x1 = (float)(min(t.maxX, tileMaxX) - t.minX);
+			const float y1 = (float)(min(t.maxY, tileMaxY) - t.minY);
 
-				check1 += fdy1;
-				check2 += fdy2;
-				check3 += fdy3;
+			for (int j = 0; j < 3; ++j)
+			{
+				const Interpolant& position = t.attributes[3 + j];
 
-				initialCam += dyCam;
+				const float top = position.value + position.dy * y0;
+				const float bottom = position.value + position.dy * y1;
 
-#ifdef SSE
-				normalf = _mm_add_ps(normalf, dynf);
-				initialUVf = _mm_add_ps(initialUVf, dyUVf);
-#else
-				initialN += dyN;
-				initialZ += dyZ;
+				const float corners[4] = { top + position.dx * x0, top + position.dx * x1,
+											bottom + position.dx * x0, bottom + position.dx * x1 };
 
-				initialUOZ += dyUOZ;
-				initialVOZ += dyVOZ;
-				initialOOZ += dyOOZ;
-#endif
+				for (int k = 0; k < 4; ++k)
+				{
+					tileLights.boxMin[j] = min(tileLights.boxMin[j], corners[k]);
+					tileLights.boxMax[j] = max(tileLights.boxMax[j], corners[k]);
+				}
 			}
 		}
+
+		cullTileLights(worker, tileLights);
+
+		return &tileLights.culled;
+	}
+
+	/*
+	 * Returns which of the first count lists a worker has for its tile is for lights, adding one for them
+	 * with an empty box if none is
+	 */
+	unsigned int Rasteriser::findTileLights(int worker, const LightList* lights, unsigned int& count)
+	{
+		std::vector<TileLights>& tileLights = _tileLights[worker];
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			if (tileLights[i].lights == lights)
+				return i;
+		}
+
+		if (count == tileLights.size())
+			tileLights.push_back(TileLights());
+
+		TileLights& added = tileLights[count];
+		added.lights = lights;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			added.boxMin[i] = std::numeric_limits<float>::infinity();
+			added.boxMax[i] = -std::numeric_limits<float>::infinity();
+		}
+
+		return count++;
+	}
+
+	/*
+	 * Culls one of a worker's tile light lists to its box
+	 */
+	void Rasteriser::cullTileLights(int worker, TileLights& tileLights)
+	{
+		const int culled = tileLights.culled.cull(*tileLights.lights, tileLights.boxMin, tileLights.boxMax);
+
+		_stats[worker].tileLights += tileLights.culled.getPointLights().getCount() + tileLights.culled.getSpotlights().getCount();
+		_stats[worker].culledLights += culled;
+	}
+
+	/*
+	 * Reading each depth format back for the hierarchical depth buffer
+	 * Values are compared as they're stored and then turned into a depth; for the fixed-point formats
+	 * that's the furthest depth that could have been rounded to the value, and the cleared value is
+	 * behind everything
+	 * Reversed depth is read negated, so the furthest is still the largest (see RasterTarget)
+	 */
+	struct FloatDepthReader
+	{
+		typedef float Value;
+
+		static Value read(const unsigned char* row, int i)
+		{
+			return ((const float*)row)[i];
+		}
+
+		static Value lowest()
+		{
+			return -std::numeric_limits<float>::infinity();
+		}
+
+		static float toDepth(Value value)
+		{
+			return value;
+		}
+	};
+
+	struct ReversedFloatDepthReader
+		: FloatDepthReader
+	{
+		static Value read(const unsigned char* row, int i)
+		{
+			return -((const float*)row)[i];
+		}
+	};
+
+	struct Unorm16DepthReader
+	{
+		typedef int Value;
+
+		static Value read(const unsigned char* row, int i)
+		{
+			return ((const unsigned short*)row)[i];
+		}
+
+		static Value lowest()
+		{
+			return -1;
+		}
+
+		static float toDepth(Value value)
+		{
+			return (value == 0xFFFF ? std::numeric_limits<float>::infinity() : (value + 1) / 65535.0f);
+		}
+	};
+
+	struct Unorm24DepthReader
+	{
+		typedef int Value;
+
+		static Value read(const unsigned char* row, int i)
+		{
+			return row[i * 3] | (row[i * 3 + 1] << 8) | (row[i * 3 + 2] << 16);
+		}
+
+		static Value lowest()
+		{
+			return -1;
+		}
+
+		static float toDepth(Value value)
+		{
+			return (value == 0xFFFFFF ? std::numeric_limits<float>::infinity() : (value + 1) / 16777215.0f);
+		}
+	};
+
+	/*
+	 * Returns the furthest depth in a cell of the depth buffer, pitch bytes to a row, which is cut short
+	 * where it meets the edge of the screen
+	 * Whole cells are worked through a column of HI_Z_SIZE lanes at a time so the compiler can vectorise it
+	 */
+	template <class Reader>
+	float getCellDepth(const unsigned char* depth, int pitch, int cellWidth, int cellHeight)
+	{
+		typedef typename Reader::Value Value;
+
+		const int SIZE = RasterTarget::HI_Z_SIZE;
+
+		Value lanes[SIZE];
+		for (int i = 0; i < SIZE; ++i)
+			lanes[i] = Reader::lowest();
+
+		if (cellWidth == SIZE)
+		{
+			for (int y = 0; y < cellHeight; ++y)
+			{
+				const unsigned char* row = depth + y * pitch;
+
+				for (int i = 0; i < SIZE; ++i)
+				{
+					const Value value = Reader::read(row, i);
+					lanes[i] = (value > lanes[i] ? value : lanes[i]);
+				}
+			}
+		}
+		else
+		{
+			for (int y = 0; y < cellHeight; ++y)
+			{
+				const unsigned char* row = depth + y * pitch;
+
+				for (int i = 0; i < cellWidth; ++i)
+				{
+					const Value value = Reader::read(row, i);
+					lanes[i] = (value > lanes[i] ? value : lanes[i]);
+				}
+			}
+		}
+
+		Value result = lanes[0];
+		for (int i = 1; i < SIZE; ++i)
+			result = (lanes[i] > result ? lanes[i] : result);
+
+		return Reader::toDepth(result);
+	}
+
+	/*
+	 * Returns the furthest depth in a cell of a depth buffer of the given format
+	 */
+	float getCellDepth(DepthFormat format, const unsigned char* depth, int pitch, int cellWidth, int cellHeight)
+	{
+		switch (format)
+		{
+		case DepthFormats::UNORM16:
+			return getCellDepth<Unorm16DepthReader>(depth, pitch, cellWidth, cellHeight);
+		case DepthFormats::UNORM24:
+			return getCellDepth<Unorm24DepthReader>(depth, pitch, cellWidth, cellHeight);
+		case DepthFormats::REVERSED_FLOAT32:
+			return getCellDepth<ReversedFloatDepthReader>(depth, pitch, cellWidth, cellHeight);
+		default:
+			return getCellDepth<FloatDepthReader>(depth, pitch, cellWidth, cellHeight);
+		}
+	}
+
+	/*
+	 * Brings the cells of the hierarchical depth buffer a tile's triangles drew to up to date,
+	 * along with the tile's furthest depth
+	 * Depths only ever get nearer, so the cells are conservative in the meantime
+	 */
+	void Rasteriser::updateHiZ(int tile)
+	{
+		const int SIZE = RasterTarget::HI_Z_SIZE;
+
+		const int tileX = (tile % _tilesX) * TILE_SIZE;
+		const int tileY = (tile / _tilesX) * TILE_SIZE;
+		const int tileMaxX = min(tileX + TILE_SIZE, _width);
+		const int tileMaxY = min(tileY + TILE_SIZE, _height);
+
+		const int depthSize = getDepthFormatSize(_depthFormat);
+		const int pitch = (_layout == FramebufferLayouts::TILED ? LAYOUT_TILE_WIDTH : _bufferWidth) * depthSize;
+
+		float tileDepth = -std::numeric_limits<float>::infinity();
+
+		for (int y = tileY; y < tileMaxY; y += SIZE)
+		{
+			for (int x = tileX; x < tileMaxX; x += SIZE)
+			{
+				const int cell = (y / SIZE) * _hiZWidth + x / SIZE;
+
+				if (_hiZDirty[cell])
+				{
+					// Cells never straddle the tiles of the TILED layout
+					const int offset = getPixelOffset(_layout, _bufferWidth, x, y);
+
+					_hiZ[cell] = getCellDepth(_depthFormat, _depthBuffer + offset * depthSize, pitch,
+												min(SIZE, tileMaxX - x), min(SIZE, tileMaxY - y));
+					_hiZDirty[cell] = 0;
+				}
+
+				tileDepth = max(tileDepth, _hiZ[cell]);
+			}
+		}
+
+		_tileDepth[tile] = tileDepth;
+	}
+
+	/*
+	 * Finishes the target's pixels in a row of tiles
+	 */
+	struct Rasteriser::FinishJob
+		: public ThreadPool::Job
+	{
+		FinishJob(Rasteriser& rasteriser)
+			: rasteriser(rasteriser)
+		{
+
+		}
+
+		virtual void execute(int index, int /* worker */)
+		{
+			rasteriser.finishTileRow(index);
+		}
+
+		Rasteriser& rasteriser;
+	};
+
+	/*
+	 * Clears the target's colour in the tiles of a row of tiles still waiting for it, filling runs of neighbouring
+	 * tiles together so the fills are as long as they can be, and copies the rest of the row out of a TILED
+	 * colour buffer
+	 * The depth of tiles left waiting is left, since nothing will read it before the next scene clears it again
+	 */
+	void Rasteriser::finishTileRow(int row)
+	{
+		const int tileY = row * TILE_SIZE;
+		const int tileMaxY = min(tileY + TILE_SIZE, _height);
+
+		unsigned char* clears = &_tileClears[row * _tilesX];
+
+		int tile = 0;
+		while (tile < _tilesX)
+		{
+			if (!(clears[tile] & CLEAR_COLOUR))
+			{
+				if (_layout == FramebufferLayouts::TILED)
+					copyTile(row * _tilesX + tile);
+
+				tile++;
+				continue;
+			}
+
+			const int first = tile;
+			while (tile < _tilesX && (clears[tile] & CLEAR_COLOUR))
+				clears[tile++] &= ~CLEAR_COLOUR;
+
+			const int minX = first * TILE_SIZE;
+			const int maxX = min(tile * TILE_SIZE, _width);
+
+			for (int y = tileY; y < tileMaxY; ++y)
+				std::fill_n(_pixelBuffer + y * _width + minX, maxX - minX, _clearColour);
+		}
+	}
+
+	/*
+	 * Copies a tile of a TILED colour buffer into the target, a row of a layout tile at a time
+	 */
+	void Rasteriser::copyTile(int tile)
+	{
+		const int tileX = (tile % _tilesX) * TILE_SIZE;
+		const int tileY = (tile / _tilesX) * TILE_SIZE;
+		const int tileMaxX = min(tileX + TILE_SIZE, _width);
+		const int tileMaxY = min(tileY + TILE_SIZE, _height);
+
+		for (int y = tileY; y < tileMaxY; ++y)
+		{
+			for (int x = tileX; x < tileMaxX; x += LAYOUT_TILE_WIDTH)
+			{
+				const int count = min(LAYOUT_TILE_WIDTH, tileMaxX - x);
+				const unsigned int* source = _colourBuffer + getPixelOffset(_layout, _bufferWidth, x, y);
+
+				std::copy(source, source + count, (unsigned int*)_pixelBuffer + y * _width + x);
+			}
+		}
+	}
+
+	/*
+	 * Lights the pixels of a tile's worth of the visibility buffer
+	 */
+	struct Rasteriser::ResolveJob
+		: public ThreadPool::Job
+	{
+		ResolveJob(Rasteriser& rasteriser)
+			: rasteriser(rasteriser)
+		{
+
+		}
+
+		virtual void execute(int index, int worker)
+		{
+			rasteriser.resolveTile(index, worker);
+		}
+
+		Rasteriser& rasteriser;
+	};
+
+	/*
+	 * Draws anything kept for a depth pre-pass, then lights the pixels covered by deferred triangles
+	 * once each, after everything has been drawn
+	 * Anything drawn after this is drawn as usual until the next deferred or kept triangle
+	 */
+	void Rasteriser::endScene()
+	{
+		if (_depthPrepass)
+			drawPrepass();
+		else
+			flush();
+
+		if (_idBufferInUse)
+		{
+			ResolveJob job(*this);
+			_workers.run(job, _tilesX * _tilesY);
+
+			_idBufferInUse = false;
+			_deferredTriangles.clear();
+		}
+
+		FinishJob job(*this);
+		_workers.run(job, _tilesY);
+
+		_keptLights.clear();
+	}
+
+	/*
+	 * Lights a pixel of a deferred Phong triangle the same way the span kernel would have,
+	 * rebuilding its normal, camera-space position and texture coordinates from the triangle's interpolants
+	 */
+	unsigned int shadeDeferred(const TriangleSetup& t, const LightList& lights, int x, int y)
+	{
+		const float offsetX = (float)(x - t.minX);
+		const float offsetY = (float)(y - t.minY);
+
+		const int attributeCount = (t.type == TriangleTypes::PHONG_TEXTURED ? 9 : 6);
+
+		float attributes[TriangleSetup::MAX_ATTRIBUTES];
+		for (int i = 0; i < attributeCount; ++i)
+			attributes[i] = t.attributes[i].value + t.attributes[i].dx * offsetX + t.attributes[i].dy * offsetY;
+
+		Vector normal(attributes[0], attributes[1], attributes[2]);
+		Vector position(attributes[3], attributes[4], attributes[5]);
+
+		Colour c = lights.calculate(position, normal);
+
+		float b = c._b * 255.0f;
+		float g = c._g * 255.0f;
+		float r = c._r * 255.0f;
+
+		if (t.type == TriangleTypes::PHONG_TEXTURED)
+		{
+			const float u = attributes[6] / attributes[8];
+			const float v = attributes[7] / attributes[8];
+
+			int texel;
+			if (t.sampler.getMipmapMode() == MipmapModes::GROUP)
+				texel = t.sampler.getLevelSampler(t.getTextureLevel(6, (float)x, (float)y)).sample(u, v);
+			else
+				texel = t.sampler.sample(u, v);
+
+			// Multiply with the texel and clamp to 255.0f
+			b = min(c._b * ((texel & 0xFF) / 255.0f) * 255.0f, 255.0f);
+			g = min(c._g * (((texel >> 8) & 0xFF) / 255.0f) * 255.0f, 255.0f);
+			r = min(c._r * (((texel >> 16) & 0xFF) / 255.0f) * 255.0f, 255.0f);
+		}
+
+		return ((int)(b + 0.5f) & 0xFF) | (((int)(g + 0.5f) & 0xFF) << 8) | (((int)(r + 0.5f) & 0xFF) << 16);
+	}
+
+	void Rasteriser::resolveTile(int tile, int worker)
+	{
+		const int tileX = (tile % _tilesX) * TILE_SIZE;
+		const int tileY = (tile / _tilesX) * TILE_SIZE;
+		const int tileMaxX = min(tileX + TILE_SIZE, _width);
+		const int tileMaxY = min(tileY + TILE_SIZE, _height);
+
+		unsigned int* pixels = _colourBuffer;
+		unsigned int resolved = 0;
+
+		// Triangles whose lights have ranges are lit with those reaching the camera-space positions resolved
+		// in the tile, so each of their lists is culled once to a box around the positions lit by it
+		std::vector<TileLights>& tileLights = _tileLights[worker];
+		unsigned int culledLists = 0;
+
+		for (int y = tileY; y < tileMaxY; ++y)
+		{
+			for (int x = tileX; x < tileMaxX; ++x)
+			{
+				const unsigned int id = _idBuffer[getPixelOffset(_layout, _bufferWidth, x, y)];
+
+				if (id == 0 || (_deferredTriangles[id - 1].lights->getShape() & LightList::ATTENUATED) == 0)
+					continue;
+
+				const TriangleSetup& t = _deferredTriangles[id - 1];
+				TileLights& lights = tileLights[findTileLights(worker, t.lights, culledLists)];
+
+				const float offsetX = (float)(x - t.minX);
+				const float offsetY = (float)(y - t.minY);
+
+				for (int j = 0; j < 3; ++j)
+				{
+					const Interpolant& position = t.attributes[3 + j];
+					const float value = position.value + position.dx * offsetX + position.dy * offsetY;
+
+					lights.boxMin[j] = min(lights.boxMin[j], value);
+					lights.boxMax[j] = max(lights.boxMax[j], value);
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i < culledLists; ++i)
+			cullTileLights(worker, tileLights[i]);
+
+		for (int y = tileY; y < tileMaxY; ++y)
+		{
+			for (int x = tileX; x < tileMaxX; ++x)
+			{
+				const int i = getPixelOffset(_layout, _bufferWidth, x, y);
+				const unsigned int id = _idBuffer[i];
+
+				if (id == 0)
+					continue;
+
+				const TriangleSetup& t = _deferredTriangles[id - 1];
+				const LightList* lights = t.lights;
+
+				if ((lights->getShape() & LightList::ATTENUATED) != 0)
+					lights = &tileLights[findTileLights(worker, lights, culledLists)].culled;
+
+				// Keep whatever alpha is already in the buffer
+				pixels[i] = shadeDeferred(t, *lights, x, y) | (pixels[i] & 0xFF000000);
+				resolved++;
+			}
+		}
+
+		_stats[worker].resolvedPixels += resolved;
+	}
+
+	/*
+	 * Draws Phong triangles to the visibility buffer and lights them in endScene, instead of lighting
+	 * every pixel that passes the depth test as it's drawn
+	 * The light lists given for them are copied, so they can change before then
+	 */
+	void Rasteriser::setDeferredShading(bool deferred)
+	{
+		_deferredShading = deferred;
+	}
+
+	bool Rasteriser::getDeferredShading() const
+	{
+		return _deferredShading;
+	}
+
+	/*
+	 * Keeps triangles until endScene instead of drawing them when they're flushed, then draws all their depths
+	 * with depth-only kernels before shading any of them, so only the pixels left visible are shaded
+	 * This pays off when expensive triangles are drawn over each other; otherwise it's an extra pass
+	 * Lines and pixels are still drawn straight away, under anything kept, and the light lists given for kept
+	 * triangles are copied like deferred ones
+	 * Switching it off draws whatever has been kept so far
+	 */
+	void Rasteriser::setDepthPrepass(bool prepass)
+	{
+		if (prepass == _depthPrepass)
+			return;
+
+		if (_depthPrepass)
+			drawPrepass();
+		else
+			flush();
+
+		_depthPrepass = prepass;
+	}
+
+	bool Rasteriser::getDepthPrepass() const
+	{
+		return _depthPrepass;
+	}
+
+	/*
+	 * Changes the format of the current target's depth buffer, which is reallocated and cleared
+	 * Anything queued or kept for a depth pre-pass is drawn first
+	 */
+	void Rasteriser::setDepthFormat(DepthFormat format)
+	{
+		if (format == _depthFormat)
+			return;
+
+		if (_depthPrepass)
+			drawPrepass();
+		else
+			flush();
+
+		_depthFormat = format;
+
+		if (_depthBuffer != 0)
+		{
+			_depthBuffer = (unsigned char*)_depthStorage.allocate(_bufferWidth * _bufferHeight * getDepthFormatSize(format));
+			clearDepth();
+		}
+	}
+
+	DepthFormat Rasteriser::getDepthFormat() const
+	{
+		return _depthFormat;
+	}
+
+	/*
+	 * Returns the size in bytes of a pixel of a depth format
+	 */
+	int Rasteriser::getDepthFormatSize(DepthFormat format)
+	{
+		switch (format)
+		{
+		case DepthFormats::UNORM16:
+			return 2;
+		case DepthFormats::UNORM24:
+			return 3;
+		default:
+			return 4;
+		}
+	}
+
+	const char* Rasteriser::getDepthFormatName(DepthFormat format)
+	{
+		switch (format)
+		{
+		case DepthFormats::FLOAT32:
+			return "float32";
+		case DepthFormats::REVERSED_FLOAT32:
+			return "reversed float32";
+		case DepthFormats::UNORM16:
+			return "unorm16";
+		case DepthFormats::UNORM24:
+			return "unorm24";
+		default:
+			return "unknown";
+		}
+	}
+
+	/*
+	 * Returns the memory the rasteriser uses for each pixel of its target: the depth buffer, the visibility buffer,
+	 * the hierarchical depth buffer and its dirty flags, a TILED layout's colour buffer and padding, and
+	 * the depth pre-pass's record of which triangle is in front once a pre-pass has been drawn
+	 * The target's own colour buffer belongs to the caller and isn't counted
+	 * Returns 0 if there's no target
+	 */
+	float Rasteriser::getBytesPerPixel() const
+	{
+		if (_width == 0 || _height == 0)
+			return 0;
+
+		int pixelSize = getDepthFormatSize(_depthFormat) + sizeof(unsigned int);
+		if (_layout == FramebufferLayouts::TILED)
+			pixelSize += sizeof(unsigned int);
+		if (_prepassIds != 0)
+			pixelSize += sizeof(unsigned int);
+
+		const float bytes = (float)_bufferWidth * _bufferHeight * pixelSize
+							+ (float)_hiZWidth * _hiZHeight * (sizeof(float) + sizeof(unsigned char));
+
+		return bytes / ((float)_width * _height);
+	}
+
+	/*
+	 * Sets how the colour, depth and visibility buffers are laid out (see FramebufferLayouts)
+	 * The buffers are reallocated, and a new scene is started the same way as by setTarget
+	 */
+	void Rasteriser::setFramebufferLayout(FramebufferLayout layout)
+	{
+		if (layout == _layout)
+			return;
+
+		flush();
+
+		_layout = layout;
+
+		if (_pixelBuffer != 0)
+			setTarget(_pixelBuffer, _width, _height, _depthFormat);
+	}
+
+	FramebufferLayout Rasteriser::getFramebufferLayout() const
+	{
+		return _layout;
+	}
+
+	/*
+	 * Returns how many pixels past the left and right, and the top and bottom, edges of the target a triangle's
+	 * vertices can be and still be drawn exactly; further out they have to be clipped first
+	 * Along a side of the target longer than MAX_TRIANGLE_SPAN it's negative, so only the middle
+	 * MAX_TRIANGLE_SPAN pixels of it are drawn
+	 */
+	int Rasteriser::getGuardBandX() const
+	{
+		return getGuardBand(_tilesX);
+	}
+
+	int Rasteriser::getGuardBandY() const
+	{
+		return getGuardBand(_tilesY);
+	}
+
+	/*
+	 * Returns the guard band along a side of the target the given number of tiles long
+	 * Pixels are tested up to the end of the last tile, so that's counted in the span
+	 */
+	int Rasteriser::getGuardBand(int tiles)
+	{
+		const int span = tiles * TILE_SIZE;
+
+		return (MAX_TRIANGLE_SPAN - span) / 2;
+	}
+
+	void Rasteriser::setWorkerCount(int count)
+	{
+		flush();
+
+		_workers.setWorkerCount(count);
+
+		// Each worker counts into its own stats
+		if (_stats.size() < (unsigned int)_workers.getWorkerCount())
+			_stats.resize(_workers.getWorkerCount(), RasterStats());
+
+		if (_tileLights.size() < (unsigned int)_workers.getWorkerCount())
+			_tileLights.resize(_workers.getWorkerCount());
+	}
+
+	int Rasteriser::getWorkerCount() const
+	{
+		return _workers.getWorkerCount();
+	}
+
+	/*
+	 * Chooses the instruction set the triangle kernels use
+	 * AUTO takes the path named by the A3D_RASTER_PATH environment variable (scalar, sse2, avx2, avx512
+	 * or neon) if it's set, otherwise the widest one available
+	 * A path that the build or the CPU can't run falls back to the next narrowest one
+	 */
+	void Rasteriser::setRasterPath(RasterPath path)
+	{
+		// Widest first
+		static const RasterPath paths[] = { RasterPaths::AVX512, RasterPaths::AVX2, RasterPaths::SSE2,
+											RasterPaths::NEON, RasterPaths::SCALAR };
+		static const int pathCount = sizeof(paths) / sizeof(paths[0]);
+
+		flush();
+
+		if (path == RasterPaths::AUTO)
+		{
+			path = paths[0];
+
+			const char* name = getenv("A3D_RASTER_PATH");
+
+			if (name != 0)
+			{
+				for (int i = 0; i < pathCount; ++i)
+				{
+					if (strcmp(name, getRasterPathName(paths[i])) == 0)
+						path = paths[i];
+				}
+			}
+		}
+
+		int i = 0;
+		while (paths[i] != path)
+			i++;
+
+		// Scalar always works
+		while ((_kernels = getKernels(paths[i])) == 0)
+			i++;
+
+		_rasterPath = paths[i];
+	}
+
+	/*
+	 * Returns the path the triangle kernels are running on, never AUTO
+	 */
+	RasterPath Rasteriser::getRasterPath() const
+	{
+		return _rasterPath;
+	}
+
+	const char* Rasteriser::getRasterPathName(RasterPath path)
+	{
+		switch (path)
+		{
+		case RasterPaths::AUTO:
+			return "auto";
+		case RasterPaths::SCALAR:
+			return "scalar";
+		case RasterPaths::SSE2:
+			return "sse2";
+		case RasterPaths::AVX2:
+			return "avx2";
+		case RasterPaths::AVX512:
+			return "avx512";
+		case RasterPaths::NEON:
+			return "neon";
+		}
+
+		return "unknown";
+	}
+
+	/*
+	 * Sets the width and height of the blocks triangles are walked in
+	 * Blocks wholly outside a triangle are skipped and blocks wholly inside skip the per-pixel edge tests,
+	 * so smaller blocks suit smaller triangles
+	 * The size is rounded down to a power of two between 1 and TILE_SIZE, and blocks are never
+	 * narrower than the kernels' SIMD width
+	 */
+	void Rasteriser::setBlockSize(int size)
+	{
+		flush();
+
+		_blockSize = 1;
+		while (_blockSize * 2 <= size && _blockSize * 2 <= TILE_SIZE)
+			_blockSize *= 2;
+	}
+
+	int Rasteriser::getBlockSize() const
+	{
+		return _blockSize;
+	}
+
+	/*
+	 * Sets the longest span of pixels along a row that textured triangles' texture coordinates are stepped
+	 * affinely across, between exact perspective-correct values at either end
+	 * Each triangle's span is the longest, up to this, that its depth gradient keeps within MAX_TEXTURE_ERROR texels,
+	 * and spans shorter than the kernels' SIMD width are worked out at every pixel, as are deferred triangles,
+	 * which endScene textures a pixel at a time
+	 * The span is rounded down to a power of two between MIN_PERSPECTIVE_SPAN and MAX_PERSPECTIVE_SPAN,
+	 * or 0 to always work texture coordinates out at every pixel, and applies to triangles set up from then on
+	 */
+	void Rasteriser::setPerspectiveSpan(int span)
+	{
+		setupBatch();
+
+		if (span < MIN_PERSPECTIVE_SPAN)
+		{
+			_perspectiveSpan = 0;
+			return;
+		}
+
+		_perspectiveSpan = MIN_PERSPECTIVE_SPAN;
+		while (_perspectiveSpan * 2 <= span && _perspectiveSpan * 2 <= MAX_PERSPECTIVE_SPAN)
+			_perspectiveSpan *= 2;
+	}
+
+	int Rasteriser::getPerspectiveSpan() const
+	{
+		return _perspectiveSpan;
+	}
+
+	/*
+	 * Sets how textured triangles drawn from then on are filtered (see TextureFilters)
+	 */
+	void Rasteriser::setTextureFilter(TextureFilter filter)
+	{
+		_textureFilter = filter;
+		_sampler = Sampler();
+	}
+
+	TextureFilter Rasteriser::getTextureFilter() const
+	{
+		return _textureFilter;
+	}
+
+	/*
+	 * Sets what textured triangles drawn from then on read past the edges of their textures (see TextureAddressModes)
+	 */
+	void Rasteriser::setTextureAddressMode(TextureAddressMode mode)
+	{
+		_textureAddressMode = mode;
+		_sampler = Sampler();
+	}
+
+	TextureAddressMode Rasteriser::getTextureAddressMode() const
+	{
+		return _textureAddressMode;
+	}
+
+	/*
+	 * Sets how textured triangles drawn from then on pick which of their textures' mipmaps to read (see MipmapModes)
+	 */
+	void Rasteriser::setMipmapMode(MipmapMode mode)
+	{
+		_mipmapMode = mode;
+		_sampler = Sampler();
+	}
+
+	MipmapMode Rasteriser::getMipmapMode() const
+	{
+		return _mipmapMode;
+	}
+
+	/*
+	 * Sets which layout textured triangles drawn from then on read their textures in, where the
+	 * textures have been copied into it (see Image::addLayout)
+	 */
+	void Rasteriser::setTextureLayout(TextureLayout layout)
+	{
+		_textureLayout = layout;
+		_sampler = Sampler();
+	}
+
+	TextureLayout Rasteriser::getTextureLayout() const
+	{
+		return _textureLayout;
+	}
+
+	/*
+	 * Returns how many blocks were skipped, drawn without edge tests, tested a pixel at a time and found hidden,
+	 * how many triangles were found hidden, covered no pixels or were drawn by the small-triangle kernels
+	 * and how many pixels were lit by endScene, since the last beginScene
+	 */
+	RasterStats Rasteriser::getStats() const
+	{
+		RasterStats total = RasterStats();
+
+		for (unsigned int i = 0; i < _stats.size(); ++i)
+		{
+			total.rejectedBlocks += _stats[i].rejectedBlocks;
+			total.acceptedBlocks += _stats[i].acceptedBlocks;
+			total.partialBlocks += _stats[i].partialBlocks;
+			total.occludedBlocks += _stats[i].occludedBlocks;
+			total.occludedTriangles += _stats[i].occludedTriangles;
+			total.emptyTriangles += _stats[i].emptyTriangles;
+			total.smallTriangles += _stats[i].smallTriangles;
+			total.resolvedPixels += _stats[i].resolvedPixels;
+			total.tileLights += _stats[i].tileLights;
+			total.culledLights += _stats[i].culledLights;
+		}
+
+		return total;
+	}
+
+	/*
+	 * Returns the kernels for a path, or 0 if the build or the CPU can't run it
+	 */
+	const RasterKernels* Rasteriser::getKernels(RasterPath path)
+	{
+		switch (path)
+		{
+		case RasterPaths::SCALAR:
+			return getScalarKernels();
+		case RasterPaths::SSE2:
+			return CPUFeatures::hasSSE2() ? getSSE2Kernels() : 0;
+		case RasterPaths::AVX2:
+			return CPUFeatures::hasAVX2() ? getAVX2Kernels() : 0;
+		case RasterPaths::AVX512:
+			return CPUFeatures::hasAVX512() ? getAVX512Kernels() : 0;
+		case RasterPaths::NEON:
+			// Only built when the compiler targets a CPU that has it
+			return getNEONKernels();
+		default:
+			return 0;
+		}
+	}
+
+	/*
+	 * Returns the kernels of a CUSTOM program for the path the rasteriser is on, or 0 for a program whose kernels
+	 * are the path's own
+	 * A path the program's files couldn't be built for takes its scalar kernels, which every CPU can run
+	 */
+	const ProgramKernelTable* Rasteriser::getCustomKernels(const ProgramBinding& program) const
+	{
+		if (program.type != ProgramTypes::CUSTOM)
+			return 0;
+
+		if (program.kernels[_rasterPath] != 0)
+			return program.kernels[_rasterPath];
+
+		return program.kernels[RasterPaths::SCALAR];
+	}
+
+	/*
+	 * Draws a triangle using half-space equations to determine area and a plane equation
+	 * derivation to interpolate colour values
+	 * The triangle is batched for setup and then queued, and drawn by the tile workers on the next flush
+	 */
+	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, Colour c1,
+							float x2f, float y2f, float z2, Colour c2,
+							float x3f, float y3f, float z3, Colour c3)
+	{
+		if (!_pixelBuffer)
+			return;
+
+		const int i = addTriangle(TriangleTypes::COLOUR, 3, x1f, y1f, z1, x2f, y2f, z2, x3f, y3f, z3);
+
+		setAttributes(_batch, i, 0, c1, c2, c3);
+	}
+
+	/*
+	 * Draws a textured triangle with colour interpolation
+	 * Texture coordinates run from 0 to 1 across the texture
+	 * uoz = u / z
+	 * yoz = y / z
+	 * zr = 1 / z
+	 */
+	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, float uoz1, float voz1, float zr1, Colour c1,
+							float x2f, float y2f, float z2, float uoz2, float voz2, float zr2, Colour c2,
+							float x3f, float y3f, float z3, float uoz3, float voz3, float zr3, Colour c3,
+							unsigned int, const Image* textures)
+	{
+		if (!_pixelBuffer)
+			return;
+
+		const int i = addTriangle(TriangleTypes::TEXTURED, 6, x1f, y1f, z1, x2f, y2f, z2, x3f, y3f, z3);
+
+		TriangleSetup& t = _batch.setups[i];
+		t.sampler = getSampler(textures[0]);
+		t.textureAttribute = 3;
+
+		setAttributes(_batch, i, 0, c1, c2, c3);
+
+		// U / Z, V / Z and 1 / Z interpolation, with u and v taken from 0 .. 1 across the texture to its texels
+		const float width = (float)textures[0].getWidth();
+		const float height = (float)textures[0].getHeight();
+
+		setAttribute(_batch, i, 3, uoz1 * width, uoz2 * width, uoz3 * width);
+		setAttribute(_batch, i, 4, voz1 * height, voz2 * height, voz3 * height);
+		setAttribute(_batch, i, 5, zr1, zr2, zr3);
+	}
+
+	/*
+	 * Draws a triangle and interpolates the normals to generate lighting per pixel
+	 */
+	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, const Vertex& cam1, const Vector& n1,
+							float x2f, float y2f, float z2, const Vertex& cam2, const Vector& n2,
+							float x3f, float y3f, float z3, const Vertex& cam3, const Vector& n3, const LightList& lights)
+	{
+		if (!_pixelBuffer)
+			return;
+
+		const int i = addTriangle(TriangleTypes::PHONG, 6, x1f, y1f, z1, x2f, y2f, z2, x3f, y3f, z3);
+
+		// Lit after this returns, the triangle can outlast the caller's light list
+		_batch.setups[i].lights = keepLights(lights);
+		_batch.deferred[i] = _deferredShading;
+
+		setAttributes(_batch, i, 0, n1, n2, n3);
+
+		// Also camera space z needs to be interpolated for perspective correct textures/lighting
+		// Camera-space z is too imprecise for z-buffering :<
+		setAttributes(_batch, i, 3, cam1, cam2, cam3);
+	}
+
+	/*
+	 * Draws a textured triangle and interpolates the normals to generate lighting per pixel
+	 * Texture coordinates run from 0 to 1 across the texture
+	 */
+	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, const Vertex& cam1, float uoz1, float voz1, float zr1, const Vector& n1,
+								float x2f, float y2f, float z2, const Vertex& cam2, float uoz2, float voz2, float zr2, const Vector& n2,
+								float x3f, float y3f, float z3, const Vertex& cam3, float uoz3, float voz3, float zr3, const Vector& n3,
+								unsigned int, const Image* textures, const LightList& lights)
+	{
+		if (!_pixelBuffer)
+			return;
+
+		const int i = addTriangle(TriangleTypes::PHONG_TEXTURED, 9, x1f, y1f, z1, x2f, y2f, z2, x3f, y3f, z3);
+
+		TriangleSetup& t = _batch.setups[i];
+		t.sampler = getSampler(textures[0]);
+		t.textureAttribute = 6;
+		t.lights = keepLights(lights);
+
+		_batch.deferred[i] = _deferredShading;
+
+		setAttributes(_batch, i, 0, n1, n2, n3);
+
+		// Also camera space z needs to be interpolated for perspective correct textures/lighting
+		// Camera-space z is too imprecise for z-buffering :<
+		setAttributes(_batch, i, 3, cam1, cam2, cam3);
+
+		// U / Z, V / Z and 1 / Z interpolation, with u and v taken from 0 .. 1 across the texture to its texels
+		const float width = (float)textures[0].getWidth();
+		const float height = (float)textures[0].getHeight();
+
+		setAttribute(_batch, i, 6, uoz1 * width, uoz2 * width, uoz3 * width);
+		setAttribute(_batch, i, 7, voz1 * height, voz2 * height, voz3 * height);
+		setAttribute(_batch, i, 8, zr1, zr2, zr3);
+	}
+
+	/*
+	 * Draws a triangle with a program's fragment stage, given the values its vertex stage gave each vertex
+	 */
+	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, const float* v1,
+								float x2f, float y2f, float z2, const float* v2,
+								float x3f, float y3f, float z3, const float* v3, const ProgramBinding& program)
+	{
+		if (!_pixelBuffer)
+			return;
+
+		const int i = addTriangle(TriangleTypes::PROGRAM, program.varyings, x1f, y1f, z1, x2f, y2f, z2, x3f, y3f, z3);
+
+		TriangleSetup& t = _batch.setups[i];
+		t.programType = program.type;
+		t.program = program.program;
+		t.programKernels = getCustomKernels(program);
+
+		for (int j = 0; j < program.varyings; ++j)
+			setAttribute(_batch, i, j, v1[j], v2[j], v3[j]);
+	}
+
+	/*
+	 * Draws a textured triangle with a program's fragment stage, given the values its vertex stage gave each vertex
+	 * Texture coordinates run from 0 to 1 across the texture
+	 */
+	void Rasteriser::drawTriangle(float x1f, float y1f, float z1, const float* v1, float uoz1, float voz1, float zr1,
+								float x2f, float y2f, float z2, const float* v2, float uoz2, float voz2, float zr2,
+								float x3f, float y3f, float z3, const float* v3, float uoz3, float voz3, float zr3,
+								unsigned int, const Image* textures, const ProgramBinding& program)
+	{
+		if (!_pixelBuffer)
+			return;
+
+		const int first = program.varyings;
+		const int i = addTriangle(TriangleTypes::PROGRAM_TEXTURED, first + 3, x1f, y1f, z1, x2f, y2f, z2, x3f, y3f, z3);
+
+		TriangleSetup& t = _batch.setups[i];
+		t.sampler = getSampler(textures[0]);
+		t.textureAttribute = first;
+		t.programType = program.type;
+		t.program = program.program;
+		t.programKernels = getCustomKernels(program);
+
+		for (int j = 0; j < first; ++j)
+			setAttribute(_batch, i, j, v1[j], v2[j], v3[j]);
+
+		// U / Z, V / Z and 1 / Z interpolation after the varyings, with u and v taken to texels as above
+		const float width = (float)textures[0].getWidth();
+		const float height = (float)textures[0].getHeight();
+
+		setAttribute(_batch, i, first, uoz1 * width, uoz2 * width, uoz3 * width);
+		setAttribute(_batch, i, first + 1, voz1 * height, voz2 * height, voz3 * height);
+		setAttribute(_batch, i, first + 2, zr1, zr2, zr3);
 	}
-}
\ No newline at end of file
+}
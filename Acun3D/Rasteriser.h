@@ -1,20 +1,48 @@
 #ifndef __RASTERISER_H__
 #define __RASTERISER_H__
 
+#include <vector>
+#include <deque>
+
 #include "Matrix.h"
 #include "Vertex.h"
 #include "Pixel.h"
 #include "Colour.h"
 #include "MD2_Model.h"
 #include "Camera.h"
+#include "ThreadPool.h"
+#include "TriangleSetup.h"
+#include "LightList.h"
+#include "RasterKernels.h"
+#include "AlignedBuffer.h"
 
 namespace a3d
 {
 	class Rasteriser
 	{
 	public:
+		// Width and height of the screen tiles triangles are binned into
+		static const int TILE_SIZE = 64;
+
+		// Default width and height of the blocks the kernels walk a triangle's bounding box in
+		static const int DEFAULT_BLOCK_SIZE = 8;
+
+		// Number of triangles that can be queued before the bins are flushed automatically,
+		// unless they're being kept for a depth pre-pass
+		static const int MAX_QUEUED_TRIANGLES = 65536;
+
+		// Shortest and longest affine texture spans (see setPerspectiveSpan)
+		static const int MIN_PERSPECTIVE_SPAN = 8;
+		static const int MAX_PERSPECTIVE_SPAN = 32;
+
+		// Furthest apart in pixels a triangle's vertices and the pixels it's tested at can be before
+		// the kernels' 28.4 fixed-point edge functions overflow an int
+		// Only the middle MAX_TRIANGLE_SPAN pixels of a wider or taller target are drawn (see getGuardBandX)
+		static const int MAX_TRIANGLE_SPAN = 2047;
+
 		Rasteriser();
-		Rasteriser(Pixel* pixelBuffer, int width, int height);
+		Rasteriser(Pixel* pixelBuffer, int width, int height, DepthFormat depthFormat = DepthFormats::FLOAT32);
+		~Rasteriser();
 
 		void setPixel(int x, int y, int colour);
 
@@ -33,21 +61,222 @@ namespace a3d
 
 		void drawTriangle(float x1, float y1, float z1, const Vertex& cam1, const Vector& n1,
 							float x2, float y2, float z2, const Vertex& cam2, const Vector& n2,
-							float x3, float y3, float z3, const Vertex& cam3, const Vector& n3, std::vector<Light*>& lights);
+							float x3, float y3, float z3, const Vertex& cam3, const Vector& n3, const LightList& lights);
 
 		void drawTriangle(float x1f, float y1f, float z1, const Vertex& cam1, float uoz1, float voz1, float rz1, const Vector& n1,
 							float x2f, float y2f, float z2, const Vertex& cam2, float uoz2, float voz2, float rz2, const Vector& n2,
 							float x3f, float y3f, float z3, const Vertex& cam3, float uoz3, float voz3, float rz3, const Vector& n3,
-							unsigned int textureCount, const Image* textures, std::vector<Light*>& lights);
+							unsigned int textureCount, const Image* textures, const LightList& lights);
+
+		void drawTriangle(float x1, float y1, float z1, const float* v1,
+							float x2, float y2, float z2, const float* v2,
+							float x3, float y3, float z3, const float* v3, const ProgramBinding& program);
+
+		void drawTriangle(float x1f, float y1f, float z1, const float* v1, float uoz1, float voz1, float zr1,
+							float x2f, float y2f, float z2, const float* v2, float uoz2, float voz2, float zr2,
+							float x3f, float y3f, float z3, const float* v3, float uoz3, float voz3, float zr3,
+							unsigned int textureCount, const Image* textures, const ProgramBinding& program);
+
+		void flush();
+
+		const LightList* keepLights(const LightList& lights);
+
+		void setWorkerCount(int count);
+		int getWorkerCount() const;
+
+		void setRasterPath(RasterPath path);
+		RasterPath getRasterPath() const;
+		static const char* getRasterPathName(RasterPath path);
+
+		void setBlockSize(int size);
+		int getBlockSize() const;
+
+		void setPerspectiveSpan(int span);
+		int getPerspectiveSpan() const;
 
-		void setTarget(Pixel* pixelBuffer, int _width, int _height);
+		void setTextureFilter(TextureFilter filter);
+		TextureFilter getTextureFilter() const;
+
+		void setTextureAddressMode(TextureAddressMode mode);
+		TextureAddressMode getTextureAddressMode() const;
+
+		void setMipmapMode(MipmapMode mode);
+		MipmapMode getMipmapMode() const;
+
+		void setTextureLayout(TextureLayout layout);
+		TextureLayout getTextureLayout() const;
+
+		RasterStats getStats() const;
+
+		void setDeferredShading(bool deferred);
+		bool getDeferredShading() const;
+
+		void setDepthPrepass(bool prepass);
+		bool getDepthPrepass() const;
+
+		void setDepthFormat(DepthFormat format);
+		DepthFormat getDepthFormat() const;
+		static int getDepthFormatSize(DepthFormat format);
+		static const char* getDepthFormatName(DepthFormat format);
+
+		float getBytesPerPixel() const;
+
+		void setFramebufferLayout(FramebufferLayout layout);
+		FramebufferLayout getFramebufferLayout() const;
+
+		int getGuardBandX() const;
+		int getGuardBandY() const;
+
+		void setTarget(Pixel* pixelBuffer, int _width, int _height, DepthFormat depthFormat = DepthFormats::FLOAT32);
 		void beginScene(Pixel colour);
+		void beginScene();
+		void endScene();
 	private:
+		// Clears waiting for a tile, carried out by the first worker to draw to it or, for colour, by endScene
+		static const unsigned char CLEAR_COLOUR = 1;
+		static const unsigned char CLEAR_DEPTH = 2;
+
+
+		struct TileJob;
+		friend struct TileJob;
+
+		struct FinishJob;
+		friend struct FinishJob;
+
+		struct ResolveJob;
+		friend struct ResolveJob;
+
+		/*
+		 * One of the light lists of a tile's Phong triangles, culled to those reaching the camera-space box
+		 * around the parts of them in the tile
+		 */
+		struct TileLights
+		{
+			const LightList* lights;
+			LightList culled;
+
+			float boxMin[3];
+			float boxMax[3];
+		};
+
+		void initialise();
+		void allocateBuffers();
+		void startScene(unsigned char clears);
+
+		int addTriangle(TriangleType type, int attributeCount,
+						float x1, float y1, float z1,
+						float x2, float y2, float z2,
+						float x3, float y3, float z3);
+		void setupBatch();
+		const Sampler& getSampler(const Image& image);
+		void submit(const TriangleSetup& t);
+		void submitDeferred(const TriangleSetup& t);
+		void rasteriseBins(KernelMode mode);
+		void clearBins();
+		void drawPrepass();
+		void rasteriseTile(int tile, int worker, KernelMode mode);
+		const LightList* cullLights(int tile, int worker, unsigned int first, unsigned int& count);
+		unsigned int findTileLights(int worker, const LightList* lights, unsigned int& count);
+		void cullTileLights(int worker, TileLights& tileLights);
+		void updateHiZ(int tile);
+		void clearDepth();
+		void clearHiZ();
+		void clearTile(int tile);
+		void clearPrepassIds(int tile);
+		static int getGuardBand(int tiles);
+		void finishTileRow(int row);
+		void copyTile(int tile);
+		void resolveTile(int tile, int worker);
+
+		static const RasterKernels* getKernels(RasterPath path);
+		const ProgramKernelTable* getCustomKernels(const ProgramBinding& program) const;
+
 		Pixel* _pixelBuffer;
-		float* _depthBuffer;
 		int _width;
 		int _height;
+
+		// How the buffers the kernels draw to are laid out, and their size, padded for the TILED layout
+		FramebufferLayout _layout;
+		int _bufferWidth;
+		int _bufferHeight;
+
+		// Colour buffer the kernels draw to, which is the target's unless the layout is TILED
+		unsigned int* _colourBuffer;
+		AlignedBuffer _colourStorage;
+
+		// Depth buffer, getDepthFormatSize(_depthFormat) bytes to a pixel
+		unsigned char* _depthBuffer;
+		AlignedBuffer _depthStorage;
+		DepthFormat _depthFormat;
+
+		// Triangles waiting to be set up
+		TriangleBatch _batch;
+
+		// Triangles waiting to be rasterised and the indices of those touching each tile
+		std::vector<TriangleSetup> _triangles;
+		std::vector<std::vector<unsigned int> > _bins;
+		int _tilesX;
+		int _tilesY;
+
+		// Whether Phong triangles are drawn to the visibility buffer and lit by endScene
+		bool _deferredShading;
+
+		// Visibility buffer (see RasterTarget), which is only kept up to date once something has been deferred
+		unsigned int* _idBuffer;
+		AlignedBuffer _idStorage;
+		bool _idBufferInUse;
+
+		// Whether triangles are kept until endScene, which draws their depth and then shades them
+		// only where they're visible
+		bool _depthPrepass;
+
+		// Which kept triangle is in front at each pixel (see RasterTarget), allocated by the first pre-pass
+		unsigned int* _prepassIds;
+		AlignedBuffer _prepassStorage;
+
+		// Deferred triangles, which the visibility buffer holds 1-based indices into
+		std::vector<TriangleSetup> _deferredTriangles;
+
+		// Copies of the light lists of queued, kept and deferred triangles for them to point at, until the end of the scene
+		std::deque<LightList> _keptLights;
+
+		// For each worker, the light lists of the Phong triangles of the tile it's drawing, each culled once
+		// to the tile (see cullLights), those in use so far first
+		std::vector<std::vector<TileLights> > _tileLights;
+
+		// Hierarchical depth buffer (see RasterTarget), which of its cells have been drawn to since it was
+		// last brought up to date, and the furthest depth in each tile
+		std::vector<float> _hiZ;
+		std::vector<unsigned char> _hiZDirty;
+		int _hiZWidth;
+		int _hiZHeight;
+		std::vector<float> _tileDepth;
+
+		// Clears still waiting for each tile, and the colour it's cleared to
+		std::vector<unsigned char> _tileClears;
+		Pixel _clearColour;
+
+		ThreadPool _workers;
+
+		// Instruction set in use and its kernels
+		RasterPath _rasterPath;
+		const RasterKernels* _kernels;
+
+		int _blockSize;
+
+		// Longest affine texture span, or 0 to work texture coordinates out at every pixel
+		int _perspectiveSpan;
+
+		// How textured triangles are sampled, and the sampler of the last texture drawn with
+		TextureFilter _textureFilter;
+		TextureAddressMode _textureAddressMode;
+		MipmapMode _mipmapMode;
+		TextureLayout _textureLayout;
+		Sampler _sampler;
+
+		// Counters for each worker, cleared by beginScene
+		std::vector<RasterStats> _stats;
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,44 @@
+// Built for AVX2 whatever the rest of the project targets, these kernels are only used when the CPU supports it
+
+// Headers shared with the rest of the project are included before switching instruction set
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "RasterKernels.h"
+#include "LightList.h"
+#include "LightingMath.h"
+
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#elif defined(__GNUC__) && !defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma GCC target("avx2")
+#define SIMD_AVX2
+#elif defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#define SIMD_AVX2
+#define POP_TARGET
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+// MSVC compiles the intrinsics without /arch:AVX2, which would also build the inline functions of the shared
+// headers for AVX2 and leave the linker free to keep those copies for the rest of the project
+#define SIMD_AVX2
+#endif
+
+#include "SpanKernel.h"
+
+namespace a3d
+{
+	const RasterKernels* getAVX2Kernels()
+	{
+#ifdef SIMD_AVX2
+		return getKernelTable<simd::avx2::float8>();
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef POP_TARGET
+#pragma clang attribute pop
+#endif
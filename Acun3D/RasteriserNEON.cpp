@@ -0,0 +1,18 @@
+// NEON kernels, only built when the compiler is targeting an ARM CPU with NEON
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#endif
+
+#include "SpanKernel.h"
+
+namespace a3d
+{
+	const RasterKernels* getNEONKernels()
+	{
+#ifdef SIMD_NEON
+		return getKernelTable<simd::neon::float4>();
+#else
+		return 0;
+#endif
+	}
+}
@@ -0,0 +1,11 @@
+#define SIMD_SCALAR
+
+#include "SpanKernel.h"
+
+namespace a3d
+{
+	const RasterKernels* getScalarKernels()
+	{
+		return getKernelTable<simd::scalar::float4>();
+	}
+}
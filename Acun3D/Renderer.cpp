@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <limits>
+
 #include "Renderer.h"
+#include "DrawStages.h"
 
 namespace a3d
 {
@@ -8,11 +12,25 @@ namespace a3d
 		_rasteriser = 0;
 		_width = 0;
 		_height = 0;
+		_workerCount = 0;
+		_rasterPath = RasterPaths::AUTO;
+		_blockSize = Rasteriser::DEFAULT_BLOCK_SIZE;
+		_perspectiveSpan = 0;
+		_depthPrepass = false;
+		_depthFormat = DepthFormats::FLOAT32;
+		_framebufferLayout = FramebufferLayouts::LINEAR;
+		_clippedTriangles = 0;
 
 		// Default rendering mode
 		_materialType = MaterialTypes::TEXTURED;
 		_shadingType = ShadingTypes::SMOOTH;
 		_cullingType = CullingTypes::BACK;
+		_textureFilter = TextureFilters::POINT;
+		_textureAddressMode = TextureAddressModes::CLAMP;
+		_mipmapMode = MipmapModes::NONE;
+		_textureLayout = TextureLayouts::LINEAR;
+		_lightingAccuracy = LightingAccuracies::EXACT;
+		_drawOrder = DrawOrders::IMMEDIATE;
 
 		_full.push_back(&_fullBright);
 	}
@@ -23,11 +41,26 @@ namespace a3d
 		_rasteriser = new Rasteriser(pixelBuffer, width, height);
 		_width = width;
 		_height = height;
+		_workerCount = 0;
+		_rasterPath = RasterPaths::AUTO;
+		_blockSize = Rasteriser::DEFAULT_BLOCK_SIZE;
+		_perspectiveSpan = 0;
+		_depthPrepass = false;
+		_depthFormat = DepthFormats::FLOAT32;
+		_framebufferLayout = FramebufferLayouts::LINEAR;
+		_clippedTriangles = 0;
+		_clipper.setViewport(width, height, _rasteriser->getGuardBandX(), _rasteriser->getGuardBandY());
 		
 		// Default rendering mode
 		_materialType = MaterialTypes::TEXTURED;
 		_shadingType = ShadingTypes::SMOOTH;
 		_cullingType = CullingTypes::BACK;
+		_textureFilter = TextureFilters::POINT;
+		_textureAddressMode = TextureAddressModes::CLAMP;
+		_mipmapMode = MipmapModes::NONE;
+		_textureLayout = TextureLayouts::LINEAR;
+		_lightingAccuracy = LightingAccuracies::EXACT;
+		_drawOrder = DrawOrders::IMMEDIATE;
 
 		_full.push_back(&_fullBright);
 	}
@@ -63,6 +96,21 @@ namespace a3d
 				return true;
 		}
 
+		if (_drawOrder == DrawOrders::FRONT_TO_BACK)
+			queueDraw(model, time, view);
+		else
+			drawModel(model, time, view);
+
+		setMatrixMode(mode);
+
+		return true;
+	}
+
+	/*
+	 * Draws a model straight away with the current state, given the view matrix
+	 */
+	void Renderer::drawModel(md2::MD2_Model& model, long time, const Matrix4f& view)
+	{
 		// Transform all lights to the view
 		// Make a copy of the old pointers
 		std::vector<Light*> lights = _lights;
@@ -89,7 +137,8 @@ namespace a3d
 					position = ((PointLight*)lights[i])->getPosition();
 					position(3, 0) = 1;
 					position = view * position;
-					light = new PointLight(Vector(position(0, 0), position(1, 0), position(2, 0)), lights[i]->getColour());
+					light = new PointLight(Vector(position(0, 0), position(1, 0), position(2, 0)), lights[i]->getColour(),
+						((PointLight*)lights[i])->getRange());
 					s = (PointLight*)light;
 				}
 				break;
@@ -99,7 +148,8 @@ namespace a3d
 					position(3, 0) = 1;
 					position = view * position;
 					light = new Spotlight(view * ((Spotlight*)lights[i])->getPosition(), ((Spotlight*)lights[i])->getDirection(), 
-						lights[i]->getColour(), ((Spotlight*)lights[i])->getFOV(), ((Spotlight*)lights[i])->getExponent());
+						lights[i]->getColour(), ((Spotlight*)lights[i])->getFOV(), ((Spotlight*)lights[i])->getExponent(),
+						((Spotlight*)lights[i])->getRange());
 				}
 				break;
 			}
@@ -108,6 +158,10 @@ namespace a3d
 				_lights.push_back(light);
 		}
 
+		// Per-pixel lighting reads them packed by type, compiled once for the whole draw and kept by the
+		// rasteriser for as long as its triangles are queued
+		_lightList.compile(_lights, _lightingAccuracy);
+
 		pushMatrix();
 			transform(view);
 
@@ -115,37 +169,20 @@ namespace a3d
 			if (_materialType == MaterialTypes::TEXTURED && model.getTextureCount() <= 0)
 				_materialType = MaterialTypes::SOLID;
 
-			// Draw model based on renderer state
-			switch (_materialType)
-			{
-			case MaterialTypes::WIREFRAME:
-				{
-					drawWireFrame(model, time);
-				}
-				break;
+			const bool deferred = (_shadingType == ShadingTypes::DEFERRED_PHONG);
+			_rasteriser->setDeferredShading(deferred);
+			_rasteriser->setTextureFilter(_textureFilter);
+			_rasteriser->setTextureAddressMode(_textureAddressMode);
+			_rasteriser->setMipmapMode(_mipmapMode);
+			_rasteriser->setTextureLayout(_textureLayout);
 
-			case MaterialTypes::SOLID:
-				{
-					if (_shadingType == ShadingTypes::SMOOTH)
-						drawSolidSmooth(model, time);
-					else if (_shadingType == ShadingTypes::PHONG)
-						drawSolidPhong(model, time);
-					else
-						drawSolidFlat(model, time);
-				}
-				break;
+			// Textures are copied into a layout the first time they're drawn with it, except those a texture
+			// quality packs, which only have LINEAR, so the rasteriser reads them in that instead
+			if (_materialType == MaterialTypes::TEXTURED)
+				model.addTextureLayout(_textureLayout);
 
-			case MaterialTypes::TEXTURED:
-				{
-					if (_shadingType == ShadingTypes::SMOOTH)
-						drawSolidSmoothTextured(model, time);
-					else if (_shadingType == ShadingTypes::PHONG)
-						drawSolidPhongTextured(model, time);
-					else
-						drawSolidFlatTextured(model, time);
-				}
-				break;
-			}
+			// Draw model based on renderer state
+			(this->*getDrawFunction(_materialType, _shadingType, _program))(model, time);
 		popMatrix();
 
 		_materialType = old;
@@ -153,192 +190,219 @@ namespace a3d
 		// Clean up temp lighting
 		for (unsigned int i = 0; i < _lights.size(); ++i)
 		{
-			delete[] _lights[i];
+			delete _lights[i];
 		}
 
 		_lights.clear();
 		_lights = lights;
-
-		setMatrixMode(mode);
-
-		return true;
 	}
 
-	void Renderer::drawWireFrame(md2::MD2_Model& model, long time)
+	/*
+	 * Keeps a draw and everything it depends on until endScene, along with how near its bounding sphere comes
+	 * to the camera
+	 */
+	void Renderer::queueDraw(md2::MD2_Model& model, long time, const Matrix4f& view)
 	{
-		int vertexCount = model.getVertexCount();
-		int triangleCount = model.getTriangleCount();
+		QueuedDraw draw;
+		draw.model = &model;
+		draw.time = time;
+		draw.world = getMatrix();
+		draw.view = view;
+		draw.projection = _projection.top();
+		draw.materialType = _materialType;
+		draw.shadingType = _shadingType;
+		draw.cullingType = _cullingType;
+		draw.textureFilter = _textureFilter;
+		draw.textureAddressMode = _textureAddressMode;
+		draw.mipmapMode = _mipmapMode;
+		draw.textureLayout = _textureLayout;
+		draw.lightingAccuracy = _lightingAccuracy;
+		draw.program = _program;
+		draw.lights = _lights;
+
+		Matrix4f m = view * draw.world;
+
+		Vector centre = model.getBoundsCentre();
+		float z = m(2, 0) * centre.getX() + m(2, 1) * centre.getY() + m(2, 2) * centre.getZ() + m(2, 3);
+
+		// The radius grows with the largest scale in the matrix
+		float scale = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			Vector axis(m(0, i), m(1, i), m(2, i));
+			scale = std::max(scale, axis.length());
+		}
 
-		// Get reference to faces
-		const a3d::Triangle* triangles = model.getFaces();
+		// The camera looks down -z
+		draw.depth = -z - model.getBoundsRadius() * scale;
 
-		// Create vertex buffer
-		Vertex* vertexBuffer = new Vertex[vertexCount];
-		Vertex* cam = new Vertex[vertexCount];
-		Vertex* screen = new Vertex[vertexCount];
+		_queue.push_back(draw);
+	}
 
-		// Process vertices
-		model.processVertices(vertexBuffer, time);
+	/*
+	 * Whether a queued draw comes before another
+	 * Wireframes aren't depth tested, so they come after everything else in the order they were given
+	 */
+	bool Renderer::isDrawnBefore(const QueuedDraw& a, const QueuedDraw& b)
+	{
+		const bool wireframeA = (a.materialType == MaterialTypes::WIREFRAME);
+		const bool wireframeB = (b.materialType == MaterialTypes::WIREFRAME);
 
-		// Transform to world space
-		for (int i = 0; i < vertexCount; ++i)
-		{
-			// Do model view transformation
-			cam[i] = operator*(_world.top(), vertexBuffer[i]);
+		if (wireframeA || wireframeB)
+			return !wireframeA && wireframeB;
 
-			screen[i] = operator*(_projection.top(), cam[i]);
-			
-			screen[i](0, 0) /= screen[i](3, 0);
-			screen[i](1, 0) /= screen[i](3, 0);
-			screen[i](2, 0) /= screen[i](3, 0);
-		}
+		return a.depth < b.depth;
+	}
 
-		int frame = model.getCurrentFrame();
-		for (int i = 0; i < triangleCount; ++i)
-		{
-			Vertex& v1 = screen[triangles[i].A];
-			Vertex& v2 = screen[triangles[i].B];
-			Vertex& v3 = screen[triangles[i].C];
-			
-			// Cull polygon before the near plane
-			if (v1.getZ() < 0 || v2.getZ() < 0 || v3.getZ() < 0 ||
-			// or beyond the far plane
-				v1.getZ() > 1 || v2.getZ() > 1 || v3.getZ() > 1 ||
-			// or if all three vertices are entirely outside of the view
-				((v1.getX() < -1 || v1.getX() > 1 || v1.getY() < -1 || v1.getX() > 1) &&
-				(v2.getX() < -1 || v2.getX() > 1 || v2.getY() < -1 || v2.getX() > 1) &&
-				(v3.getX() < -1 || v3.getX() > 1 || v3.getY() < -1 || v3.getX() > 1)))
-				continue;
+	/*
+	 * Draws the queued draws nearest first, so that the rasteriser can throw away as much as possible of
+	 * what's behind them
+	 */
+	void Renderer::drawQueue()
+	{
+		if (_queue.empty())
+			return;
 
-			Vector normal = _world.top() * triangles[i].normals[frame];
-			
-			Vertex& v1cam = cam[triangles[i].A];
-			Vector cameraDirection = v1cam;
+		std::stable_sort(_queue.begin(), _queue.end(), isDrawnBefore);
 
-			float cos = normal.dot(cameraDirection);
+		// Save the state the draws replace
+		MatrixMode mode = _matrixMode;
+		MaterialType materialType = _materialType;
+		ShadingType shadingType = _shadingType;
+		CullingType cullingType = _cullingType;
+		TextureFilter textureFilter = _textureFilter;
+		TextureAddressMode textureAddressMode = _textureAddressMode;
+		MipmapMode mipmapMode = _mipmapMode;
+		TextureLayout textureLayout = _textureLayout;
+		LightingAccuracy lightingAccuracy = _lightingAccuracy;
+		ProgramBinding program = _program;
+		std::vector<Light*> lights = _lights;
 
-			if (cos < 0 && _cullingType == CullingTypes::BACK
-				|| cos > 0 && _cullingType == CullingTypes::FRONT)
-				continue;
+		setMatrixMode(MatrixModes::WORLD);
 
-			int x1 = int(v1(0, 0) * _width + _width/2.0f);
-			int y1 = int(v1(1, 0) * _height + _height/2.0f);
-			int x2 = int(v2(0, 0) * _width + _width/2.0f);
-			int y2 = int(v2(1, 0) * _height + _height/2.0f);
-			int x3 = int(v3(0, 0) * _width + _width/2.0f);
-			int y3 = int(v3(1, 0) * _height + _height/2.0f);
-			
-			_rasteriser->drawLine(x1, y1, x2, y2, 0x00FF00FF);
-			_rasteriser->drawLine(x2, y2, x3, y3, 0x00FF00FF);
-			_rasteriser->drawLine(x3, y3, x1, y1, 0x00FF00FF);
+		for (unsigned int i = 0; i < _queue.size(); ++i)
+		{
+			QueuedDraw& draw = _queue[i];
+
+			_materialType = draw.materialType;
+			_shadingType = draw.shadingType;
+			_cullingType = draw.cullingType;
+			_textureFilter = draw.textureFilter;
+			_textureAddressMode = draw.textureAddressMode;
+			_mipmapMode = draw.mipmapMode;
+			_textureLayout = draw.textureLayout;
+			_lightingAccuracy = draw.lightingAccuracy;
+			_program = draw.program;
+			_lights = draw.lights;
+
+			_world.push(draw.world);
+			_projection.push(draw.projection);
+				drawModel(*draw.model, draw.time, draw.view);
+			_projection.pop();
+			_world.pop();
 		}
 
-		// Clean up memory
-		delete[] vertexBuffer;
-		delete[] cam;
-		delete[] screen;
+		_queue.clear();
+
+		_materialType = materialType;
+		_shadingType = shadingType;
+		_cullingType = cullingType;
+		_textureFilter = textureFilter;
+		_textureAddressMode = textureAddressMode;
+		_mipmapMode = mipmapMode;
+		_textureLayout = textureLayout;
+		_lightingAccuracy = lightingAccuracy;
+		_program = program;
+		_lights = lights;
+
+		setMatrixMode(mode);
 	}
 
-	void Renderer::drawSolidFlat(md2::MD2_Model& model, long time)
+	/*
+	 * Returns the order to draw a model's triangles in, given their camera-space vertices
+	 * Drawing front to back, runs of TRIANGLE_CLUSTER_SIZE triangles are put in order of their nearest vertex
+	 * Neighbouring triangles in a model are usually near each other, so this roughly orders the triangles of
+	 * big models nearest first without sorting each one
+	 */
+	const int* Renderer::orderTriangles(const md2::MD2_Model& model, const Vertex* cam)
 	{
-		std::vector<Light*>& lights = _lights;
-
-		if (_shadingType == ShadingTypes::NONE)
-			lights = _full;
+		const int triangleCount = model.getTriangleCount();
+		const Triangle* triangles = model.getFaces();
 
-		// TODO: interpolate normals for flat shading animation
-		int vertexCount = model.getVertexCount();
-		int triangleCount = model.getTriangleCount();
+		if (triangleCount == 0)
+			return 0;
 
-		// Get reference to faces
-		const a3d::Triangle* triangles = model.getFaces();
+		_triangleOrder.resize(triangleCount);
 
-		// Create vertex buffer
-		Vertex* vertexBuffer = new Vertex[vertexCount];
-		Vertex* cam = new Vertex[vertexCount];
-		Vertex* screen = new Vertex[vertexCount];
-
-		// Process vertices
-		model.processVertices(vertexBuffer, time);
-
-		// Transform to world space
-		for (int i = 0; i < vertexCount; ++i)
+		if (_drawOrder != DrawOrders::FRONT_TO_BACK || triangleCount <= TRIANGLE_CLUSTER_SIZE)
 		{
-			// Do model view transformation
-			cam[i] = operator*(_world.top(), vertexBuffer[i]);
+			for (int i = 0; i < triangleCount; ++i)
+				_triangleOrder[i] = i;
 
-			screen[i] = operator*(_projection.top(), cam[i]);
-			
-			screen[i](0, 0) /= screen[i](3, 0);
-			screen[i](1, 0) /= screen[i](3, 0);
-			screen[i](2, 0) /= screen[i](3, 0);
+			return &_triangleOrder[0];
 		}
 
-		int frame = model.getCurrentFrame();
-		for (int i = 0; i < triangleCount; ++i)
+		// Nearest distance along -z to each cluster, and where it starts
+		std::vector<std::pair<float, int> > clusters;
+
+		for (int first = 0; first < triangleCount; first += TRIANGLE_CLUSTER_SIZE)
 		{
-			Vertex& v1 = screen[triangles[i].A];
-			Vertex& v2 = screen[triangles[i].B];
-			Vertex& v3 = screen[triangles[i].C];
-
-			// Cull polygon before the near plane
-			if (v1.getZ() < 0 || v2.getZ() < 0 || v3.getZ() < 0 ||
-			// or beyond the far plane
-				v1.getZ() > 1 || v2.getZ() > 1 || v3.getZ() > 1 ||
-			// or if all three vertices are entirely outside of the view
-				((v1.getX() < -1 || v1.getX() > 1 || v1.getY() < -1 || v1.getX() > 1) &&
-				(v2.getX() < -1 || v2.getX() > 1 || v2.getY() < -1 || v2.getX() > 1) &&
-				(v3.getX() < -1 || v3.getX() > 1 || v3.getY() < -1 || v3.getX() > 1)))
-				continue;
+			const int last = std::min(first + TRIANGLE_CLUSTER_SIZE, triangleCount);
 
-			// Calculate camera-space normal
-			Vector normal = _world.top() * triangles[i].normals[frame];
-			
-			// Get vertex to approximate polygon position
-			Vertex& v = cam[triangles[i].A];
+			float z = -std::numeric_limits<float>::infinity();
+			for (int i = first; i < last; ++i)
+			{
+				z = std::max(z, cam[triangles[i].A].getZ());
+				z = std::max(z, cam[triangles[i].B].getZ());
+				z = std::max(z, cam[triangles[i].C].getZ());
+			}
 
-			float cos = normal.dot(v);
+			clusters.push_back(std::make_pair(-z, first));
+		}
 
-			if (cos < 0)
-				continue;
+		std::sort(clusters.begin(), clusters.end());
 
-			normal.normalise();
+		int next = 0;
+		for (unsigned int i = 0; i < clusters.size(); ++i)
+		{
+			const int first = clusters[i].second;
+			const int last = std::min(first + TRIANGLE_CLUSTER_SIZE, triangleCount);
 
-			float x1 = v1(0, 0) * _width + _width/2.0f;
-			float y1 = v1(1, 0) * _height + _height/2.0f;
-			float z1 = v1(3, 0);
-			float x2 = v2(0, 0) * _width + _width/2.0f;
-			float y2 = v2(1, 0) * _height + _height/2.0f;
-			float z2 = v2(3, 0);
-			float x3 = v3(0, 0) * _width + _width/2.0f;
-			float y3 = v3(1, 0) * _height + _height/2.0f;
-			float z3 = v3(3, 0);
+			for (int j = first; j < last; ++j)
+				_triangleOrder[next++] = j;
+		}
 
-			Colour colour(0, 0, 0);
+		return &_triangleOrder[0];
+	}
 
-			colour = model.calculateLights(v, normal, lights);
+	/*
+	 * Returns the projection matrix, with the depth it gives reversed for reversed depth (see DepthFormats)
+	 * Clip-space depth becomes w - z, which the matrix works out from the camera-space position itself
+	 * rather than from a depth that's already been rounded, so depth near the far plane keeps its precision
+	 */
+	Matrix4f Renderer::getProjection()
+	{
+		Matrix4f projection = _projection.top();
 
-			colour.clamp(255.0f);
-			
-			_rasteriser->drawTriangle(x1, y1, z1, colour,
-									x2, y2, z2, colour,
-									x3, y3, z3, colour);
+		if (_depthFormat == DepthFormats::REVERSED_FLOAT32)
+		{
+			for (int i = 0; i < 4; ++i)
+				projection(2, i) = projection(3, i) - projection(2, i);
 		}
 
-		// Clean up memory
-		delete[] vertexBuffer;
-		delete[] cam;
-		delete[] screen;
+		return projection;
 	}
 
-	void Renderer::drawSolidFlatTextured(md2::MD2_Model& model, long time)
+	/*
+	 * Draws a model's triangles with a material and shading from DrawStages
+	 * Each pair is its own copy of this, with everything they ask of a vertex or triangle inlined into it
+	 */
+	template <class Material, class Shading>
+	void Renderer::drawTriangles(md2::MD2_Model& model, long time)
 	{
-		std::vector<Light*>& lights = _lights;
-
-		if (_shadingType == ShadingTypes::NONE)
-			lights = _full;
+		// Values each vertex carries, the shading's followed by the material's
+		const int ATTRIBUTES = Shading::ATTRIBUTES + Material::ATTRIBUTES;
 
-		// TODO: interpolate normals for flat shading animation
 		int vertexCount = model.getVertexCount();
 		int triangleCount = model.getTriangleCount();
 
@@ -350,6 +414,24 @@ namespace a3d
 		Vertex* cam = new Vertex[vertexCount];
 		Vertex* screen = new Vertex[vertexCount];
 
+		// Planes of the view each vertex is outside of
+		int* outcodes = new int[vertexCount];
+
+		DrawStages::DrawInputs inputs;
+		inputs.model = &model;
+		inputs.lights = &_lights;
+		inputs.fullBright = &_full;
+		// Lit per pixel, triangles outlast the draw, so they share one copy of the light list that lasts the scene
+		inputs.lightList = (Shading::PER_PIXEL_LIGHTING ? _rasteriser->keepLights(_lightList) : &_lightList);
+		inputs.lightingAccuracy = _lightingAccuracy;
+		inputs.cullingType = _cullingType;
+		inputs.program = &_program;
+
+		Material material(inputs);
+		Shading shading(inputs);
+
+		const Matrix4f projection = getProjection();
+
 		// Process vertices
 		model.processVertices(vertexBuffer, time);
 
@@ -359,536 +441,434 @@ namespace a3d
 			// Do model view transformation
 			cam[i] = operator*(_world.top(), vertexBuffer[i]);
 
-			screen[i] = operator*(_projection.top(), cam[i]);
+			// Shading done a vertex at a time
+			if (Shading::VERTEX_NORMALS)
+				shading.setVertex(i, cam[i], _world.top() * vertexBuffer[i].getNormal());
+
+			screen[i] = operator*(projection, cam[i]);
+			outcodes[i] = _clipper.getOutcode(screen[i]);
 			
 			screen[i](0, 0) /= screen[i](3, 0);
 			screen[i](1, 0) /= screen[i](3, 0);
 			screen[i](2, 0) /= screen[i](3, 0);
 		}
 
+		// Nearer clusters of triangles first when drawing front to back
+		const int* order = orderTriangles(model, cam);
+
 		int frame = model.getCurrentFrame();
 		for (int i = 0; i < triangleCount; ++i)
 		{
-			const Triangle& triangle = triangles[i];
+			const Triangle& triangle = triangles[order[i]];
 
-			Vertex& v1 = screen[triangle.A];
-			Vertex& v2 = screen[triangle.B];
-			Vertex& v3 = screen[triangle.C];
+			const int vertices[3] = { triangle.A, triangle.B, triangle.C };
 
+			const int outcodeA = outcodes[triangle.A];
+			const int outcodeB = outcodes[triangle.B];
+			const int outcodeC = outcodes[triangle.C];
 
-			// Cull polygon before the near plane
-			if (v1.getZ() < 0 || v2.getZ() < 0 || v3.getZ() < 0 ||
-			// or beyond the far plane
-				v1.getZ() > 1 || v2.getZ() > 1 || v3.getZ() > 1 ||
-			// or if all three vertices are entirely outside of the view
-				((v1.getX() < -1 || v1.getX() > 1 || v1.getY() < -1 || v1.getX() > 1) &&
-				(v2.getX() < -1 || v2.getX() > 1 || v2.getY() < -1 || v2.getX() > 1) &&
-				(v3.getX() < -1 || v3.getX() > 1 || v3.getY() < -1 || v3.getX() > 1)))
+			// Cull polygon entirely outside of one of the planes of the view
+			if ((outcodeA & outcodeB & outcodeC) != 0)
 				continue;
 
 			// Calculate camera-space normal
-			Vector normal = _world.top() * triangles[i].normals[frame];
-			
-			// Get vertex to approximate polygon position
-			Vertex& v = cam[triangles[i].A];
+			Vector normal = _world.top() * triangle.normals[frame];
 
-			float cos = normal.dot(v);
+			// Get vertex to approximate polygon position
+			Vertex& v = cam[triangle.A];
 
-			if (cos < 0)
+			if (material.isCulled(normal.dot(v)))
 				continue;
 
-			normal.normalise();
+			shading.setTriangle(normal, v);
 
-			float x1 = v1(0, 0) * _width + _width/2.0f;
-			float y1 = v1(1, 0) * _height + _height/2.0f;
-			float z1 = v1(3, 0);
-			float x2 = v2(0, 0) * _width + _width/2.0f;
-			float y2 = v2(1, 0) * _height + _height/2.0f;
-			float z2 = v2(3, 0);
-			float x3 = v3(0, 0) * _width + _width/2.0f;
-			float y3 = v3(1, 0) * _height + _height/2.0f;
-			float z3 = v3(3, 0);
+			ClipVertex polygon[Clipper::MAX_VERTICES];
 
-			Colour colour = model.calculateLights(v, normal, lights);
+			for (int j = 0; j < 3; ++j)
+			{
+				shading.getAttributes(vertices[j], cam[vertices[j]], polygon[j].attributes);
+				material.getAttributes(triangle, j, cam[vertices[j]], polygon[j].attributes + Shading::ATTRIBUTES);
+			}
 
-			colour.clamp(255.0f);
+			const int outside = outcodeA | outcodeB | outcodeC;
+			int count = 3;
 
-			const UV* uvs = model.getUVs();
+			// Clip polygons crossing the near or far plane or the guard band
+			if ((outside & Clipper::CLIP_PLANES) != 0)
+			{
+				for (int j = 0; j < 3; ++j)
+					Clipper::setPosition(polygon[j], operator*(projection, cam[vertices[j]]));
 
-			// Get UV coordinates
-			float AU = uvs[triangle.AT].U;
-			float AV = uvs[triangle.AT].V;
-			float BU = uvs[triangle.BT].U;
+				count = _clipper.clipTriangle(polygon, ATTRIBUTES, outside);
+				++_clippedTriangles;
 
-			float BV = uvs[triangle.BT].V;
-			float CU = uvs[triangle.CT].U;
-			float CV = uvs[triangle.CT].V;
+				for (int j = 0; j < count; ++j)
+					shading.setClipped(polygon[j].attributes);
+			}
+			else
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					const Vertex& s = screen[vertices[j]];
 
-			// Camera-space z coordinates
-			float AZ = cam[triangle.A].getZ();
-			float BZ = cam[triangle.B].getZ();
-			float CZ = cam[triangle.C].getZ();
-			
-			// Pass in U/z, V/z and 1/z
-			_rasteriser->drawTriangle(x1, y1, z1, AU / AZ, AV / AZ, 1 / AZ, colour,
-									x2, y2, z2, BU / BZ, BV / BZ, 1 / BZ, colour,
-									x3, y3, z3, CU / CZ, CV / CZ, 1 / CZ, colour,
-									model.getTextureCount(), model.getTextures());
+					polygon[j].screenX = s(0, 0) * _width + _width/2.0f;
+					polygon[j].screenY = s(1, 0) * _height + _height/2.0f;
+					polygon[j].screenZ = s(2, 0);
+				}
+			}
+
+			DrawStages::drawPolygon(*_rasteriser, polygon, count, material, shading);
 		}
 
 		// Clean up memory
 		delete[] vertexBuffer;
 		delete[] cam;
 		delete[] screen;
+		delete[] outcodes;
 	}
 
-	void Renderer::drawSolidSmooth(md2::MD2_Model& model, long time)
+	/*
+	 * Returns the copy of drawTriangles that draws with a material and shading, or with a program if one is set
+	 * Wireframes aren't shaded, and deferred Phong shading draws as Phong shading does
+	 */
+	Renderer::DrawFunction Renderer::getDrawFunction(MaterialType material, ShadingType shading, const ProgramBinding& program)
 	{
-		int vertexCount = model.getVertexCount();
-		int triangleCount = model.getTriangleCount();
-
-		// Get reference to faces
-		const a3d::Triangle* triangles = model.getFaces();
+		using namespace DrawStages;
 
-		// Create vertex buffer
-		Vertex* vertexBuffer = new Vertex[vertexCount];
-		Vertex* cam = new Vertex[vertexCount];
-		Vertex* screen = new Vertex[vertexCount];
-
-		// Buffer for vertex normals
-		Vector* normalBuffer = new Vertex[vertexCount];
-
-		// Process vertices
-		model.processVertices(vertexBuffer, time);
-
-		// Transform to world space
-		for (int i = 0; i < vertexCount; ++i)
+		static const DrawFunction programs[MATERIAL_TYPE_COUNT] =
 		{
-			// Do model view transformation
-			cam[i] = operator*(_world.top(), vertexBuffer[i]);
-			normalBuffer[i] = _world.top() * vertexBuffer[i].getNormal();
+			&Renderer::drawTriangles<WireframeMaterial, UnlitShading>,
+			&Renderer::drawTriangles<SolidMaterial, ProgramShading>,
+			&Renderer::drawTriangles<TexturedMaterial, ProgramShading>
+		};
 
-			screen[i] = operator*(_projection.top(), cam[i]);
-			
-			screen[i](0, 0) /= screen[i](3, 0);
-			screen[i](1, 0) /= screen[i](3, 0);
-			screen[i](2, 0) /= screen[i](3, 0);
-		}
+		if (program.program != 0)
+			return programs[material];
 
-		int frame = model.getCurrentFrame();
-		for (int i = 0; i < triangleCount; ++i)
+		static const DrawFunction functions[MATERIAL_TYPE_COUNT][SHADING_TYPE_COUNT] =
 		{
-			const Triangle& triangle = triangles[i];
-
-			Vertex& v1 = screen[triangle.A];
-			Vertex& v2 = screen[triangle.B];
-			Vertex& v3 = screen[triangle.C];
-
-			// Cull polygon before the near plane
-			if (v1.getZ() < 0 || v2.getZ() < 0 || v3.getZ() < 0 ||
-			// or beyond the far plane
-				v1.getZ() > 1 || v2.getZ() > 1 || v3.getZ() > 1 ||
-			// or if all three vertices are entirely outside of the view
-				((v1.getX() < -1 || v1.getX() > 1 || v1.getY() < -1 || v1.getX() > 1) &&
-				(v2.getX() < -1 || v2.getX() > 1 || v2.getY() < -1 || v2.getX() > 1) &&
-				(v3.getX() < -1 || v3.getX() > 1 || v3.getY() < -1 || v3.getX() > 1)))
-				continue;
-
-			Vector normal = _world.top() * triangle.normals[frame];
-			
-			Vertex& v1cam = cam[triangle.A];
-			Vertex& v2cam = cam[triangle.B];
-			Vertex& v3cam = cam[triangle.C];
-
-			float cos = normal.dot(v1cam);
+			{
+				&Renderer::drawTriangles<WireframeMaterial, UnlitShading>,
+				&Renderer::drawTriangles<WireframeMaterial, UnlitShading>,
+				&Renderer::drawTriangles<WireframeMaterial, UnlitShading>,
+				&Renderer::drawTriangles<WireframeMaterial, UnlitShading>,
+				&Renderer::drawTriangles<WireframeMaterial, UnlitShading>
+			},
+			{
+				&Renderer::drawTriangles<SolidMaterial, UnlitShading>,
+				&Renderer::drawTriangles<SolidMaterial, FlatShading>,
+				&Renderer::drawTriangles<SolidMaterial, SmoothShading>,
+				&Renderer::drawTriangles<SolidMaterial, PhongShading>,
+				&Renderer::drawTriangles<SolidMaterial, PhongShading>
+			},
+			{
+				&Renderer::drawTriangles<TexturedMaterial, UnlitShading>,
+				&Renderer::drawTriangles<TexturedMaterial, FlatShading>,
+				&Renderer::drawTriangles<TexturedMaterial, SmoothShading>,
+				&Renderer::drawTriangles<TexturedMaterial, PhongShading>,
+				&Renderer::drawTriangles<TexturedMaterial, PhongShading>
+			}
+		};
 
-			if (cos < 0)
-				continue;
+		return functions[material][shading];
+	}
 
-			normal.normalise();
-						
-			Vector normalA = normalBuffer[triangle.A].getNormalised();
-			Vector normalB = normalBuffer[triangle.B].getNormalised();
-			Vector normalC = normalBuffer[triangle.C].getNormalised();
-
-			// Calculate lighting for vertices
-			Colour colour1 = model.calculateLights(v1cam, normalA, _lights);
-			Colour colour2 = model.calculateLights(v2cam, normalB, _lights);
-			Colour colour3 = model.calculateLights(v3cam, normalC, _lights);
-
-			float x1 = v1(0, 0) * _width + _width/2.0f;
-			float y1 = v1(1, 0) * _height + _height/2.0f;
-			float z1 = v1(2, 0);
-			float x2 = v2(0, 0) * _width + _width/2.0f;
-			float y2 = v2(1, 0) * _height + _height/2.0f;
-			float z2 = v2(2, 0);
-			float x3 = v3(0, 0) * _width + _width/2.0f;
-			float y3 = v3(1, 0) * _height + _height/2.0f;
-			float z3 = v3(2, 0);
-			
-			_rasteriser->drawTriangle(x1, y1, z1, colour1,
-									x2, y2, z2, colour2,
-									x3, y3, z3, colour3);
+	void Renderer::setMatrixMode(MatrixMode mode)
+	{
+		switch (mode)
+		{
+		case MatrixModes::PROJECTION:
+			_matrixStack = &_projection;
+			_matrixMode = mode;
+			break;
+		case MatrixModes::VIEW:
+			_matrixStack = &_view;
+			_matrixMode = mode;
+			break;
+		case MatrixModes::WORLD:
+		default:
+			_matrixStack = &_world;
+			_matrixMode = mode;
+			break;
 		}
-
-		// Clean up memory
-		delete[] vertexBuffer;
-		delete[] normalBuffer;
-		delete[] cam;
-		delete[] screen;
 	}
 
-	void Renderer::drawSolidSmoothTextured(md2::MD2_Model& model, long time)
+	MatrixMode Renderer::getMatrixMode()
 	{
-		int vertexCount = model.getVertexCount();
-		int triangleCount = model.getTriangleCount();
-
-		// Get reference to faces
-		const a3d::Triangle* triangles = model.getFaces();
-
-		// Create vertex buffer
-		Vertex* vertexBuffer = new Vertex[vertexCount];
-		Vertex* cam = new Vertex[vertexCount];
-		Vertex* screen = new Vertex[vertexCount];
+		return _matrixMode;
+	}
+		
+	void Renderer::setMaterialType(MaterialType type)
+	{
+		_materialType = type;
+	}
 
-		// Buffer for vertex normals
-		Vector* normalBuffer = new Vertex[vertexCount];
+	void Renderer::setShadingType(ShadingType type)
+	{
+		_shadingType = type;
+	}
 
-		// Process vertices
-		model.processVertices(vertexBuffer, time);
+	void Renderer::setCullingType(CullingType type)
+	{
+		_cullingType = type;
+	}
 
-		// Transform to world space
-		for (int i = 0; i < vertexCount; ++i)
-		{
-			// Do model view transformation
-			cam[i] = operator*(_world.top(), vertexBuffer[i]);
-			normalBuffer[i] = _world.top() * vertexBuffer[i].getNormal();
+	/*
+	 * Sets how textured models drawn from then on are filtered (see TextureFilters)
+	 */
+	void Renderer::setTextureFilter(TextureFilter filter)
+	{
+		_textureFilter = filter;
+	}
 
-			screen[i] = operator*(_projection.top(), cam[i]);
-			
-			screen[i](0, 0) /= screen[i](3, 0);
-			screen[i](1, 0) /= screen[i](3, 0);
-			screen[i](2, 0) /= screen[i](3, 0);
-		}
+	TextureFilter Renderer::getTextureFilter()
+	{
+		return _textureFilter;
+	}
 
-		int frame = model.getCurrentFrame();
-		for (int i = 0; i < triangleCount; ++i)
-		{
-			const Triangle& triangle = triangles[i];
+	/*
+	 * Sets what textured models drawn from then on read past the edges of their textures (see TextureAddressModes)
+	 */
+	void Renderer::setTextureAddressMode(TextureAddressMode mode)
+	{
+		_textureAddressMode = mode;
+	}
 
-			Vertex& v1 = screen[triangle.A];
-			Vertex& v2 = screen[triangle.B];
-			Vertex& v3 = screen[triangle.C];
-			
-			// Cull polygon before the near plane
-			if (v1.getZ() < 0 || v2.getZ() < 0 || v3.getZ() < 0 ||
-			// or beyond the far plane
-				v1.getZ() > 1 || v2.getZ() > 1 || v3.getZ() > 1 ||
-			// or if all three vertices are entirely outside of the view
-				((v1.getX() < -1 || v1.getX() > 1 || v1.getY() < -1 || v1.getX() > 1) &&
-				(v2.getX() < -1 || v2.getX() > 1 || v2.getY() < -1 || v2.getX() > 1) &&
-				(v3.getX() < -1 || v3.getX() > 1 || v3.getY() < -1 || v3.getX() > 1)))
-				continue;
+	TextureAddressMode Renderer::getTextureAddressMode()
+	{
+		return _textureAddressMode;
+	}
 
-			Vector normal = _world.top() * triangle.normals[frame];
-			
-			Vertex& v1cam = cam[triangle.A];
-			Vertex& v2cam = cam[triangle.B];
-			Vertex& v3cam = cam[triangle.C];
+	/*
+	 * Sets how textured models drawn from then on pick which of their textures' mipmaps to read (see MipmapModes)
+	 */
+	void Renderer::setMipmapMode(MipmapMode mode)
+	{
+		_mipmapMode = mode;
+	}
 
-			float cos = normal.dot(v1cam);
+	MipmapMode Renderer::getMipmapMode()
+	{
+		return _mipmapMode;
+	}
 
-			if (cos < 0)
-				continue;
+	/*
+	 * Sets which layout textured models drawn from then on read their textures in (see TextureLayouts)
+	 * Each model's textures are copied into it the first time the model is drawn with it, other than those
+	 * a texture quality packs into a format other than BGRA8, which are read in LINEAR (see Image::addLayout)
+	 */
+	void Renderer::setTextureLayout(TextureLayout layout)
+	{
+		_textureLayout = layout;
+	}
 
-			normal.normalise();
-						
-			Vector normalA = normalBuffer[triangle.A].getNormalised();
-			Vector normalB = normalBuffer[triangle.B].getNormalised();
-			Vector normalC = normalBuffer[triangle.C].getNormalised();
-
-			// Calculate lighting for vertices
-			Colour colour1 = model.calculateLights(v1cam, normalA, _lights);
-			Colour colour2 = model.calculateLights(v2cam, normalB, _lights);
-			Colour colour3 = model.calculateLights(v3cam, normalC, _lights);
-
-			float x1 = v1(0, 0) * _width + _width/2.0f;
-			float y1 = v1(1, 0) * _height + _height/2.0f;
-			float z1 = v1(2, 0);
-			float x2 = v2(0, 0) * _width + _width/2.0f;
-			float y2 = v2(1, 0) * _height + _height/2.0f;
-			float z2 = v2(2, 0);
-			float x3 = v3(0, 0) * _width + _width/2.0f;
-			float y3 = v3(1, 0) * _height + _height/2.0f;
-			float z3 = v3(2, 0);
-
-			const UV* uvs = model.getUVs();
-
-			// Get UV coordinates
-			float AU = uvs[triangle.AT].U;
-			float AV = uvs[triangle.AT].V;
-			float BU = uvs[triangle.BT].U;
-
-			float BV = uvs[triangle.BT].V;
-			float CU = uvs[triangle.CT].U;
-			float CV = uvs[triangle.CT].V;
-
-			// Camera-space z coordinates
-			float AZ = cam[triangle.A].getZ();
-			float BZ = cam[triangle.B].getZ();
-			float CZ = cam[triangle.C].getZ();
-			
-			// Pass in U/z, V/z and 1/z
-			_rasteriser->drawTriangle(x1, y1, z1, AU / AZ, AV / AZ, 1 / AZ, colour1,
-									x2, y2, z2, BU / BZ, BV / BZ, 1 / BZ, colour2,
-									x3, y3, z3, CU / CZ, CV / CZ, 1 / CZ, colour3,
-									model.getTextureCount(), model.getTextures());
-		}
+	TextureLayout Renderer::getTextureLayout()
+	{
+		return _textureLayout;
+	}
 
-		// Clean up memory
-		delete[] vertexBuffer;
-		delete[] normalBuffer;
-		delete[] cam;
-		delete[] screen;
+	/*
+	 * Sets how accurately models drawn from then on do their lighting maths (see LightingAccuracies)
+	 */
+	void Renderer::setLightingAccuracy(LightingAccuracy accuracy)
+	{
+		_lightingAccuracy = accuracy;
 	}
-	
-	void Renderer::drawSolidPhong(md2::MD2_Model& model, long time)
+
+	LightingAccuracy Renderer::getLightingAccuracy()
 	{
-		int vertexCount = model.getVertexCount();
-		int triangleCount = model.getTriangleCount();
+		return _lightingAccuracy;
+	}
 
-		// Get reference to faces
-		const a3d::Triangle* triangles = model.getFaces();
+	/*
+	 * Goes back to shading models drawn from then on with the shading type
+	 */
+	void Renderer::clearProgram()
+	{
+		_program = ProgramBinding();
+	}
 
-		// Create vertex buffer
-		Vertex* vertexBuffer = new Vertex[vertexCount];
-		Vertex* cam = new Vertex[vertexCount];
-		Vertex* screen = new Vertex[vertexCount];
+	/*
+	 * Sets whether models are drawn as they're given or queued until endScene and drawn front to back
+	 * (see DrawOrder)
+	 * Drawing nearer models first lets the rasteriser throw away more of what's behind them
+	 * Queued draws keep their state, but the lights and models they use have to last until endScene unchanged
+	 * Switching back to IMMEDIATE draws whatever is queued
+	 */
+	void Renderer::setDrawOrder(DrawOrder order)
+	{
+		if (order == DrawOrders::IMMEDIATE)
+			drawQueue();
 
-		// Buffer for vertex normals
-		Vector* normalBuffer = new Vertex[vertexCount];
+		_drawOrder = order;
+	}
 
-		// Process vertices
-		model.processVertices(vertexBuffer, time);
+	DrawOrder Renderer::getDrawOrder()
+	{
+		return _drawOrder;
+	}
 
-		// Transform to world space
-		for (int i = 0; i < vertexCount; ++i)
-		{
-			// Do model view transformation
-			cam[i] = operator*(_world.top(), vertexBuffer[i]);
-			normalBuffer[i] = _world.top() * vertexBuffer[i].getNormal();
+	/*
+	 * Sets the number of threads used to rasterise (0 for one per hardware thread)
+	 */
+	void Renderer::setWorkerCount(int count)
+	{
+		_workerCount = count;
 
-			screen[i] = operator*(_projection.top(), cam[i]);
-			
-			screen[i](0, 0) /= screen[i](3, 0);
-			screen[i](1, 0) /= screen[i](3, 0);
-			screen[i](2, 0) /= screen[i](3, 0);
-		}
+		if (_rasteriser != 0)
+			_rasteriser->setWorkerCount(count);
+	}
 
-		int frame = model.getCurrentFrame();
-		for (int i = 0; i < triangleCount; ++i)
-		{
-			const Triangle& triangle = triangles[i];
-
-			Vertex& v1 = screen[triangle.A];
-			Vertex& v2 = screen[triangle.B];
-			Vertex& v3 = screen[triangle.C];
-
-			// Cull polygon before the near plane
-			if (v1.getZ() < 0 || v2.getZ() < 0 || v3.getZ() < 0 ||
-			// or beyond the far plane
-				v1.getZ() > 1 || v2.getZ() > 1 || v3.getZ() > 1 ||
-			// or if all three vertices are entirely outside of the view
-				((v1.getX() < -1 || v1.getX() > 1 || v1.getY() < -1 || v1.getX() > 1) &&
-				(v2.getX() < -1 || v2.getX() > 1 || v2.getY() < -1 || v2.getX() > 1) &&
-				(v3.getX() < -1 || v3.getX() > 1 || v3.getY() < -1 || v3.getX() > 1)))
-				continue;
+	int Renderer::getWorkerCount()
+	{
+		if (_rasteriser != 0)
+			return _rasteriser->getWorkerCount();
 
-			Vector normal = _world.top() * triangle.normals[frame];
-			
-			Vertex& v1cam = cam[triangle.A];
-			Vertex& v2cam = cam[triangle.B];
-			Vertex& v3cam = cam[triangle.C];
+		return _workerCount;
+	}
 
-			float cos = normal.dot(v1cam);
+	/*
+	 * Forces the rasteriser onto an instruction set, or AUTO to pick the widest the CPU supports
+	 */
+	void Renderer::setRasterPath(RasterPath path)
+	{
+		_rasterPath = path;
 
-			if (cos < 0)
-				continue;
+		if (_rasteriser != 0)
+			_rasteriser->setRasterPath(path);
+	}
 
-			normal.normalise();
-			
-			Vector normalA = normalBuffer[triangle.A].getNormalised();
-			Vector normalB = normalBuffer[triangle.B].getNormalised();
-			Vector normalC = normalBuffer[triangle.C].getNormalised();
-
-			float x1 = v1(0, 0) * _width + _width/2.0f;
-			float y1 = v1(1, 0) * _height + _height/2.0f;
-			float z1 = v1(2, 0);
-			float x2 = v2(0, 0) * _width + _width/2.0f;
-			float y2 = v2(1, 0) * _height + _height/2.0f;
-			float z2 = v2(2, 0);
-			float x3 = v3(0, 0) * _width + _width/2.0f;
-			float y3 = v3(1, 0) * _height + _height/2.0f;
-			float z3 = v3(2, 0);
-			
-			_rasteriser->drawTriangle(x1, y1, z1, v1cam, normalA,
-									x2, y2, z2, v2cam, normalB,
-									x3, y3, z3, v3cam, normalC, _lights);
-		}
+	/*
+	 * Returns the instruction set the rasteriser is using
+	 */
+	RasterPath Renderer::getRasterPath()
+	{
+		if (_rasteriser != 0)
+			return _rasteriser->getRasterPath();
 
-		// Clean up memory
-		delete[] vertexBuffer;
-		delete[] normalBuffer;
-		delete[] cam;
-		delete[] screen;
+		return _rasterPath;
 	}
 
-	void Renderer::drawSolidPhongTextured(md2::MD2_Model& model, long time)
+	/*
+	 * Sets the size of the blocks the rasteriser walks triangles in (see Rasteriser::setBlockSize)
+	 */
+	void Renderer::setBlockSize(int size)
 	{
-		int vertexCount = model.getVertexCount();
-		int triangleCount = model.getTriangleCount();
+		_blockSize = size;
 
-		// Get reference to faces
-		const a3d::Triangle* triangles = model.getFaces();
+		if (_rasteriser != 0)
+			_rasteriser->setBlockSize(size);
+	}
 
-		// Create vertex buffer
-		Vertex* vertexBuffer = new Vertex[vertexCount];
-		Vertex* cam = new Vertex[vertexCount];
-		Vertex* screen = new Vertex[vertexCount];
+	int Renderer::getBlockSize()
+	{
+		if (_rasteriser != 0)
+			return _rasteriser->getBlockSize();
 
-		// Buffer for vertex normals
-		Vector* normalBuffer = new Vertex[vertexCount];
+		return _blockSize;
+	}
 
-		// Process vertices
-		model.processVertices(vertexBuffer, time);
+	/*
+	 * Sets the longest span textured triangles' texture coordinates are stepped affinely across,
+	 * or 0 to work them out at every pixel (see Rasteriser::setPerspectiveSpan)
+	 */
+	void Renderer::setPerspectiveSpan(int span)
+	{
+		_perspectiveSpan = span;
 
-		// Transform to world space
-		for (int i = 0; i < vertexCount; ++i)
-		{
-			// Do model view transformation
-			cam[i] = operator*(_world.top(), vertexBuffer[i]);
-			normalBuffer[i] = _world.top() * vertexBuffer[i].getNormal();
+		if (_rasteriser != 0)
+			_rasteriser->setPerspectiveSpan(span);
+	}
 
-			screen[i] = operator*(_projection.top(), cam[i]);
-			
-			screen[i](0, 0) /= screen[i](3, 0);
-			screen[i](1, 0) /= screen[i](3, 0);
-			screen[i](2, 0) /= screen[i](3, 0);
-		}
+	int Renderer::getPerspectiveSpan()
+	{
+		if (_rasteriser != 0)
+			return _rasteriser->getPerspectiveSpan();
 
-		int frame = model.getCurrentFrame();
-		for (int i = 0; i < triangleCount; ++i)
-		{
-			const Triangle& triangle = triangles[i];
+		return _perspectiveSpan;
+	}
 
-			Vertex& v1 = screen[triangle.A];
-			Vertex& v2 = screen[triangle.B];
-			Vertex& v3 = screen[triangle.C];
-			
-			// Cull polygon before the near plane
-			if (v1.getZ() < 0 || v2.getZ() < 0 || v3.getZ() < 0 ||
-			// or beyond the far plane
-				v1.getZ() > 1 || v2.getZ() > 1 || v3.getZ() > 1 ||
-			// or if all three vertices are entirely outside of the view
-				((v1.getX() < -1 || v1.getX() > 1 || v1.getY() < -1 || v1.getX() > 1) &&
-				(v2.getX() < -1 || v2.getX() > 1 || v2.getY() < -1 || v2.getX() > 1) &&
-				(v3.getX() < -1 || v3.getX() > 1 || v3.getY() < -1 || v3.getX() > 1)))
-				continue;
+	/*
+	 * Draws everything until endScene depth first, then shades only the pixels left visible
+	 * (see Rasteriser::setDepthPrepass)
+	 * It can be switched between scenes to compare it against drawing straight away
+	 */
+	void Renderer::setDepthPrepass(bool prepass)
+	{
+		_depthPrepass = prepass;
 
-			Vector normal = _world.top() * triangle.normals[frame];
-			
-			Vertex& v1cam = cam[triangle.A];
-			Vertex& v2cam = cam[triangle.B];
-			Vertex& v3cam = cam[triangle.C];
+		if (_rasteriser != 0)
+			_rasteriser->setDepthPrepass(prepass);
+	}
 
-			float cos = normal.dot(v1cam);
+	bool Renderer::getDepthPrepass()
+	{
+		return _depthPrepass;
+	}
 
-			if (cos < 0)
-				continue;
+	/*
+	 * Sets the format of the depth buffer (see DepthFormats), which is cleared if there's already a target
+	 */
+	void Renderer::setDepthFormat(DepthFormat format)
+	{
+		_depthFormat = format;
+		_clipper.setReversedDepth(format == DepthFormats::REVERSED_FLOAT32);
 
-			normal.normalise();
-			
-			Vector normalA = normalBuffer[triangle.A].getNormalised();
-			Vector normalB = normalBuffer[triangle.B].getNormalised();
-			Vector normalC = normalBuffer[triangle.C].getNormalised();
-
-			float x1 = v1(0, 0) * _width + _width/2.0f;
-			float y1 = v1(1, 0) * _height + _height/2.0f;
-			float z1 = v1(2, 0);
-			float x2 = v2(0, 0) * _width + _width/2.0f;
-			float y2 = v2(1, 0) * _height + _height/2.0f;
-			float z2 = v2(2, 0);
-			float x3 = v3(0, 0) * _width + _width/2.0f;
-			float y3 = v3(1, 0) * _height + _height/2.0f;
-			float z3 = v3(2, 0);
-
-			const UV* uvs = model.getUVs();
-
-			// Get UV coordinates
-			float AU = uvs[triangle.AT].U;
-			float AV = uvs[triangle.AT].V;
-			float BU = uvs[triangle.BT].U;
-
-			float BV = uvs[triangle.BT].V;
-			float CU = uvs[triangle.CT].U;
-			float CV = uvs[triangle.CT].V;
-
-			// Camera-space z coordinates
-			float AZ = cam[triangle.A].getZ();
-			float BZ = cam[triangle.B].getZ();
-			float CZ = cam[triangle.C].getZ();
-			
-			_rasteriser->drawTriangle(x1, y1, z1, v1cam, AU / AZ, AV / AZ, 1 / AZ, normalA,
-									x2, y2, z2, v2cam, BU / BZ, BV / BZ, 1 / BZ, normalB,
-									x3, y3, z3, v3cam, CU / CZ, CV / CZ, 1/ CZ, normalC,
-									model.getTextureCount(), model.getTextures(), _lights);
-		}
+		if (_rasteriser != 0)
+			_rasteriser->setDepthFormat(format);
+	}
 
-		// Clean up memory
-		delete[] vertexBuffer;
-		delete[] normalBuffer;
-		delete[] cam;
-		delete[] screen;
+	DepthFormat Renderer::getDepthFormat()
+	{
+		return _depthFormat;
 	}
 
-	void Renderer::setMatrixMode(MatrixMode mode)
+	/*
+	 * Sets how the rasteriser lays out the buffers it draws to (see FramebufferLayouts)
+	 * Changing it starts a new scene if there's already a target
+	 */
+	void Renderer::setFramebufferLayout(FramebufferLayout layout)
 	{
-		switch (mode)
-		{
-		case MatrixModes::PROJECTION:
-			_matrixStack = &_projection;
-			_matrixMode = mode;
-			break;
-		case MatrixModes::VIEW:
-			_matrixStack = &_view;
-			_matrixMode = mode;
-			break;
-		case MatrixModes::WORLD:
-		default:
-			_matrixStack = &_world;
-			_matrixMode = mode;
-			break;
-		}
+		_framebufferLayout = layout;
+
+		if (_rasteriser != 0)
+			_rasteriser->setFramebufferLayout(layout);
 	}
 
-	MatrixMode Renderer::getMatrixMode()
+	FramebufferLayout Renderer::getFramebufferLayout()
 	{
-		return _matrixMode;
+		return _framebufferLayout;
 	}
-		
-	void Renderer::setMaterialType(MaterialType type)
+
+	/*
+	 * Returns the memory the rasteriser uses for each pixel of the target (see Rasteriser::getBytesPerPixel)
+	 */
+	float Renderer::getBytesPerPixel()
 	{
-		_materialType = type;
+		if (_rasteriser != 0)
+			return _rasteriser->getBytesPerPixel();
+
+		return 0;
 	}
 
-	void Renderer::setShadingType(ShadingType type)
+	/*
+	 * Returns the rasteriser's block counters for the scene so far
+	 */
+	RasterStats Renderer::getRasterStats()
 	{
-		_shadingType = type;
+		if (_rasteriser != 0)
+			return _rasteriser->getStats();
+
+		return RasterStats();
 	}
 
-	void Renderer::setCullingType(CullingType type)
+	/*
+	 * Returns how many triangles drawn since the scene began crossed the near or far plane or the guard band,
+	 * and had to be clipped
+	 */
+	unsigned int Renderer::getClippedTriangles()
 	{
-		_cullingType = type;
+		return _clippedTriangles;
 	}
 
 	void Renderer::addLight(Light* light)
@@ -951,16 +931,57 @@ namespace a3d
 	void Renderer::setTarget(Pixel* pixelBuffer, int width, int height)
 	{
 		if (_rasteriser == 0)
-			_rasteriser = new Rasteriser(pixelBuffer, width, height);
+		{
+			_rasteriser = new Rasteriser(pixelBuffer, width, height, _depthFormat);
+			_rasteriser->setWorkerCount(_workerCount);
+			_rasteriser->setRasterPath(_rasterPath);
+			_rasteriser->setBlockSize(_blockSize);
+			_rasteriser->setPerspectiveSpan(_perspectiveSpan);
+			_rasteriser->setDepthPrepass(_depthPrepass);
+			_rasteriser->setFramebufferLayout(_framebufferLayout);
+		}
 		else
-			_rasteriser->setTarget(pixelBuffer, width, height);
+			_rasteriser->setTarget(pixelBuffer, width, height, _depthFormat);
 
 		_width = width;
 		_height = height;
+
+		_clipper.setViewport(width, height, _rasteriser->getGuardBandX(), _rasteriser->getGuardBandY());
 	}
 
 	void Renderer::beginScene(Pixel colour)
 	{
 		_rasteriser->beginScene(colour);
+
+		dropScene();
+	}
+
+	/*
+	 * Starts a scene without clearing the colour buffer, for when a background drawn over the whole screen will cover it
+	 */
+	void Renderer::beginScene()
+	{
+		_rasteriser->beginScene();
+
+		dropScene();
+	}
+
+	void Renderer::dropScene()
+	{
+		// Draws still queued from the last scene would be cleared away
+		_queue.clear();
+
+		_clippedTriangles = 0;
+	}
+
+	/*
+	 * Finishes the scene, drawing anything queued or kept for a depth pre-pass and lighting the pixels drawn
+	 * with DEFERRED_PHONG
+	 */
+	void Renderer::endScene()
+	{
+		drawQueue();
+
+		_rasteriser->endScene();
 	}
 }
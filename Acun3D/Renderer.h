@@ -7,15 +7,24 @@
 #include "MatrixMode.h"
 #include "Pixel.h"
 #include "Rasteriser.h"
+#include "Clipper.h"
 #include "Matrix.h"
 #include "MD2_Model.h"
 #include "Vertex.h"
 #include "PointLight.h"
 #include "DirectionalLight.h"
 #include "Spotlight.h"
+#include "LightList.h"
 #include "ShadingType.h"
 #include "MaterialType.h"
 #include "CullingType.h"
+#include "DrawOrder.h"
+#include "TextureFilter.h"
+#include "TextureAddressMode.h"
+#include "MipmapMode.h"
+#include "TextureLayout.h"
+#include "LightingAccuracy.h"
+#include "ProgramType.h"
 
 namespace a3d
 {
@@ -28,6 +37,8 @@ namespace a3d
 
 		void setTarget(Pixel* pixelBuffer, int _width, int _height);
 		void beginScene(Pixel colour);
+		void beginScene();
+		void endScene();
 
 		bool draw(md2::MD2_Model& model, long time = 0);
 		
@@ -38,6 +49,64 @@ namespace a3d
 		void setShadingType(ShadingType type);
 		void setCullingType(CullingType type);
 
+		void setTextureFilter(TextureFilter filter);
+		TextureFilter getTextureFilter();
+
+		void setTextureAddressMode(TextureAddressMode mode);
+		TextureAddressMode getTextureAddressMode();
+
+		void setMipmapMode(MipmapMode mode);
+		MipmapMode getMipmapMode();
+
+		void setTextureLayout(TextureLayout layout);
+		TextureLayout getTextureLayout();
+
+		void setLightingAccuracy(LightingAccuracy accuracy);
+		LightingAccuracy getLightingAccuracy();
+
+		/*
+		 * Sets a program (see Programs.h) for solid and textured models drawn from then on to be shaded with,
+		 * in place of the shading type, until clearProgram
+		 * The program is read until the models drawn with it are, so it has to last until then unchanged
+		 * A CUSTOM program's kernels are looked up here, so its files specialising getProgramKernels for each path
+		 * (see ProgramKernels.h) have to be linked in
+		 */
+		template <class Program>
+		void setProgram(const Program& program)
+		{
+			_program = ProgramBinding::bind(program);
+		}
+
+		void clearProgram();
+
+		void setDrawOrder(DrawOrder order);
+		DrawOrder getDrawOrder();
+
+		void setWorkerCount(int count);
+		int getWorkerCount();
+
+		void setRasterPath(RasterPath path);
+		RasterPath getRasterPath();
+
+		void setBlockSize(int size);
+		int getBlockSize();
+
+		void setPerspectiveSpan(int span);
+		int getPerspectiveSpan();
+
+		void setDepthPrepass(bool prepass);
+		bool getDepthPrepass();
+
+		void setDepthFormat(DepthFormat format);
+		DepthFormat getDepthFormat();
+		float getBytesPerPixel();
+
+		void setFramebufferLayout(FramebufferLayout layout);
+		FramebufferLayout getFramebufferLayout();
+
+		RasterStats getRasterStats();
+		unsigned int getClippedTriangles();
+
 		void addLight(Light* light);
 		void removeLight(Light* light);
 		void clearLights();
@@ -52,26 +121,109 @@ namespace a3d
 		void transform(const Matrix4f& m);
 
 	private:
-		void drawWireFrame(md2::MD2_Model& model, long time);
-		void drawSolidFlat(md2::MD2_Model& model, long time);
-		void drawSolidFlatTextured(md2::MD2_Model& model, long time);
-		void drawSolidSmooth(md2::MD2_Model& model, long time);
-		void drawSolidSmoothTextured(md2::MD2_Model& model, long time);
-		void drawSolidPhong(md2::MD2_Model& model, long time);
-		void drawSolidPhongTextured(md2::MD2_Model& model, long time);
+		// Number of consecutive triangles of a model ordered together when drawing front to back
+		static const int TRIANGLE_CLUSTER_SIZE = 64;
+
+		/*
+		 * A draw waiting for endScene, with the state it was given in
+		 */
+		struct QueuedDraw
+		{
+			md2::MD2_Model* model;
+			long time;
+
+			Matrix4f world;
+			Matrix4f view;
+			Matrix4f projection;
+
+			MaterialType materialType;
+			ShadingType shadingType;
+			CullingType cullingType;
+			TextureFilter textureFilter;
+			TextureAddressMode textureAddressMode;
+			MipmapMode mipmapMode;
+			TextureLayout textureLayout;
+			LightingAccuracy lightingAccuracy;
+			ProgramBinding program;
+
+			std::vector<Light*> lights;
+
+			// View-space distance to the nearest point of the model's bounding sphere
+			float depth;
+		};
+
+		void dropScene();
+
+		void drawModel(md2::MD2_Model& model, long time, const Matrix4f& view);
+		void queueDraw(md2::MD2_Model& model, long time, const Matrix4f& view);
+		void drawQueue();
+		static bool isDrawnBefore(const QueuedDraw& a, const QueuedDraw& b);
+		const int* orderTriangles(const md2::MD2_Model& model, const Vertex* cam);
+		Matrix4f getProjection();
+
+		// Draws a model's triangles with a material and shading
+		typedef void (Renderer::*DrawFunction)(md2::MD2_Model& model, long time);
+
+		static DrawFunction getDrawFunction(MaterialType material, ShadingType shading, const ProgramBinding& program);
+
+		template <class Material, class Shading>
+		void drawTriangles(md2::MD2_Model& model, long time);
 
 		Rasteriser* _rasteriser;	
 		unsigned int _width;
 		unsigned int _height;
 
+		// Number of rasteriser threads (0 for one per hardware thread)
+		int _workerCount;
+
+		// Instruction set the rasteriser kernels use
+		RasterPath _rasterPath;
+
+		// Size of the blocks the rasteriser walks triangles in
+		int _blockSize;
+
+		// Longest affine texture span, or 0 for perspective-correct texture coordinates at every pixel
+		int _perspectiveSpan;
+
+		// Whether draws are kept until endScene and shaded after a depth pre-pass
+		bool _depthPrepass;
+
+		// Format of the depth buffer of each target
+		DepthFormat _depthFormat;
+
+		// Layout of the buffers the rasteriser draws to
+		FramebufferLayout _framebufferLayout;
+
 		// Clipping distances
 		float _nearView;
 		float _farView;
 
+		// Clips triangles crossing the near or far plane or the guard band, and how many it has clipped this scene
+		Clipper _clipper;
+		unsigned int _clippedTriangles;
+
 		// Rendering modes
 		MaterialType _materialType;
 		ShadingType _shadingType;
 		CullingType _cullingType;
+
+		// How textures are sampled
+		TextureFilter _textureFilter;
+		TextureAddressMode _textureAddressMode;
+		MipmapMode _mipmapMode;
+		TextureLayout _textureLayout;
+
+		// How accurately lighting maths is done
+		LightingAccuracy _lightingAccuracy;
+
+		// Program shading solid and textured models, if any
+		ProgramBinding _program;
+
+		// Order models and their triangles are drawn in, draws waiting for endScene and
+		// the order of the triangles of the model being drawn
+		DrawOrder _drawOrder;
+		std::vector<QueuedDraw> _queue;
+		std::vector<int> _triangleOrder;
 		
 		// Static lights for fullbright (_shadingType == ShadingTypes::NONE)
 		AmbientLight _fullBright;
@@ -80,6 +232,9 @@ namespace a3d
 		// Light in the scene
 		std::vector<Light*> _lights;
 
+		// View-space lights of the model being drawn, compiled for per-pixel lighting
+		LightList _lightList;
+
 		// Current Matrix Stack
 		std::stack<Matrix4f>* _matrixStack;
 
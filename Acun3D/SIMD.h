@@ -0,0 +1,624 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+// Small vector types for code that works on several values at once
+//   simd::scalar  float4 / int4 in plain C++
+//   simd::sse2    float4 / int4
+//   simd::neon    float4 / int4
+//   simd::avx2    float8 / int8
+//   simd::avx512  float16 / int16
+// Define SIMD_SCALAR, SIMD_SSE2, SIMD_NEON, SIMD_AVX2 or SIMD_AVX512 before including this to choose
+// the backends that are available, otherwise the best one for the compiler's target is used
+// Each backend has its own namespace so files built for different instruction sets never share code
+
+#if !defined(SIMD_SCALAR) && !defined(SIMD_SSE2) && !defined(SIMD_NEON) && !defined(SIMD_AVX2) && !defined(SIMD_AVX512)
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#else
+#define SIMD_SCALAR
+#endif
+#endif
+
+#include <math.h>
+
+#ifdef SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(SIMD_AVX2) || defined(SIMD_AVX512)
+#include <immintrin.h>
+#endif
+
+#ifdef SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace a3d
+{
+	namespace simd
+	{
+		// Every backend provides, for its float type F and int type I:
+		//   F(float), I(int)            broadcast
+		//   F::ramp(), I::ramp(step)    0, 1, 2 ... and 0, step, 2 * step ...
+		//   F::load(p), I::load(p)      unaligned load, store(p, v) unaligned store
+		//   + - * / on F, + - * & | << >> on I (>> is logical)
+		//   a >> n with an I n          shifts each lane by its own count (0 .. 31), logically
+		//   min, max                    if either is NaN the second argument is returned
+		//   sqrt                        square root of F
+		//   reciprocalSqrt              estimate of 1 / sqrt of F, refined to about 22 bits
+		//   toInt, toFloat              conversions, toInt rounds to nearest with ties to even on every path
+		//   greater, greaterEqual,      comparisons of F or I giving an I mask with all bits set where true
+		//   equal
+		//   select(mask, a, b)          a where mask is set, otherwise b
+		//   bits(mask)                  one bit per lane, set where the mask is
+		//   gather(base, index)         base[index] for each lane
+
+#ifdef SIMD_SCALAR
+		namespace scalar
+		{
+			struct int4;
+
+			struct float4
+			{
+				static const int WIDTH = 4;
+
+				typedef int4 Int;
+
+				float v[4];
+
+				float4() {}
+				float4(float f) { v[0] = v[1] = v[2] = v[3] = f; }
+
+				static float4 ramp()
+				{
+					float4 r;
+					for (int i = 0; i < 4; ++i)
+						r.v[i] = (float)i;
+					return r;
+				}
+
+				static float4 load(const float* p)
+				{
+					float4 r;
+					for (int i = 0; i < 4; ++i)
+						r.v[i] = p[i];
+					return r;
+				}
+			};
+
+			struct int4
+			{
+				static const int WIDTH = 4;
+
+				typedef float4 Float;
+
+				int v[4];
+
+				int4() {}
+				int4(int i) { v[0] = v[1] = v[2] = v[3] = i; }
+
+				static int4 ramp(int step)
+				{
+					int4 r;
+					for (int i = 0; i < 4; ++i)
+						r.v[i] = step * i;
+					return r;
+				}
+
+				static int4 load(const int* p)
+				{
+					int4 r;
+					for (int i = 0; i < 4; ++i)
+						r.v[i] = p[i];
+					return r;
+				}
+			};
+
+			inline void store(float* p, const float4& a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+			inline void store(int* p, const int4& a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+
+			inline float4 operator+ (const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+			inline float4 operator- (const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+			inline float4 operator* (const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+			inline float4 operator/ (const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] / b.v[i]; return r; }
+
+			inline int4 operator+ (const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+			inline int4 operator- (const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+			inline int4 operator* (const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+			inline int4 operator& (const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] & b.v[i]; return r; }
+			inline int4 operator| (const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] | b.v[i]; return r; }
+			inline int4 operator<< (const int4& a, int n) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] << n; return r; }
+			inline int4 operator>> (const int4& a, int n) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (int)((unsigned int)a.v[i] >> n); return r; }
+			inline int4 operator>> (const int4& a, const int4& n) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (int)((unsigned int)a.v[i] >> n.v[i]); return r; }
+
+			inline float4 min(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] < b.v[i] ? a.v[i] : b.v[i]); return r; }
+			inline float4 max(const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] > b.v[i] ? a.v[i] : b.v[i]); return r; }
+
+			inline float4 sqrt(const float4& a) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = ::sqrtf(a.v[i]); return r; }
+			inline float4 reciprocalSqrt(const float4& a) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = 1.0f / ::sqrtf(a.v[i]); return r; }
+
+			inline int4 toInt(const float4& a) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (int)lrintf(a.v[i]); return r; }
+			inline float4 toFloat(const int4& a) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = (float)a.v[i]; return r; }
+
+			inline int4 greater(const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] > b.v[i] ? -1 : 0); return r; }
+			inline int4 greaterEqual(const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] >= b.v[i] ? -1 : 0); return r; }
+			inline int4 equal(const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] == b.v[i] ? -1 : 0); return r; }
+			inline int4 greater(const float4& a, const float4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] > b.v[i] ? -1 : 0); return r; }
+			inline int4 greaterEqual(const float4& a, const float4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] >= b.v[i] ? -1 : 0); return r; }
+			inline int4 equal(const float4& a, const float4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] == b.v[i] ? -1 : 0); return r; }
+
+			inline float4 select(const int4& mask, const float4& a, const float4& b) { float4 r; for (int i = 0; i < 4; ++i) r.v[i] = (mask.v[i] ? a.v[i] : b.v[i]); return r; }
+			inline int4 select(const int4& mask, const int4& a, const int4& b) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = (mask.v[i] ? a.v[i] : b.v[i]); return r; }
+
+			inline int bits(const int4& mask)
+			{
+				int r = 0;
+				for (int i = 0; i < 4; ++i)
+					r |= (mask.v[i] ? 1 << i : 0);
+				return r;
+			}
+
+			inline int4 gather(const int* base, const int4& index) { int4 r; for (int i = 0; i < 4; ++i) r.v[i] = base[index.v[i]]; return r; }
+		}
+#endif
+
+#ifdef SIMD_SSE2
+		namespace sse2
+		{
+			struct int4;
+
+			struct float4
+			{
+				static const int WIDTH = 4;
+
+				typedef int4 Int;
+
+				__m128 v;
+
+				float4() {}
+				float4(__m128 v) : v(v) {}
+				float4(float f) : v(_mm_set1_ps(f)) {}
+
+				static float4 ramp() { return _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f); }
+				static float4 load(const float* p) { return _mm_loadu_ps(p); }
+			};
+
+			struct int4
+			{
+				static const int WIDTH = 4;
+
+				typedef float4 Float;
+
+				__m128i v;
+
+				int4() {}
+				int4(__m128i v) : v(v) {}
+				int4(int i) : v(_mm_set1_epi32(i)) {}
+
+				static int4 ramp(int step) { return _mm_set_epi32(step * 3, step * 2, step, 0); }
+				static int4 load(const int* p) { return _mm_loadu_si128((const __m128i*)p); }
+			};
+
+			inline void store(float* p, const float4& a) { _mm_storeu_ps(p, a.v); }
+			inline void store(int* p, const int4& a) { _mm_storeu_si128((__m128i*)p, a.v); }
+
+			inline float4 operator+ (const float4& a, const float4& b) { return _mm_add_ps(a.v, b.v); }
+			inline float4 operator- (const float4& a, const float4& b) { return _mm_sub_ps(a.v, b.v); }
+			inline float4 operator* (const float4& a, const float4& b) { return _mm_mul_ps(a.v, b.v); }
+			inline float4 operator/ (const float4& a, const float4& b) { return _mm_div_ps(a.v, b.v); }
+
+			inline int4 operator+ (const int4& a, const int4& b) { return _mm_add_epi32(a.v, b.v); }
+			inline int4 operator- (const int4& a, const int4& b) { return _mm_sub_epi32(a.v, b.v); }
+			inline int4 operator& (const int4& a, const int4& b) { return _mm_and_si128(a.v, b.v); }
+			inline int4 operator| (const int4& a, const int4& b) { return _mm_or_si128(a.v, b.v); }
+			inline int4 operator<< (const int4& a, int n) { return _mm_slli_epi32(a.v, n); }
+			inline int4 operator>> (const int4& a, int n) { return _mm_srli_epi32(a.v, n); }
+
+			// SSE2 shifts every lane by the same count, so shift by each lane's count and keep that lane
+			inline int4 operator>> (const int4& a, const int4& n)
+			{
+				const __m128i r0 = _mm_srl_epi32(a.v, _mm_and_si128(n.v, _mm_set_epi32(0, 0, 0, -1)));
+				const __m128i r1 = _mm_srl_epi32(a.v, _mm_srli_epi64(n.v, 32));
+				const __m128i r2 = _mm_srl_epi32(a.v, _mm_and_si128(_mm_srli_si128(n.v, 8), _mm_set_epi32(0, 0, 0, -1)));
+				const __m128i r3 = _mm_srl_epi32(a.v, _mm_srli_si128(n.v, 12));
+
+				// Lane i from ri
+				const __m128 low = _mm_shuffle_ps(_mm_castsi128_ps(r0), _mm_castsi128_ps(r1), _MM_SHUFFLE(1, 1, 0, 0));
+				const __m128 high = _mm_shuffle_ps(_mm_castsi128_ps(r2), _mm_castsi128_ps(r3), _MM_SHUFFLE(3, 3, 2, 2));
+
+				return _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+			}
+
+			// SSE2 has no 32-bit multiply, so multiply the even and odd lanes separately and interleave them
+			inline int4 operator* (const int4& a, const int4& b)
+			{
+				__m128i even = _mm_mul_epu32(a.v, b.v);
+				__m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), _mm_srli_si128(b.v, 4));
+
+				return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+											_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+			}
+
+			inline float4 min(const float4& a, const float4& b) { return _mm_min_ps(a.v, b.v); }
+			inline float4 max(const float4& a, const float4& b) { return _mm_max_ps(a.v, b.v); }
+
+			inline float4 sqrt(const float4& a) { return _mm_sqrt_ps(a.v); }
+
+			// The 12-bit estimate with a Newton-Raphson step
+			inline float4 reciprocalSqrt(const float4& a)
+			{
+				const __m128 r = _mm_rsqrt_ps(a.v);
+				const __m128 arr = _mm_mul_ps(_mm_mul_ps(a.v, r), r);
+				return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), r), _mm_sub_ps(_mm_set1_ps(3.0f), arr));
+			}
+
+			inline int4 toInt(const float4& a) { return _mm_cvtps_epi32(a.v); }
+			inline float4 toFloat(const int4& a) { return _mm_cvtepi32_ps(a.v); }
+
+			inline int4 greater(const int4& a, const int4& b) { return _mm_cmpgt_epi32(a.v, b.v); }
+			inline int4 greaterEqual(const int4& a, const int4& b) { return _mm_or_si128(_mm_cmpgt_epi32(a.v, b.v), _mm_cmpeq_epi32(a.v, b.v)); }
+			inline int4 equal(const int4& a, const int4& b) { return _mm_cmpeq_epi32(a.v, b.v); }
+			inline int4 greater(const float4& a, const float4& b) { return _mm_castps_si128(_mm_cmpgt_ps(a.v, b.v)); }
+			inline int4 greaterEqual(const float4& a, const float4& b) { return _mm_castps_si128(_mm_cmpge_ps(a.v, b.v)); }
+			inline int4 equal(const float4& a, const float4& b) { return _mm_castps_si128(_mm_cmpeq_ps(a.v, b.v)); }
+
+			inline float4 select(const int4& mask, const float4& a, const float4& b)
+			{
+				__m128 m = _mm_castsi128_ps(mask.v);
+
+				return _mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v));
+			}
+
+			inline int4 select(const int4& mask, const int4& a, const int4& b)
+			{
+				return _mm_or_si128(_mm_and_si128(mask.v, a.v), _mm_andnot_si128(mask.v, b.v));
+			}
+
+			inline int bits(const int4& mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask.v)); }
+
+			inline int4 gather(const int* base, const int4& index)
+			{
+				int i[4];
+				_mm_storeu_si128((__m128i*)i, index.v);
+
+				return _mm_set_epi32(base[i[3]], base[i[2]], base[i[1]], base[i[0]]);
+			}
+		}
+#endif
+
+#ifdef SIMD_NEON
+		namespace neon
+		{
+			struct int4;
+
+			struct float4
+			{
+				static const int WIDTH = 4;
+
+				typedef int4 Int;
+
+				float32x4_t v;
+
+				float4() {}
+				float4(float32x4_t v) : v(v) {}
+				float4(float f) : v(vdupq_n_f32(f)) {}
+
+				static float4 ramp()
+				{
+					static const float r[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+					return vld1q_f32(r);
+				}
+
+				static float4 load(const float* p) { return vld1q_f32(p); }
+			};
+
+			struct int4
+			{
+				static const int WIDTH = 4;
+
+				typedef float4 Float;
+
+				int32x4_t v;
+
+				int4() {}
+				int4(int32x4_t v) : v(v) {}
+				int4(int i) : v(vdupq_n_s32(i)) {}
+
+				static int4 ramp(int step)
+				{
+					static const int r[4] = { 0, 1, 2, 3 };
+					return vmulq_n_s32(vld1q_s32(r), step);
+				}
+
+				static int4 load(const int* p) { return vld1q_s32(p); }
+			};
+
+			inline void store(float* p, const float4& a) { vst1q_f32(p, a.v); }
+			inline void store(int* p, const int4& a) { vst1q_s32(p, a.v); }
+
+			inline float4 operator+ (const float4& a, const float4& b) { return vaddq_f32(a.v, b.v); }
+			inline float4 operator- (const float4& a, const float4& b) { return vsubq_f32(a.v, b.v); }
+			inline float4 operator* (const float4& a, const float4& b) { return vmulq_f32(a.v, b.v); }
+
+			inline float4 operator/ (const float4& a, const float4& b)
+			{
+#ifdef __aarch64__
+				return vdivq_f32(a.v, b.v);
+#else
+				// No divide on 32-bit ARM, so refine the reciprocal estimate twice
+				float32x4_t r = vrecpeq_f32(b.v);
+				r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+				r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+				return vmulq_f32(a.v, r);
+#endif
+			}
+
+			inline int4 operator+ (const int4& a, const int4& b) { return vaddq_s32(a.v, b.v); }
+			inline int4 operator- (const int4& a, const int4& b) { return vsubq_s32(a.v, b.v); }
+			inline int4 operator* (const int4& a, const int4& b) { return vmulq_s32(a.v, b.v); }
+			inline int4 operator& (const int4& a, const int4& b) { return vandq_s32(a.v, b.v); }
+			inline int4 operator| (const int4& a, const int4& b) { return vorrq_s32(a.v, b.v); }
+			inline int4 operator<< (const int4& a, int n) { return vshlq_s32(a.v, vdupq_n_s32(n)); }
+			inline int4 operator>> (const int4& a, int n) { return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a.v), vdupq_n_s32(-n))); }
+			inline int4 operator>> (const int4& a, const int4& n) { return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a.v), vnegq_s32(n.v))); }
+
+			// NEON min/max propagate NaNs, so pick with a comparison to match the other backends
+			inline float4 min(const float4& a, const float4& b) { return vbslq_f32(vcltq_f32(a.v, b.v), a.v, b.v); }
+			inline float4 max(const float4& a, const float4& b) { return vbslq_f32(vcgtq_f32(a.v, b.v), a.v, b.v); }
+
+			// The 8-bit estimate with two Newton-Raphson steps
+			inline float4 reciprocalSqrt(const float4& a)
+			{
+				float32x4_t r = vrsqrteq_f32(a.v);
+				r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a.v, r), r), r);
+				r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a.v, r), r), r);
+				return r;
+			}
+
+			inline float4 sqrt(const float4& a)
+			{
+#ifdef __aarch64__
+				return vsqrtq_f32(a.v);
+#else
+				// No square root on 32-bit ARM, so multiply by the reciprocal, keeping zero as it is
+				// rather than multiplying it by infinity
+				const float32x4_t r = vmulq_f32(a.v, reciprocalSqrt(a).v);
+				return vbslq_f32(vceqq_f32(a.v, vdupq_n_f32(0.0f)), a.v, r);
+#endif
+			}
+
+			inline int4 toInt(const float4& a)
+			{
+#ifdef __aarch64__
+				return vcvtnq_s32_f32(a.v);
+#else
+				// Adding and taking away 2^23 with the sign of a rounds it to nearest even, as the other paths do,
+				// and anything that large already is a whole number
+				const float32x4_t big = vdupq_n_f32(8388608.0f);
+				const float32x4_t magic = vbslq_f32(vdupq_n_u32(0x80000000), a.v, big);
+				const float32x4_t rounded = vsubq_f32(vaddq_f32(a.v, magic), magic);
+				return vcvtq_s32_f32(vbslq_f32(vcaltq_f32(a.v, big), rounded, a.v));
+#endif
+			}
+
+			inline float4 toFloat(const int4& a) { return vcvtq_f32_s32(a.v); }
+
+			inline int4 greater(const int4& a, const int4& b) { return vreinterpretq_s32_u32(vcgtq_s32(a.v, b.v)); }
+			inline int4 greaterEqual(const int4& a, const int4& b) { return vreinterpretq_s32_u32(vcgeq_s32(a.v, b.v)); }
+			inline int4 equal(const int4& a, const int4& b) { return vreinterpretq_s32_u32(vceqq_s32(a.v, b.v)); }
+			inline int4 greater(const float4& a, const float4& b) { return vreinterpretq_s32_u32(vcgtq_f32(a.v, b.v)); }
+			inline int4 greaterEqual(const float4& a, const float4& b) { return vreinterpretq_s32_u32(vcgeq_f32(a.v, b.v)); }
+			inline int4 equal(const float4& a, const float4& b) { return vreinterpretq_s32_u32(vceqq_f32(a.v, b.v)); }
+
+			inline float4 select(const int4& mask, const float4& a, const float4& b) { return vbslq_f32(vreinterpretq_u32_s32(mask.v), a.v, b.v); }
+			inline int4 select(const int4& mask, const int4& a, const int4& b) { return vbslq_s32(vreinterpretq_u32_s32(mask.v), a.v, b.v); }
+
+			inline int bits(const int4& mask)
+			{
+				static const unsigned int weights[4] = { 1, 2, 4, 8 };
+				uint32x4_t b = vandq_u32(vreinterpretq_u32_s32(mask.v), vld1q_u32(weights));
+
+				return (int)(vgetq_lane_u32(b, 0) | vgetq_lane_u32(b, 1) | vgetq_lane_u32(b, 2) | vgetq_lane_u32(b, 3));
+			}
+
+			inline int4 gather(const int* base, const int4& index)
+			{
+				int i[4];
+				vst1q_s32(i, index.v);
+
+				int r[4] = { base[i[0]], base[i[1]], base[i[2]], base[i[3]] };
+				return vld1q_s32(r);
+			}
+		}
+#endif
+
+#ifdef SIMD_AVX2
+		namespace avx2
+		{
+			struct int8;
+
+			struct float8
+			{
+				static const int WIDTH = 8;
+
+				typedef int8 Int;
+
+				__m256 v;
+
+				float8() {}
+				float8(__m256 v) : v(v) {}
+				float8(float f) : v(_mm256_set1_ps(f)) {}
+
+				static float8 ramp() { return _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f); }
+				static float8 load(const float* p) { return _mm256_loadu_ps(p); }
+			};
+
+			struct int8
+			{
+				static const int WIDTH = 8;
+
+				typedef float8 Float;
+
+				__m256i v;
+
+				int8() {}
+				int8(__m256i v) : v(v) {}
+				int8(int i) : v(_mm256_set1_epi32(i)) {}
+
+				static int8 ramp(int step) { return _mm256_mullo_epi32(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_epi32(step)); }
+				static int8 load(const int* p) { return _mm256_loadu_si256((const __m256i*)p); }
+			};
+
+			inline void store(float* p, const float8& a) { _mm256_storeu_ps(p, a.v); }
+			inline void store(int* p, const int8& a) { _mm256_storeu_si256((__m256i*)p, a.v); }
+
+			inline float8 operator+ (const float8& a, const float8& b) { return _mm256_add_ps(a.v, b.v); }
+			inline float8 operator- (const float8& a, const float8& b) { return _mm256_sub_ps(a.v, b.v); }
+			inline float8 operator* (const float8& a, const float8& b) { return _mm256_mul_ps(a.v, b.v); }
+			inline float8 operator/ (const float8& a, const float8& b) { return _mm256_div_ps(a.v, b.v); }
+
+			inline int8 operator+ (const int8& a, const int8& b) { return _mm256_add_epi32(a.v, b.v); }
+			inline int8 operator- (const int8& a, const int8& b) { return _mm256_sub_epi32(a.v, b.v); }
+			inline int8 operator* (const int8& a, const int8& b) { return _mm256_mullo_epi32(a.v, b.v); }
+			inline int8 operator& (const int8& a, const int8& b) { return _mm256_and_si256(a.v, b.v); }
+			inline int8 operator| (const int8& a, const int8& b) { return _mm256_or_si256(a.v, b.v); }
+			inline int8 operator<< (const int8& a, int n) { return _mm256_slli_epi32(a.v, n); }
+			inline int8 operator>> (const int8& a, int n) { return _mm256_srli_epi32(a.v, n); }
+			inline int8 operator>> (const int8& a, const int8& n) { return _mm256_srlv_epi32(a.v, n.v); }
+
+			inline float8 min(const float8& a, const float8& b) { return _mm256_min_ps(a.v, b.v); }
+			inline float8 max(const float8& a, const float8& b) { return _mm256_max_ps(a.v, b.v); }
+
+			inline float8 sqrt(const float8& a) { return _mm256_sqrt_ps(a.v); }
+
+			// The 12-bit estimate with a Newton-Raphson step
+			inline float8 reciprocalSqrt(const float8& a)
+			{
+				const __m256 r = _mm256_rsqrt_ps(a.v);
+				const __m256 arr = _mm256_mul_ps(_mm256_mul_ps(a.v, r), r);
+				return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), r), _mm256_sub_ps(_mm256_set1_ps(3.0f), arr));
+			}
+
+			inline int8 toInt(const float8& a) { return _mm256_cvtps_epi32(a.v); }
+			inline float8 toFloat(const int8& a) { return _mm256_cvtepi32_ps(a.v); }
+
+			inline int8 greater(const int8& a, const int8& b) { return _mm256_cmpgt_epi32(a.v, b.v); }
+			inline int8 greaterEqual(const int8& a, const int8& b) { return _mm256_or_si256(_mm256_cmpgt_epi32(a.v, b.v), _mm256_cmpeq_epi32(a.v, b.v)); }
+			inline int8 equal(const int8& a, const int8& b) { return _mm256_cmpeq_epi32(a.v, b.v); }
+			inline int8 greater(const float8& a, const float8& b) { return _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+			inline int8 greaterEqual(const float8& a, const float8& b) { return _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+			inline int8 equal(const float8& a, const float8& b) { return _mm256_castps_si256(_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)); }
+
+			inline float8 select(const int8& mask, const float8& a, const float8& b) { return _mm256_blendv_ps(b.v, a.v, _mm256_castsi256_ps(mask.v)); }
+			inline int8 select(const int8& mask, const int8& a, const int8& b) { return _mm256_blendv_epi8(b.v, a.v, mask.v); }
+
+			inline int bits(const int8& mask) { return _mm256_movemask_ps(_mm256_castsi256_ps(mask.v)); }
+
+			inline int8 gather(const int* base, const int8& index) { return _mm256_i32gather_epi32(base, index.v, 4); }
+		}
+#endif
+
+#ifdef SIMD_AVX512
+		namespace avx512
+		{
+			struct int16;
+
+			struct float16
+			{
+				static const int WIDTH = 16;
+
+				typedef int16 Int;
+
+				__m512 v;
+
+				float16() {}
+				float16(__m512 v) : v(v) {}
+				float16(float f) : v(_mm512_set1_ps(f)) {}
+
+				static float16 ramp()
+				{
+					return _mm512_set_ps(15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f,
+											7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+				}
+
+				static float16 load(const float* p) { return _mm512_loadu_ps(p); }
+			};
+
+			struct int16
+			{
+				static const int WIDTH = 16;
+
+				typedef float16 Float;
+
+				__m512i v;
+
+				int16() {}
+				int16(__m512i v) : v(v) {}
+				int16(int i) : v(_mm512_set1_epi32(i)) {}
+
+				static int16 ramp(int step)
+				{
+					return _mm512_mullo_epi32(_mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0),
+												_mm512_set1_epi32(step));
+				}
+
+				static int16 load(const int* p) { return _mm512_loadu_si512(p); }
+			};
+
+			inline void store(float* p, const float16& a) { _mm512_storeu_ps(p, a.v); }
+			inline void store(int* p, const int16& a) { _mm512_storeu_si512(p, a.v); }
+
+			inline float16 operator+ (const float16& a, const float16& b) { return _mm512_add_ps(a.v, b.v); }
+			inline float16 operator- (const float16& a, const float16& b) { return _mm512_sub_ps(a.v, b.v); }
+			inline float16 operator* (const float16& a, const float16& b) { return _mm512_mul_ps(a.v, b.v); }
+			inline float16 operator/ (const float16& a, const float16& b) { return _mm512_div_ps(a.v, b.v); }
+
+			inline int16 operator+ (const int16& a, const int16& b) { return _mm512_add_epi32(a.v, b.v); }
+			inline int16 operator- (const int16& a, const int16& b) { return _mm512_sub_epi32(a.v, b.v); }
+			inline int16 operator* (const int16& a, const int16& b) { return _mm512_mullo_epi32(a.v, b.v); }
+			inline int16 operator& (const int16& a, const int16& b) { return _mm512_and_si512(a.v, b.v); }
+			inline int16 operator| (const int16& a, const int16& b) { return _mm512_or_si512(a.v, b.v); }
+			inline int16 operator<< (const int16& a, int n) { return _mm512_slli_epi32(a.v, n); }
+			inline int16 operator>> (const int16& a, int n) { return _mm512_srli_epi32(a.v, n); }
+			inline int16 operator>> (const int16& a, const int16& n) { return _mm512_srlv_epi32(a.v, n.v); }
+
+			inline float16 min(const float16& a, const float16& b) { return _mm512_min_ps(a.v, b.v); }
+			inline float16 max(const float16& a, const float16& b) { return _mm512_max_ps(a.v, b.v); }
+
+			inline float16 sqrt(const float16& a) { return _mm512_sqrt_ps(a.v); }
+
+			// The 14-bit estimate with a Newton-Raphson step
+			inline float16 reciprocalSqrt(const float16& a)
+			{
+				const __m512 r = _mm512_rsqrt14_ps(a.v);
+				const __m512 arr = _mm512_mul_ps(_mm512_mul_ps(a.v, r), r);
+				return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), r), _mm512_sub_ps(_mm512_set1_ps(3.0f), arr));
+			}
+
+			inline int16 toInt(const float16& a) { return _mm512_cvtps_epi32(a.v); }
+			inline float16 toFloat(const int16& a) { return _mm512_cvtepi32_ps(a.v); }
+
+			// Comparisons give mask registers, which are widened back out to vectors
+			inline int16 greater(const int16& a, const int16& b) { return _mm512_maskz_set1_epi32(_mm512_cmpgt_epi32_mask(a.v, b.v), -1); }
+			inline int16 greaterEqual(const int16& a, const int16& b) { return _mm512_maskz_set1_epi32(_mm512_cmpge_epi32_mask(a.v, b.v), -1); }
+			inline int16 equal(const int16& a, const int16& b) { return _mm512_maskz_set1_epi32(_mm512_cmpeq_epi32_mask(a.v, b.v), -1); }
+			inline int16 greater(const float16& a, const float16& b) { return _mm512_maskz_set1_epi32(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ), -1); }
+			inline int16 greaterEqual(const float16& a, const float16& b) { return _mm512_maskz_set1_epi32(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ), -1); }
+			inline int16 equal(const float16& a, const float16& b) { return _mm512_maskz_set1_epi32(_mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ), -1); }
+
+			inline float16 select(const int16& mask, const float16& a, const float16& b) { return _mm512_mask_blend_ps(_mm512_test_epi32_mask(mask.v, mask.v), b.v, a.v); }
+			inline int16 select(const int16& mask, const int16& a, const int16& b) { return _mm512_mask_blend_epi32(_mm512_test_epi32_mask(mask.v, mask.v), b.v, a.v); }
+
+			inline int bits(const int16& mask) { return (int)_mm512_test_epi32_mask(mask.v, mask.v); }
+
+			inline int16 gather(const int* base, const int16& index) { return _mm512_i32gather_epi32(index.v, base, 4); }
+		}
+#endif
+	}
+}
+
+#endif
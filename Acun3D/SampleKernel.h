@@ -0,0 +1,266 @@
+#ifndef __SAMPLEKERNEL_H__
+#define __SAMPLEKERNEL_H__
+
+// Texture sampling is built once per instruction set along with the span kernel, which includes this after
+// its SIMD.h backend has been chosen
+// Everything here has internal linkage so code built for one instruction set can't end up used by another
+
+#include "SIMD.h"
+#include "Sampler.h"
+#include "SetupKernel.h"
+
+namespace a3d
+{
+	namespace
+	{
+		/*
+		 * Brings a vector of texture coordinates to where texels are read (see Sampler::address)
+		 */
+		template <class F>
+		F addressCoordinates(const Sampler& sampler, const F& coordinates, int size)
+		{
+			if (sampler.getAddressMode() == TextureAddressModes::CLAMP)
+				return min(max(coordinates, F(0.0f)), F((float)(size - 1)));
+
+			const float limit = (float)Sampler::MAX_COORDINATE;
+			const F clamped = min(max(coordinates, F(-limit)), F(limit));
+
+			if ((size & (size - 1)) == 0)
+				return clamped;
+
+			// Rounding half a texel down is a floor but for whole numbers, which are left a wrap further on,
+			// and the texels are wrapped again once they're ints
+			const F wraps = toFloat(toInt(clamped * F(1.0f / size) - F(0.5f)));
+
+			return clamped - wraps * F((float)size);
+		}
+
+		/*
+		 * Brings a vector of texels' coordinates onto the texture, from where addressCoordinates left them
+		 */
+		template <class I>
+		I addressTexels(const Sampler& sampler, const I& texels, int size, int mask)
+		{
+			if (sampler.getAddressMode() == TextureAddressModes::CLAMP)
+				return minInt(maxInt(texels, I(0)), I(size - 1));
+
+			// Sizes that are a power of two wrap with their mask, which is 0 for a level 1 texel across
+			if ((size & (size - 1)) == 0)
+				return texels & I(mask);
+
+			// Wrapped coordinates are already within a texel or so of the texture
+			const I wrapped = select(greater(texels, I(size - 1)), texels - I(size), texels);
+
+			return select(greater(I(0), wrapped), wrapped + I(size), wrapped);
+		}
+
+		/*
+		 * Spreads the low 16 bits of each lane out to the even bits (see Image::spreadBits)
+		 */
+		template <class I>
+		I spreadBits(const I& value)
+		{
+			I v = value;
+			v = (v | (v << 8)) & I(0x00FF00FF);
+			v = (v | (v << 4)) & I(0x0F0F0F0F);
+			v = (v | (v << 2)) & I(0x33333333);
+			v = (v | (v << 1)) & I(0x55555555);
+
+			return v;
+		}
+
+		/*
+		 * Returns where each lane's texel (x, y) is in the sampler's layout (see Sampler::getTexelIndex)
+		 */
+		template <class I>
+		I texelIndex(const Sampler& sampler, const I& x, const I& y)
+		{
+			if (sampler.getLayout() == TextureLayouts::LINEAR)
+				return y * I(sampler.getWidth()) + x;
+
+			const I three(3);
+
+			// Image::TILE_SIZE is 4
+			if (sampler.getLayout() == TextureLayouts::TILED)
+				return (((y >> 2) * I(sampler.getTilesX()) + (x >> 2)) << 4) | ((y & three) << 2) | (x & three);
+
+			const int bits = sampler.getMortonBits();
+			const I mask((1 << bits) - 1);
+
+			const I square = spreadBits(x & mask) | (spreadBits(y & mask) << 1);
+
+			return square + (((x >> bits) + (y >> bits)) << (bits * 2));
+		}
+
+		/*
+		 * Blends two vectors of packed colours, weight (0 .. Sampler::BLEND_SCALE) of the way from a to b
+		 * (see blend in Sampler.cpp)
+		 */
+		template <class I>
+		I blendTexels(const I& a, const I& b, const I& weight)
+		{
+			const I mask(0x00FF00FF);
+			const I inverse = I(Sampler::BLEND_SCALE) - weight;
+
+			const I rb = (((a & mask) * inverse + (b & mask) * weight) >> Sampler::BLEND_BITS) & mask;
+			const I ag = ((((a >> 8) & mask) * inverse + ((b >> 8) & mask) * weight) >> Sampler::BLEND_BITS) & mask;
+
+			return rb | (ag << 8);
+		}
+
+		/*
+		 * Widens each lane's RGB565 texel to an opaque BGRA8 colour (see Image::unpackRGB565)
+		 */
+		template <class I>
+		I unpackTexels(const I& texels)
+		{
+			const I red = (texels >> 11) & I(31);
+			const I green = (texels >> 5) & I(63);
+			const I blue = texels & I(31);
+
+			return I((int)0xFF000000) | (((red << 3) | (red >> 2)) << 16) | (((green << 2) | (green >> 4)) << 8) | (blue << 3) | (blue >> 2);
+		}
+
+		/*
+		 * Returns each lane's texel (x, y) from a level in a format other than BGRA8, as BGRA8
+		 * (see Sampler::decodeTexel)
+		 */
+		template <class I>
+		I decodeTexels(const Sampler& sampler, const I& x, const I& y)
+		{
+			const int* data = sampler.getData();
+			const I pitch(sampler.getPitch());
+
+			switch (sampler.getFormat())
+			{
+			case TextureFormats::INDEXED8:
+				{
+					const I words = gather(data, y * pitch + (x >> 2));
+
+					return gather(sampler.getPalette(), (words >> ((x & I(3)) << 3)) & I(0xFF));
+				}
+
+			case TextureFormats::RGB565:
+				{
+					const I words = gather(data, y * pitch + (x >> 1));
+
+					return unpackTexels((words >> ((x & I(1)) << 4)) & I(0xFFFF));
+				}
+
+			case TextureFormats::BC1:
+			default:
+				{
+					const I block = (y >> 2) * pitch + ((x >> 2) << 1);
+					const I three(3);
+
+					const I endpoints = gather(data, block);
+					const I selectors = (gather(data, block + I(1)) >> ((((y & three) << 2) | (x & three)) << 1)) & three;
+
+					const I first = unpackTexels(endpoints & I(0xFFFF));
+					const I second = unpackTexels(endpoints >> 16);
+
+					// The last two are a third and two thirds of the way from the first to the second
+					const int third = (Sampler::BLEND_SCALE + 1) / 3;
+					const I mixed = blendTexels(first, second, select(equal(selectors, I(2)), I(third), I(Sampler::BLEND_SCALE - third)));
+
+					return select(equal(selectors, I(0)), first, select(equal(selectors, I(1)), second, mixed));
+				}
+			}
+		}
+
+		/*
+		 * Returns the filtered texel at texture coordinates (u, v) for each lane, as Sampler::sample does,
+		 * gathering the texels in one go where the instruction set can
+		 */
+		template <class F>
+		typename F::Int sampleTexels(const Sampler& sampler, const F& u, const F& v)
+		{
+			typedef typename F::Int I;
+
+			const int width = sampler.getWidth();
+			const int height = sampler.getHeight();
+			const int* data = sampler.getData();
+
+			F x = u;
+			F y = v;
+
+			if (sampler.getLevel() != 0)
+			{
+				x = x * F(sampler.getScaleU()) + F(sampler.getOffsetU());
+				y = y * F(sampler.getScaleV()) + F(sampler.getOffsetV());
+			}
+
+			x = addressCoordinates(sampler, x, width);
+			y = addressCoordinates(sampler, y, height);
+
+			if (sampler.getFilter() == TextureFilters::POINT)
+			{
+				I texelX = toInt(x);
+				I texelY = toInt(y);
+
+				// Clamped coordinates are already on the texture
+				if (sampler.getAddressMode() == TextureAddressModes::WRAP)
+				{
+					texelX = addressTexels(sampler, texelX, width, sampler.getWidthMask());
+					texelY = addressTexels(sampler, texelY, height, sampler.getHeightMask());
+				}
+
+				if (sampler.getFormat() != TextureFormats::BGRA8)
+					return decodeTexels(sampler, texelX, texelY);
+
+				return gather(data, texelIndex(sampler, texelX, texelY));
+			}
+
+			// The texels up and to the left, rounding whole numbers down a texel, which then get a weight of 1
+			const F half(0.5f);
+			const I x0 = toInt(x - half);
+			const I y0 = toInt(y - half);
+
+			// Weights of the texels to the right and below
+			const F scale((float)Sampler::BLEND_SCALE);
+			const I weightX = toInt((x - toFloat(x0)) * scale);
+			const I weightY = toInt((y - toFloat(y0)) * scale);
+
+			const I one(1);
+			const I left = addressTexels(sampler, x0, width, sampler.getWidthMask());
+			const I right = addressTexels(sampler, x0 + one, width, sampler.getWidthMask());
+			const I top = addressTexels(sampler, y0, height, sampler.getHeightMask());
+			const I bottom = addressTexels(sampler, y0 + one, height, sampler.getHeightMask());
+
+			I topLeft, topRight, bottomLeft, bottomRight;
+
+			if (sampler.getFormat() != TextureFormats::BGRA8)
+			{
+				topLeft = decodeTexels(sampler, left, top);
+				topRight = decodeTexels(sampler, right, top);
+				bottomLeft = decodeTexels(sampler, left, bottom);
+				bottomRight = decodeTexels(sampler, right, bottom);
+			}
+			else if (sampler.getLayout() == TextureLayouts::LINEAR)
+			{
+				// Rows only need multiplying out once
+				const I topRow = top * I(width);
+				const I bottomRow = bottom * I(width);
+
+				topLeft = gather(data, topRow + left);
+				topRight = gather(data, topRow + right);
+				bottomLeft = gather(data, bottomRow + left);
+				bottomRight = gather(data, bottomRow + right);
+			}
+			else
+			{
+				topLeft = gather(data, texelIndex(sampler, left, top));
+				topRight = gather(data, texelIndex(sampler, right, top));
+				bottomLeft = gather(data, texelIndex(sampler, left, bottom));
+				bottomRight = gather(data, texelIndex(sampler, right, bottom));
+			}
+
+			const I upper = blendTexels(topLeft, topRight, weightX);
+			const I lower = blendTexels(bottomLeft, bottomRight, weightX);
+
+			return blendTexels(upper, lower, weightY);
+		}
+	}
+}
+
+#endif
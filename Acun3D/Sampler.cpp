@@ -0,0 +1,351 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "Sampler.h"
+
+namespace a3d
+{
+	Sampler::Sampler()
+	{
+		_image = 0;
+		_data = 0;
+		_width = 0;
+		_height = 0;
+		_widthMask = 0;
+		_heightMask = 0;
+		_layout = TextureLayouts::LINEAR;
+		_tilesX = 0;
+		_mortonBits = 0;
+		_format = TextureFormats::BGRA8;
+		_palette = 0;
+		_pitch = 0;
+		_level = 0;
+		_scaleU = 1.0f;
+		_scaleV = 1.0f;
+		_offsetU = 0;
+		_offsetV = 0;
+		_filter = TextureFilters::POINT;
+		_addressMode = TextureAddressModes::CLAMP;
+		_mipmapMode = MipmapModes::NONE;
+	}
+
+	Sampler::Sampler(const Image& image, TextureFilter filter, TextureAddressMode addressMode, MipmapMode mipmapMode,
+					TextureLayout layout, int level)
+	{
+		_layout = (image.hasLayout(layout) ? layout : TextureLayouts::LINEAR);
+
+		_image = &image;
+		_data = image.getTexels(_layout, level);
+		_width = image.getWidth(level);
+		_height = image.getHeight(level);
+		_tilesX = (_width + Image::TILE_SIZE - 1) / Image::TILE_SIZE;
+		_mortonBits = Image::getMortonBits(_width, _height);
+		_format = image.getFormat();
+		_palette = image.getPalette();
+		_pitch = image.getPitch(level);
+		_level = level;
+		_filter = filter;
+		_addressMode = addressMode;
+		_mipmapMode = mipmapMode;
+
+		_widthMask = ((_width & (_width - 1)) == 0 ? _width - 1 : 0);
+		_heightMask = ((_height & (_height - 1)) == 0 ? _height - 1 : 0);
+
+		// A level's texels are centred in the block of full size texels they're averaged from
+		_scaleU = (float)_width / image.getWidth();
+		_scaleV = (float)_height / image.getHeight();
+		_offsetU = 0.5f * _scaleU - 0.5f;
+		_offsetV = 0.5f * _scaleV - 0.5f;
+	}
+
+	const Image* Sampler::getImage() const
+	{
+		return _image;
+	}
+
+	const int* Sampler::getData() const
+	{
+		return _data;
+	}
+
+	int Sampler::getWidth() const
+	{
+		return _width;
+	}
+
+	int Sampler::getHeight() const
+	{
+		return _height;
+	}
+
+	TextureLayout Sampler::getLayout() const
+	{
+		return _layout;
+	}
+
+	int Sampler::getTilesX() const
+	{
+		return _tilesX;
+	}
+
+	int Sampler::getMortonBits() const
+	{
+		return _mortonBits;
+	}
+
+	TextureFormat Sampler::getFormat() const
+	{
+		return _format;
+	}
+
+	const int* Sampler::getPalette() const
+	{
+		return _palette;
+	}
+
+	int Sampler::getPitch() const
+	{
+		return _pitch;
+	}
+
+	int Sampler::getLevel() const
+	{
+		return _level;
+	}
+
+	float Sampler::getScaleU() const
+	{
+		return _scaleU;
+	}
+
+	float Sampler::getScaleV() const
+	{
+		return _scaleV;
+	}
+
+	float Sampler::getOffsetU() const
+	{
+		return _offsetU;
+	}
+
+	float Sampler::getOffsetV() const
+	{
+		return _offsetV;
+	}
+
+	int Sampler::getWidthMask() const
+	{
+		return _widthMask;
+	}
+
+	int Sampler::getHeightMask() const
+	{
+		return _heightMask;
+	}
+
+	TextureFilter Sampler::getFilter() const
+	{
+		return _filter;
+	}
+
+	TextureAddressMode Sampler::getAddressMode() const
+	{
+		return _addressMode;
+	}
+
+	MipmapMode Sampler::getMipmapMode() const
+	{
+		return _mipmapMode;
+	}
+
+	/*
+	 * Returns the image's mipmap level nearest the size of a pixel on the texture, given its footprint,
+	 * the square of how many full size texels across it is
+	 */
+	int Sampler::selectLevel(float footprint) const
+	{
+		// Level n is nearest for log2(footprint) from 2n - 1 up to 2n + 1, which only depends on floor(log2),
+		// the float's exponent
+		if (!(footprint >= 2.0f) || _image == 0)
+			return 0;
+
+		footprint = std::min(footprint, (float)(1 << 30));
+
+		unsigned int bits;
+		memcpy(&bits, &footprint, sizeof(bits));
+
+		const int exponent = (int)(bits >> 23) - 126;
+
+		return std::min(exponent / 2, _image->getLevelCount() - 1);
+	}
+
+	/*
+	 * Returns a sampler reading another mipmap level of the same image in the same way
+	 */
+	Sampler Sampler::getLevelSampler(int level) const
+	{
+		if (_image == 0 || level == _level)
+			return *this;
+
+		return Sampler(*_image, _filter, _addressMode, _mipmapMode, _layout, level);
+	}
+
+	/*
+	 * Blends two packed colours, weight (0 .. BLEND_SCALE) of the way from a to b
+	 * Two channels are blended at once in each half of an int
+	 */
+	int blend(unsigned int a, unsigned int b, unsigned int weight)
+	{
+		const unsigned int mask = 0x00FF00FF;
+		const unsigned int inverse = Sampler::BLEND_SCALE - weight;
+
+		const unsigned int rb = (((a & mask) * inverse + (b & mask) * weight) >> Sampler::BLEND_BITS) & mask;
+		const unsigned int ag = ((((a >> 8) & mask) * inverse + ((b >> 8) & mask) * weight) >> Sampler::BLEND_BITS) & mask;
+
+		return (int)(rb | (ag << 8));
+	}
+
+	/*
+	 * Returns the filtered texel at texture coordinates (u, v)
+	 */
+	int Sampler::sample(float u, float v) const
+	{
+		if (_level != 0)
+		{
+			u = u * _scaleU + _offsetU;
+			v = v * _scaleV + _offsetV;
+		}
+
+		u = address(u, _width);
+		v = address(v, _height);
+
+		if (_filter == TextureFilters::POINT)
+			return getTexel((int)floor(u + 0.5f), (int)floor(v + 0.5f));
+
+		const float u0 = floor(u);
+		const float v0 = floor(v);
+
+		// Weights of the texels to the right and below
+		const int weightU = (int)floor((u - u0) * BLEND_SCALE + 0.5f);
+		const int weightV = (int)floor((v - v0) * BLEND_SCALE + 0.5f);
+
+		const int x = (int)u0;
+		const int y = (int)v0;
+
+		const int top = blend(getTexel(x, y), getTexel(x + 1, y), weightU);
+		const int bottom = blend(getTexel(x, y + 1), getTexel(x + 1, y + 1), weightU);
+
+		return blend(top, bottom, weightV);
+	}
+
+	int Sampler::getTexel(int u, int v) const
+	{
+		const int x = address(u, _width, _widthMask);
+		const int y = address(v, _height, _heightMask);
+
+		if (_format != TextureFormats::BGRA8)
+			return decodeTexel(x, y);
+
+		return _data[getTexelIndex(x, y)];
+	}
+
+	/*
+	 * Returns where texel (x, y) is in the level's layout, as Image::getTexelIndex does
+	 */
+	int Sampler::getTexelIndex(int x, int y) const
+	{
+		if (_layout == TextureLayouts::LINEAR)
+			return y * _width + x;
+
+		// Image::TILE_SIZE is 4
+		if (_layout == TextureLayouts::TILED)
+		{
+			const int tile = (y >> 2) * _tilesX + (x >> 2);
+
+			return (tile << 4) | ((y & 3) << 2) | (x & 3);
+		}
+
+		const int mask = (1 << _mortonBits) - 1;
+		const int square = (int)(Image::spreadBits(x & mask) | (Image::spreadBits(y & mask) << 1));
+
+		return square + (((x >> _mortonBits) + (y >> _mortonBits)) << (_mortonBits * 2));
+	}
+
+	/*
+	 * Returns texel (x, y) of a level in a format other than BGRA8, as BGRA8
+	 */
+	int Sampler::decodeTexel(int x, int y) const
+	{
+		switch (_format)
+		{
+		case TextureFormats::INDEXED8:
+			return _palette[((unsigned int)_data[y * _pitch + (x >> 2)] >> ((x & 3) * 8)) & 0xFF];
+
+		case TextureFormats::RGB565:
+			return Image::unpackRGB565(((unsigned int)_data[y * _pitch + (x >> 1)] >> ((x & 1) * 16)) & 0xFFFF);
+
+		case TextureFormats::BC1:
+		default:
+			{
+				const int* block = _data + (y >> 2) * _pitch + (x >> 2) * 2;
+
+				const unsigned int endpoints = (unsigned int)block[0];
+				const int selector = ((unsigned int)block[1] >> ((((y & 3) << 2) | (x & 3)) * 2)) & 3;
+
+				if (selector == 0)
+					return Image::unpackRGB565(endpoints & 0xFFFF);
+
+				if (selector == 1)
+					return Image::unpackRGB565(endpoints >> 16);
+
+				// The last two are a third and two thirds of the way from the first to the second
+				const int third = (BLEND_SCALE + 1) / 3;
+
+				return blend(Image::unpackRGB565(endpoints & 0xFFFF), Image::unpackRGB565(endpoints >> 16),
+								(selector == 2 ? third : BLEND_SCALE - third));
+			}
+		}
+	}
+
+	/*
+	 * Brings a texture coordinate to where texels are read, which also turns NaNs into 0:
+	 * onto the texture if it's clamped, and if it wraps, to within MAX_COORDINATE, and onto the texture
+	 * unless a mask will wrap it
+	 */
+	float Sampler::address(float coordinate, int size) const
+	{
+		if (_addressMode == TextureAddressModes::CLAMP)
+		{
+			const float max = (float)(size - 1);
+
+			coordinate = (coordinate > 0 ? coordinate : 0);
+			return (coordinate < max ? coordinate : max);
+		}
+
+		const float limit = (float)MAX_COORDINATE;
+
+		coordinate = (coordinate > -limit ? coordinate : -limit);
+		coordinate = (coordinate < limit ? coordinate : limit);
+
+		if ((size & (size - 1)) != 0)
+			coordinate -= floor(coordinate / size) * size;
+
+		return coordinate;
+	}
+
+	/*
+	 * Brings a texel's coordinate onto the texture
+	 */
+	int Sampler::address(int texel, int size, int mask) const
+	{
+		if (_addressMode == TextureAddressModes::CLAMP)
+			return (texel < 0 ? 0 : (texel < size ? texel : size - 1));
+
+		if (mask != 0)
+			return texel & mask;
+
+		texel %= size;
+		return (texel < 0 ? texel + size : texel);
+	}
+}
@@ -0,0 +1,109 @@
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include "Image.h"
+#include "TextureFilter.h"
+#include "TextureAddressMode.h"
+#include "MipmapMode.h"
+
+namespace a3d
+{
+	/*
+	 * Reads texels from a mipmap level of an image in one of its layouts, with texture coordinates in texels
+	 * of the full size image where texel (0, 0) is centred on (0, 0), decoding them if the image's format
+	 * isn't BGRA8
+	 * Sizes that are a power of two wrap with a mask, others with a division
+	 * sample reads one texel at a time, and SampleKernel.h reads a SIMD.h vector of them
+	 */
+	class Sampler
+	{
+	public:
+		// Furthest from the texture that texture coordinates are taken as they are,
+		// beyond which they're clamped to keep the conversion to texels inside an int
+		static const int MAX_COORDINATE = 1 << 22;
+
+		// Bilinear weights are fixed point with BLEND_BITS fractional bits, which keeps a channel times
+		// a weight inside 16 bits so that two channels can be blended in one int
+		static const int BLEND_BITS = 7;
+		static const int BLEND_SCALE = 1 << BLEND_BITS;
+
+		Sampler();
+		Sampler(const Image& image, TextureFilter filter = TextureFilters::POINT,
+				TextureAddressMode addressMode = TextureAddressModes::CLAMP,
+				MipmapMode mipmapMode = MipmapModes::NONE, TextureLayout layout = TextureLayouts::LINEAR, int level = 0);
+
+		const Image* getImage() const;
+
+		// Texels of the level in the image's format, laid out as getLayout says (see Image::getTexels), which is LINEAR
+		// if the image hasn't been copied into the layout the sampler was asked for
+		const int* getData() const;
+		TextureLayout getLayout() const;
+
+		// The image's format, with its palette if it's INDEXED8, and how many ints a row of the level
+		// takes up (see Image::getPitch)
+		TextureFormat getFormat() const;
+		const int* getPalette() const;
+		int getPitch() const;
+
+		// Blocks in a row of a TILED level, and bits of each coordinate interleaved in a MORTON one
+		int getTilesX() const;
+		int getMortonBits() const;
+
+		int getWidth() const;
+		int getHeight() const;
+		int getLevel() const;
+
+		// Take texture coordinates in texels of the full size image to texels of the level
+		float getScaleU() const;
+		float getScaleV() const;
+		float getOffsetU() const;
+		float getOffsetV() const;
+
+		// Width and height less one if they're powers of two, otherwise 0
+		int getWidthMask() const;
+		int getHeightMask() const;
+
+		TextureFilter getFilter() const;
+		TextureAddressMode getAddressMode() const;
+		MipmapMode getMipmapMode() const;
+
+		int selectLevel(float footprint) const;
+		Sampler getLevelSampler(int level) const;
+
+		int sample(float u, float v) const;
+
+	private:
+		int getTexel(int u, int v) const;
+		int getTexelIndex(int x, int y) const;
+		int decodeTexel(int x, int y) const;
+		float address(float coordinate, int size) const;
+		int address(int texel, int size, int mask) const;
+
+		const Image* _image;
+		const int* _data;
+		int _width;
+		int _height;
+		int _widthMask;
+		int _heightMask;
+
+		TextureLayout _layout;
+		int _tilesX;
+		int _mortonBits;
+
+		TextureFormat _format;
+		const int* _palette;
+		int _pitch;
+
+		int _level;
+		float _scaleU;
+		float _scaleV;
+		float _offsetU;
+		float _offsetV;
+
+		TextureFilter _filter;
+		TextureAddressMode _addressMode;
+		MipmapMode _mipmapMode;
+	};
+}
+
+#endif
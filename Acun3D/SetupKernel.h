@@ -0,0 +1,221 @@
+#ifndef __SETUPKERNEL_H__
+#define __SETUPKERNEL_H__
+
+// Triangle setup is built once per instruction set along with the span kernel, which includes this after
+// its SIMD.h backend has been chosen
+// Everything here has internal linkage so code built for one instruction set can't end up used by another
+
+#include <algorithm>
+
+#include "SIMD.h"
+#include "TriangleSetup.h"
+
+namespace a3d
+{
+	namespace
+	{
+		/*
+		 * The smaller and larger of each lane of two int vectors
+		 */
+		template <class I>
+		I minInt(const I& a, const I& b)
+		{
+			return select(greater(a, b), b, a);
+		}
+
+		template <class I>
+		I maxInt(const I& a, const I& b)
+		{
+			return select(greater(a, b), a, b);
+		}
+
+		/*
+		 * Sets up an interpolant across a vector of triangles from its values at their vertices
+		 * gradientX and gradientY weight each vertex's value to give the gradients, and offsetX and
+		 * offsetY are how far (minX, minY) is from the first vertex
+		 */
+		template <class F>
+		void setupInterpolant(const float (*values)[TriangleBatch::SIZE], int first,
+								const F* gradientX, const F* gradientY, const F& offsetX, const F& offsetY,
+								F& value, F& dx, F& dy)
+		{
+			const F v1 = F::load(&values[0][first]);
+			const F v2 = F::load(&values[1][first]);
+			const F v3 = F::load(&values[2][first]);
+
+			dx = v1 * gradientX[0] + v2 * gradientX[1] + v3 * gradientX[2];
+			dy = v1 * gradientY[0] + v2 * gradientY[1] + v3 * gradientY[2];
+			value = v1 + dx * offsetX + dy * offsetY;
+		}
+
+		/*
+		 * Sets up the triangles of a batch from first on, Float::WIDTH of them at a time
+		 * Lanes past the end of the batch are worked on too, but nothing is written for them
+		 */
+		template <class F>
+		void setupTriangles(TriangleBatch& batch, int first, int width, int height)
+		{
+			typedef typename F::Int I;
+
+			const int count = std::min(batch.count - first, (int)F::WIDTH);
+
+			const I zero(0);
+
+			// Vertex positions, and the same snapped to 28.4 fixed point
+			F x[3];
+			F y[3];
+			I fixedX[3];
+			I fixedY[3];
+
+			for (int i = 0; i < 3; ++i)
+			{
+				x[i] = F::load(&batch.x[i][first]);
+				y[i] = F::load(&batch.y[i][first]);
+
+				fixedX[i] = toInt(x[i] * F(16.0f));
+				fixedY[i] = toInt(y[i] * F(16.0f));
+			}
+
+			// Bounding box in pixels, clipped to the screen (max exclusive)
+			const I round(0xF);
+
+			const I minX = maxInt(minInt(minInt(fixedX[0], fixedX[1]), fixedX[2]) + round, zero) >> 4;
+			const I minY = maxInt(minInt(minInt(fixedY[0], fixedY[1]), fixedY[2]) + round, zero) >> 4;
+			const I maxX = minInt(maxInt(maxInt(maxInt(fixedX[0], fixedX[1]), fixedX[2]) + round, zero) >> 4, I(width - 1));
+			const I maxY = minInt(maxInt(maxInt(maxInt(fixedY[0], fixedY[1]), fixedY[2]) + round, zero) >> 4, I(height - 1));
+
+			// Edge functions from each vertex to the next
+			I origin[3];
+			I stepX[3];
+			I stepY[3];
+
+			for (int i = 0; i < 3; ++i)
+			{
+				const int next = (i + 1) % 3;
+
+				const I dy = fixedX[i] - fixedX[next];
+				const I dx = fixedY[i] - fixedY[next];
+
+				// Extend value if required for fill convention purposes
+				const I fill = greater(zero, dx) | (equal(dx, zero) & greater(dy, zero));
+
+				origin[i] = dx * fixedX[i] - dy * fixedY[i] + (fill & I(1));
+				stepX[i] = dx << 4;
+				stepY[i] = dy << 4;
+			}
+
+			// The first edge's function at the third vertex, before the fill adjustment, is twice the area and is
+			// only positive if the triangle winds the way the kernels draw; the guard band keeps it inside an int
+			const I area = (fixedY[0] - fixedY[1]) * (fixedX[0] - fixedX[2]) - (fixedX[0] - fixedX[1]) * (fixedY[0] - fixedY[2]);
+			const int visible = bits(greater(area, zero) & greater(maxX, minX) & greater(maxY, minY));
+
+			int edgeValues[3][3][F::WIDTH];
+			int box[4][F::WIDTH];
+
+			for (int i = 0; i < 3; ++i)
+			{
+				store(edgeValues[i][0], origin[i]);
+				store(edgeValues[i][1], stepX[i]);
+				store(edgeValues[i][2], stepY[i]);
+			}
+
+			store(box[0], minX);
+			store(box[1], minY);
+			store(box[2], maxX);
+			store(box[3], maxY);
+
+			for (int lane = 0; lane < count; ++lane)
+			{
+				TriangleSetup& t = batch.setups[first + lane];
+
+				for (int i = 0; i < 3; ++i)
+				{
+					t.edges[i].origin = edgeValues[i][0][lane];
+					t.edges[i].stepX = edgeValues[i][1][lane];
+					t.edges[i].stepY = edgeValues[i][2][lane];
+				}
+
+				t.minX = box[0][lane];
+				t.minY = box[1][lane];
+				t.maxX = box[2][lane];
+				t.maxY = box[3][lane];
+
+				batch.visible[first + lane] = ((visible & (1 << lane)) != 0);
+			}
+
+			if (visible == 0)
+				return;
+
+			// Each interpolant's gradients are a weighted sum of its values at the vertices, with the weights
+			// divided by twice the area, which is the only division a triangle needs
+			const F reciprocal = F(1.0f) / (x[0] * (y[1] - y[2]) + x[1] * (y[2] - y[0]) + x[2] * (y[0] - y[1]));
+
+			F gradientX[3];
+			F gradientY[3];
+
+			for (int i = 0; i < 3; ++i)
+			{
+				const int next = (i + 1) % 3;
+				const int last = (i + 2) % 3;
+
+				gradientX[i] = (y[next] - y[last]) * reciprocal;
+				gradientY[i] = (x[last] - x[next]) * reciprocal;
+			}
+
+			// Interpolants start at (minX, minY)
+			const F offsetX = toFloat(minX) - x[0];
+			const F offsetY = toFloat(minY) - y[0];
+
+			float values[3][F::WIDTH];
+			F value;
+			F dx;
+			F dy;
+
+			setupInterpolant(batch.z, first, gradientX, gradientY, offsetX, offsetY, value, dx, dy);
+
+			store(values[0], value);
+			store(values[1], dx);
+			store(values[2], dy);
+
+			for (int lane = 0; lane < count; ++lane)
+			{
+				Interpolant& z = batch.setups[first + lane].z;
+
+				z.value = values[0][lane];
+				z.dx = values[1][lane];
+				z.dy = values[2][lane];
+			}
+
+			for (int i = 0; i < batch.attributeCount; ++i)
+			{
+				setupInterpolant(batch.attributes[i], first, gradientX, gradientY, offsetX, offsetY, value, dx, dy);
+
+				store(values[0], value);
+				store(values[1], dx);
+				store(values[2], dy);
+
+				for (int lane = 0; lane < count; ++lane)
+				{
+					Interpolant& a = batch.setups[first + lane].attributes[i];
+
+					a.value = values[0][lane];
+					a.dx = values[1][lane];
+					a.dy = values[2][lane];
+				}
+			}
+		}
+
+		/*
+		 * Sets up the triangles of a batch for a screen of width by height pixels: their fixed-point edge functions,
+		 * bounding boxes and interpolants, and whether they might cover any pixels
+		 */
+		template <class F>
+		void setupBatch(TriangleBatch& batch, int width, int height)
+		{
+			for (int first = 0; first < batch.count; first += F::WIDTH)
+				setupTriangles<F>(batch, first, width, height);
+		}
+	}
+}
+
+#endif
@@ -10,11 +10,17 @@ namespace a3d
 			NONE,
 			FLAT,
 			SMOOTH,
-			PHONG
+			PHONG,
+
+			// Phong lighting worked out once per pixel in endScene, after everything has been drawn
+			DEFERRED_PHONG
 		};
 	}
 
 	typedef ShadingTypes::ShadingType ShadingType;
+
+	// Number of shading types
+	const int SHADING_TYPE_COUNT = ShadingTypes::DEFERRED_PHONG + 1;
 }
 
 #endif
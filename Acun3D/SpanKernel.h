@@ -0,0 +1,1508 @@
+#ifndef __SPANKERNEL_H__
+#define __SPANKERNEL_H__
+
+// The span kernel is built once per instruction set by RasteriserScalar.cpp, RasteriserSSE2.cpp etc,
+// which choose the SIMD.h backend they need before including this, and for CUSTOM programs by files of your own
+// doing the same through ProgramKernels.h
+// Everything here has internal linkage so code built for one instruction set can't end up used by another
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "SIMD.h"
+#include "RasterKernels.h"
+#include "SetupKernel.h"
+#include "SampleKernel.h"
+#include "LightList.h"
+#include "LightingMath.h"
+#include "Programs.h"
+
+namespace a3d
+{
+	namespace
+	{
+		/*
+		 * Evaluates an interpolant offset by (x, y) pixels from where it was set up
+		 */
+		template <class T>
+		T interpolantAt(const T& initial, const T& dx, const T& dy, float x, float y)
+		{
+			T value = initial;
+			T stepX = dx;
+			T stepY = dy;
+
+			return value + stepX * x + stepY * y;
+		}
+
+		/*
+		 * Packs colour channels in the range 0 .. 255.0f into the B, G and R bytes of each pixel
+		 * Only the low-order byte of each converted channel is kept
+		 */
+		template <class F>
+		typename F::Int packColour(const F& b, const F& g, const F& r)
+		{
+			typedef typename F::Int I;
+
+			const I byteMask(0xFF);
+
+			return (toInt(b) & byteMask) | ((toInt(g) & byteMask) << 8) | ((toInt(r) & byteMask) << 16);
+		}
+
+		/*
+		 * Samples the texture at the perspective-correct texture coordinates of each pixel
+		 */
+		template <class F>
+		typename F::Int fetchTexel(const Sampler& sampler, const F& uoz, const F& voz, const F& ooz)
+		{
+			return sampleTexels(sampler, uoz / ooz, voz / ooz);
+		}
+
+		/*
+		 * The affine texture span a row of groups is in, kept from one group to the next (see Rasteriser::setPerspectiveSpan),
+		 * along with the mipmap level the last group read if groups pick their own, which is kept from one row to the next
+		 */
+		struct TextureSpan
+		{
+			// First pixel of the span, or -1 if it hasn't been worked out yet
+			int start;
+
+			// Whether the span can be stepped across, and if so, the texture coordinates at its start
+			// and their step to the next pixel, in 16.16 fixed point
+			bool affine;
+			int u, v;
+			int stepU, stepV;
+
+			// The level, or -1 if none has been picked yet, and the sampler reading it
+			int level;
+			Sampler sampler;
+
+			TextureSpan()
+				: start(-1), level(-1)
+			{
+			}
+		};
+
+		/*
+		 * Returns the sampler the group of width pixels starting at (x, y) reads its texels with, which is the
+		 * triangle's own unless each group picks its mipmap level, in which case it's kept in the span
+		 * first is the triangle's interpolant holding u / z, followed by v / z and 1 / z
+		 */
+		inline const Sampler& getGroupSampler(const TriangleSetup& t, TextureSpan& span, int x, int y, int width, int first)
+		{
+			if (t.sampler.getMipmapMode() != MipmapModes::GROUP)
+				return t.sampler;
+
+			const int level = t.getTextureLevel(first, x + (width - 1) * 0.5f, (float)y);
+
+			if (level != span.level)
+			{
+				span.level = level;
+				span.sampler = t.sampler.getLevelSampler(level);
+			}
+
+			return span.sampler;
+		}
+
+		/*
+		 * Clamps a texture coordinate to -limit .. limit, which also turns NaNs into 0
+		 */
+		inline float clampCoordinate(float value, float limit)
+		{
+			if (value > -limit && value < limit)
+				return value;
+
+			return (value > 0 ? limit : (value < 0 ? -limit : 0));
+		}
+
+		/*
+		 * Works out the exact texture coordinates at either end of the affine span starting at (start, y)
+		 * first is the triangle's interpolant holding u / z, followed by v / z and 1 / z
+		 */
+		void setupTextureSpan(const TriangleSetup& t, TextureSpan& span, int start, int y, int first)
+		{
+			const Interpolant& uoz = t.attributes[first];
+			const Interpolant& voz = t.attributes[first + 1];
+			const Interpolant& ooz = t.attributes[first + 2];
+
+			const int length = t.textureSpan;
+			const float offsetX = (float)(start - t.minX);
+			const float offsetY = (float)(y - t.minY);
+
+			const float ooz0 = interpolantAt(ooz.value, ooz.dx, ooz.dy, offsetX, offsetY);
+			const float ooz1 = ooz0 + ooz.dx * length;
+
+			span.start = start;
+
+			// A span crossing the horizon of the triangle's plane can't be stepped across, but that
+			// can only happen a little way outside the triangle
+			span.affine = (ooz0 * ooz1 > 0);
+
+			if (!span.affine)
+				return;
+
+			// One division gives the reciprocal at both ends
+			const float reciprocal = 1.0f / (ooz0 * ooz1);
+			const float z0 = ooz1 * reciprocal;
+			const float z1 = ooz0 * reciprocal;
+
+			const float uoz0 = interpolantAt(uoz.value, uoz.dx, uoz.dy, offsetX, offsetY);
+			const float voz0 = interpolantAt(voz.value, voz.dx, voz.dy, offsetX, offsetY);
+
+			// Kept well inside 16.16 fixed point
+			const float limit = 16384.0f;
+			const float u0 = clampCoordinate(uoz0 * z0, limit);
+			const float v0 = clampCoordinate(voz0 * z0, limit);
+			const float u1 = clampCoordinate((uoz0 + uoz.dx * length) * z1, limit);
+			const float v1 = clampCoordinate((voz0 + voz.dx * length) * z1, limit);
+
+			span.u = (int)(u0 * 65536.0f);
+			span.v = (int)(v0 * 65536.0f);
+			span.stepU = (int)((u1 - u0) * 65536.0f / length);
+			span.stepV = (int)((v1 - v0) * 65536.0f / length);
+		}
+
+		/*
+		 * Fetches the texels of the group of pixels starting at (x, y) from a triangle's interpolants, of which
+		 * first is u / z, followed by v / z and 1 / z
+		 * If the triangle has affine texture spans at least as long as the group, the texture coordinates are only
+		 * worked out exactly at the ends of the span the group is in, and stepped between them in 16.16 fixed point
+		 */
+		template <class F>
+		typename F::Int fetchTexel(const TriangleSetup& t, TextureSpan& span, int x, int y, const F* attributes, int first)
+		{
+			typedef typename F::Int I;
+
+			const Sampler& sampler = getGroupSampler(t, span, x, y, F::WIDTH, first);
+
+			if (t.textureSpan >= F::WIDTH)
+			{
+				// Spans start on multiples of their length, which groups never straddle
+				const int start = x & ~(t.textureSpan - 1);
+
+				if (span.start != start)
+					setupTextureSpan(t, span, start, y, first);
+
+				if (span.affine)
+				{
+					const int step = x - start;
+					const I u = I(span.u + span.stepU * step) + I::ramp(span.stepU);
+					const I v = I(span.v + span.stepV * step) + I::ramp(span.stepV);
+
+					const F scale(1.0f / 65536.0f);
+
+					return sampleTexels(sampler, toFloat(u) * scale, toFloat(v) * scale);
+				}
+			}
+
+			return fetchTexel(sampler, attributes[first], attributes[first + 1], attributes[first + 2]);
+		}
+
+		/*
+		 * Unpacks the B, G and R bytes of each pixel into b, g and r in the range 0 .. 1.0f
+		 */
+		template <class F>
+		void unpackColour(const typename F::Int& pixels, F* colour)
+		{
+			typedef typename F::Int I;
+
+			const F twoFiveFive(255.0f);
+			const I byteMask(0xFF);
+
+			colour[0] = toFloat(pixels & byteMask) / twoFiveFive;
+			colour[1] = toFloat((pixels >> 8) & byteMask) / twoFiveFive;
+			colour[2] = toFloat((pixels >> 16) & byteMask) / twoFiveFive;
+		}
+
+		/*
+		 * Multiplies a colour in the range 0 .. 1.0f with a texel and packs the result
+		 */
+		template <class F>
+		typename F::Int modulate(const F* colour, const typename F::Int& texel)
+		{
+			const F twoFiveFive(255.0f);
+
+			// Scale the texel to the range 0 .. 1.0f
+			F t[3];
+			unpackColour(texel, t);
+
+			// Multiply with the colour, scale back up and clamp to 255.0f
+			F b = min(colour[0] * t[0] * twoFiveFive, twoFiveFive);
+			F g = min(colour[1] * t[1] * twoFiveFive, twoFiveFive);
+			F r = min(colour[2] * t[2] * twoFiveFive, twoFiveFive);
+
+			return packColour(b, g, r);
+		}
+
+		/*
+		 * Returns x to a power in each lane, with the same maths as LightingMath::power
+		 * Whole powers are taken by repeated squaring across the vector, and anything else a lane at a time
+		 */
+		template <LightingAccuracy ACCURACY, class F, class E>
+		F power(const F& x, E exponent)
+		{
+			if (ACCURACY != LightingAccuracies::EXACT && LightingMath::isWholeExponent(exponent))
+			{
+				F result(1.0f);
+				F square = x;
+
+				for (unsigned int e = (unsigned int)exponent; e != 0; e >>= 1)
+				{
+					if (e & 1)
+						result = result * square;
+
+					square = square * square;
+				}
+
+				return result;
+			}
+
+			float values[F::WIDTH];
+			store(values, x);
+
+			for (int i = 0; i < F::WIDTH; ++i)
+				values[i] = LightingMath::power(values[i], exponent, ACCURACY);
+
+			return F::load(values);
+		}
+
+		/*
+		 * Scales the vectors in v to length 1, with the same maths as LightingMath::normalise
+		 */
+		template <LightingAccuracy ACCURACY, class F>
+		void normalise(F* v)
+		{
+			const F lengthSquared = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+
+			if (ACCURACY == LightingAccuracies::EXACT)
+			{
+				const F length = sqrt(lengthSquared);
+
+				for (int i = 0; i < 3; ++i)
+					v[i] = v[i] / length;
+			}
+			else
+			{
+				const F scale = (ACCURACY == LightingAccuracies::APPROXIMATE ? reciprocalSqrt(lengthSquared)
+									: F(1.0f) / sqrt(lengthSquared));
+
+				for (int i = 0; i < 3; ++i)
+					v[i] = v[i] * scale;
+			}
+		}
+
+		/*
+		 * Adds the diffuse and specular light of a light in a block to colour, given the direction from it
+		 * to each pixel, scaled by spotFactor
+		 */
+		template <LightingAccuracy ACCURACY, class F>
+		void addLight(const F* normal, const F* cameraDirection, const F* lightDirection, const F& spotFactor,
+						const LightBlock& block, int light, F* colour)
+		{
+			const F cosLightNormal = lightDirection[0] * normal[0] + lightDirection[1] * normal[1]
+										+ lightDirection[2] * normal[2];
+
+			const F diffuse = (cosLightNormal + F(1.0f)) / F(2.0f);
+
+			const F twoCos = F(2.0f) * cosLightNormal;
+			const F reflectedX = normal[0] * twoCos - lightDirection[0];
+			const F reflectedY = normal[1] * twoCos - lightDirection[1];
+			const F reflectedZ = normal[2] * twoCos - lightDirection[2];
+
+			F specular = reflectedX * cameraDirection[0] + reflectedY * cameraDirection[1] + reflectedZ * cameraDirection[2];
+			specular = power<ACCURACY>(max(specular, F(0.0f)), LightingMath::SPECULAR_EXPONENT);
+
+			const F total = (specular * F(LightingMath::SPECULAR_COEFFICIENT)
+								+ diffuse * F(LightingMath::DIFFUSE_COEFFICIENT)) * spotFactor;
+
+			colour[0] = colour[0] + F(block.b[light]) * total;
+			colour[1] = colour[1] + F(block.g[light]) * total;
+			colour[2] = colour[2] + F(block.r[light]) * total;
+		}
+
+		/*
+		 * Returns how much of a light with a range reaches each pixel, given the vector from it to them,
+		 * with the same maths as LightingMath::attenuate
+		 */
+		template <class F>
+		F attenuate(const F* direction, float inverseRangeSquared)
+		{
+			const F distanceSquared = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+			const F falloff = max(F(1.0f) - distanceSquared * F(inverseRangeSquared), F(0.0f));
+
+			return falloff * falloff;
+		}
+
+		/*
+		 * Lights the pixels in mask from their interpolated normals and camera-space positions, with the same maths
+		 * as LightList::calculate
+		 * attributes holds the normal then the position, colour receives b, g and r
+		 * Each light is evaluated for the whole vector of pixels at once, a block of them at a time, and blocks
+		 * that aren't in SHAPE (see LightList::getShape) are left out
+		 * Lights are only faded by their range if SHAPE has ATTENUATED
+		 */
+		template <class F, LightingAccuracy ACCURACY, int SHAPE>
+		void light(const F* attributes, const typename F::Int& mask, const LightList& lights, F* colour)
+		{
+			const F* normal = attributes;
+			const F* position = attributes + 3;
+
+			const Colour& ambient = lights.getAmbient();
+			colour[0] = F(ambient._b);
+			colour[1] = F(ambient._g);
+			colour[2] = F(ambient._r);
+
+			F cameraDirection[3] = { position[0], position[1], position[2] };
+			normalise<ACCURACY>(cameraDirection);
+
+			const F one(1.0f);
+
+			const LightBlock& directional = lights.getDirectionalLights();
+			for (int i = 0; (SHAPE & LightList::DIRECTIONAL_LIGHTS) && i < directional.getCount(); ++i)
+			{
+				const F direction[3] = { F(directional.x[i]), F(directional.y[i]), F(directional.z[i]) };
+
+				addLight<ACCURACY>(normal, cameraDirection, direction, one, directional, i, colour);
+			}
+
+			const LightBlock& point = lights.getPointLights();
+			for (int i = 0; (SHAPE & LightList::POINT_LIGHTS) && i < point.getCount(); ++i)
+			{
+				F direction[3] = { position[0] - F(point.x[i]), position[1] - F(point.y[i]), position[2] - F(point.z[i]) };
+				const F attenuation = ((SHAPE & LightList::ATTENUATED) ? attenuate(direction, point.inverseRangeSquared[i]) : one);
+				normalise<ACCURACY>(direction);
+
+				addLight<ACCURACY>(normal, cameraDirection, direction, attenuation, point, i, colour);
+			}
+
+			const LightBlock& spot = lights.getSpotlights();
+			for (int i = 0; (SHAPE & LightList::SPOTLIGHTS) && i < spot.getCount(); ++i)
+			{
+				F direction[3] = { position[0] - F(spot.x[i]), position[1] - F(spot.y[i]), position[2] - F(spot.z[i]) };
+				const F attenuation = ((SHAPE & LightList::ATTENUATED) ? attenuate(direction, spot.inverseRangeSquared[i]) : one);
+				normalise<ACCURACY>(direction);
+
+				const F dot = direction[0] * F(spot.directionX[i]) + direction[1] * F(spot.directionY[i])
+								+ direction[2] * F(spot.directionZ[i]);
+
+				// Outside the cone the power isn't needed, so skip it if no pixel is inside
+				const typename F::Int inside = greaterEqual(dot, F(spot.cosFOV[i])) & mask;
+				if (bits(inside) == 0)
+					continue;
+
+				F spotFactor = select(inside, power<ACCURACY>(dot, spot.exponent[i]), F(0.0f));
+				spotFactor = max(spotFactor, F(0.0f));
+
+				if (SHAPE & LightList::ATTENUATED)
+					spotFactor = spotFactor * attenuation;
+
+				addLight<ACCURACY>(normal, cameraDirection, direction, spotFactor, spot, i, colour);
+			}
+
+			for (int i = 0; i < 3; ++i)
+				colour[i] = select(mask, min(colour[i], one), F(0.0f));
+		}
+
+		/*
+		 * Lights the pixels in mask as light does, with the copy of it built for the list's accuracy and shape
+		 */
+		template <class F>
+		void light(const F* attributes, const typename F::Int& mask, const LightList& lights, F* colour)
+		{
+			typedef void (*LightFunction)(const F* attributes, const typename F::Int& mask, const LightList& lights, F* colour);
+
+			static const LightFunction functions[LIGHTING_ACCURACY_COUNT][LightList::SHAPE_COUNT] =
+			{
+				{
+					&light<F, LightingAccuracies::EXACT, 0>,
+					&light<F, LightingAccuracies::EXACT, 1>,
+					&light<F, LightingAccuracies::EXACT, 2>,
+					&light<F, LightingAccuracies::EXACT, 3>,
+					&light<F, LightingAccuracies::EXACT, 4>,
+					&light<F, LightingAccuracies::EXACT, 5>,
+					&light<F, LightingAccuracies::EXACT, 6>,
+					&light<F, LightingAccuracies::EXACT, 7>,
+					&light<F, LightingAccuracies::EXACT, 8>,
+					&light<F, LightingAccuracies::EXACT, 9>,
+					&light<F, LightingAccuracies::EXACT, 10>,
+					&light<F, LightingAccuracies::EXACT, 11>,
+					&light<F, LightingAccuracies::EXACT, 12>,
+					&light<F, LightingAccuracies::EXACT, 13>,
+					&light<F, LightingAccuracies::EXACT, 14>,
+					&light<F, LightingAccuracies::EXACT, 15>
+				},
+				{
+					&light<F, LightingAccuracies::FAST, 0>,
+					&light<F, LightingAccuracies::FAST, 1>,
+					&light<F, LightingAccuracies::FAST, 2>,
+					&light<F, LightingAccuracies::FAST, 3>,
+					&light<F, LightingAccuracies::FAST, 4>,
+					&light<F, LightingAccuracies::FAST, 5>,
+					&light<F, LightingAccuracies::FAST, 6>,
+					&light<F, LightingAccuracies::FAST, 7>,
+					&light<F, LightingAccuracies::FAST, 8>,
+					&light<F, LightingAccuracies::FAST, 9>,
+					&light<F, LightingAccuracies::FAST, 10>,
+					&light<F, LightingAccuracies::FAST, 11>,
+					&light<F, LightingAccuracies::FAST, 12>,
+					&light<F, LightingAccuracies::FAST, 13>,
+					&light<F, LightingAccuracies::FAST, 14>,
+					&light<F, LightingAccuracies::FAST, 15>
+				},
+				{
+					&light<F, LightingAccuracies::APPROXIMATE, 0>,
+					&light<F, LightingAccuracies::APPROXIMATE, 1>,
+					&light<F, LightingAccuracies::APPROXIMATE, 2>,
+					&light<F, LightingAccuracies::APPROXIMATE, 3>,
+					&light<F, LightingAccuracies::APPROXIMATE, 4>,
+					&light<F, LightingAccuracies::APPROXIMATE, 5>,
+					&light<F, LightingAccuracies::APPROXIMATE, 6>,
+					&light<F, LightingAccuracies::APPROXIMATE, 7>,
+					&light<F, LightingAccuracies::APPROXIMATE, 8>,
+					&light<F, LightingAccuracies::APPROXIMATE, 9>,
+					&light<F, LightingAccuracies::APPROXIMATE, 10>,
+					&light<F, LightingAccuracies::APPROXIMATE, 11>,
+					&light<F, LightingAccuracies::APPROXIMATE, 12>,
+					&light<F, LightingAccuracies::APPROXIMATE, 13>,
+					&light<F, LightingAccuracies::APPROXIMATE, 14>,
+					&light<F, LightingAccuracies::APPROXIMATE, 15>
+				}
+			};
+
+			functions[lights.getAccuracy()][lights.getShape()](attributes, mask, lights, colour);
+		}
+
+		/*
+		 * Per-type shading for the span kernel, over a SIMD.h float vector type F
+		 * ATTRIBUTES is how many of the triangle's interpolants are used, depthTest gives the
+		 * pixels that pass against the depth buffer, in whatever form the depth format compares them, and shade gives packed colours for the pixels in mask
+		 * of the group starting at (x, y), where span is the row's affine texture span
+		 * VISIBILITY shaders write what shade gives to the visibility buffer instead of the colour buffer,
+		 * and DEPTH_ONLY shaders write nothing but depth
+		 */
+		template <class F>
+		struct ColourShader
+		{
+			typedef F Float;
+			typedef typename F::Int Int;
+
+			static const int ATTRIBUTES = 3;
+			static const bool VISIBILITY = false;
+			static const bool DEPTH_ONLY = false;
+
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return greater(depth, z);
+			}
+
+			static Int shade(const TriangleSetup&, TextureSpan&, int, int, const F* attributes, const Int&)
+			{
+				const F twoFiveFive(255.0f);
+
+				return packColour(attributes[0] * twoFiveFive, attributes[1] * twoFiveFive, attributes[2] * twoFiveFive);
+			}
+		};
+
+		template <class F>
+		struct TexturedShader
+		{
+			typedef F Float;
+			typedef typename F::Int Int;
+
+			static const int ATTRIBUTES = 6;
+			static const bool VISIBILITY = false;
+			static const bool DEPTH_ONLY = false;
+
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return greater(depth, z);
+			}
+
+			static Int shade(const TriangleSetup& t, TextureSpan& span, int x, int y, const F* attributes, const Int&)
+			{
+				Int texel = fetchTexel(t, span, x, y, attributes, 3);
+
+				return modulate(attributes, texel);
+			}
+		};
+
+		template <class F>
+		struct PhongShader
+		{
+			typedef F Float;
+			typedef typename F::Int Int;
+
+			static const int ATTRIBUTES = 6;
+			static const bool VISIBILITY = false;
+			static const bool DEPTH_ONLY = false;
+
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return greaterEqual(depth, z);
+			}
+
+			static Int shade(const TriangleSetup& t, TextureSpan&, int, int, const F* attributes, const Int& mask)
+			{
+				const F twoFiveFive(255.0f);
+
+				F colour[3];
+				light(attributes, mask, *t.lights, colour);
+
+				return packColour(colour[0] * twoFiveFive, colour[1] * twoFiveFive, colour[2] * twoFiveFive);
+			}
+		};
+
+		template <class F>
+		struct PhongTexturedShader
+		{
+			typedef F Float;
+			typedef typename F::Int Int;
+
+			static const int ATTRIBUTES = 9;
+			static const bool VISIBILITY = false;
+			static const bool DEPTH_ONLY = false;
+
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return greaterEqual(depth, z);
+			}
+
+			static Int shade(const TriangleSetup& t, TextureSpan& span, int x, int y, const F* attributes, const Int& mask)
+			{
+				F colour[3];
+				light(attributes, mask, *t.lights, colour);
+
+				Int texel = fetchTexel(t, span, x, y, attributes, 6);
+
+				return modulate(colour, texel);
+			}
+		};
+
+		template <class F>
+		struct VisibilityShader
+		{
+			typedef F Float;
+			typedef typename F::Int Int;
+
+			static const int ATTRIBUTES = 0;
+			static const bool VISIBILITY = true;
+			static const bool DEPTH_ONLY = false;
+
+			// The same as the Phong shaders it stands in for
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return greaterEqual(depth, z);
+			}
+
+			static Int shade(const TriangleSetup& t, TextureSpan&, int, int, const F*, const Int&)
+			{
+				return Int((int)t.id);
+			}
+		};
+
+		/*
+		 * Shades a program's triangles with its fragment stage, given its varyings followed, if TEXTURED,
+		 * by u / z, v / z and 1 / z
+		 */
+		template <class F, class Program, bool TEXTURED>
+		struct ProgramShader
+		{
+			typedef F Float;
+			typedef typename F::Int Int;
+
+			static const int ATTRIBUTES = Program::VARYINGS + (TEXTURED ? 3 : 0);
+			static const bool VISIBILITY = false;
+			static const bool DEPTH_ONLY = false;
+
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return greater(depth, z);
+			}
+
+			static Int shade(const TriangleSetup& t, TextureSpan& span, int x, int y, const F* attributes, const Int&)
+			{
+				const F zero(0.0f);
+				const F twoFiveFive(255.0f);
+
+				F colour[3] = { F(1.0f), F(1.0f), F(1.0f) };
+
+				if (TEXTURED)
+					unpackColour(fetchTexel(t, span, x, y, attributes, Program::VARYINGS), colour);
+
+				static_cast<const Program*>(t.program)->fragment(attributes, colour);
+
+				for (int i = 0; i < 3; ++i)
+					colour[i] = min(max(colour[i] * twoFiveFive, zero), twoFiveFive);
+
+				return packColour(colour[0], colour[1], colour[2]);
+			}
+		};
+
+		/*
+		 * Draws the depth of another shader's triangles and nothing else, for a depth pre-pass
+		 */
+		template <class Shader>
+		struct DepthOnlyShader
+		{
+			typedef typename Shader::Float Float;
+			typedef typename Shader::Int Int;
+
+			static const int ATTRIBUTES = 0;
+			static const bool VISIBILITY = false;
+			static const bool DEPTH_ONLY = true;
+
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return Shader::depthTest(depth, z);
+			}
+
+			static Int shade(const TriangleSetup&, TextureSpan&, int, int, const Float*, const Int&)
+			{
+				return Int(0);
+			}
+		};
+
+		/*
+		 * Shades another shader's triangles only where they're exactly as deep as the depth buffer,
+		 * so after a depth pre-pass each pixel is shaded by the triangles that are visible there
+		 * A triangle's depth is interpolated the same way by both passes, so the pre-pass leaves the same values
+		 * Of several triangles equally deep there, only the one the pre-pass recorded is shaded (see RasterTarget)
+		 */
+		template <class Shader>
+		struct DepthEqualShader
+		{
+			typedef typename Shader::Float Float;
+			typedef typename Shader::Int Int;
+
+			static const int ATTRIBUTES = Shader::ATTRIBUTES;
+			static const bool VISIBILITY = Shader::VISIBILITY;
+			static const bool DEPTH_ONLY = false;
+
+			template <class V>
+			static Int depthTest(const V& depth, const V& z)
+			{
+				return equal(depth, z);
+			}
+
+			static Int shade(const TriangleSetup& t, TextureSpan& span, int x, int y, const Float* attributes, const Int& mask)
+			{
+				return Shader::shade(t, span, x, y, attributes, mask);
+			}
+		};
+
+		/*
+		 * How the kernels read, write and compare each depth format, over a SIMD.h float vector type F
+		 * Value is what's compared: the depth itself for the float formats, and for the fixed-point formats
+		 * the depth scaled to their range and rounded, so that comparisons are exactly those of the stored values
+		 * Each pixel's depth is STRIDE Stored values, and REVERSED formats are nearer where they're larger
+		 */
+		template <class F>
+		struct FloatDepth
+		{
+			typedef float Stored;
+			typedef F Value;
+
+			static const int STRIDE = 1;
+			static const bool REVERSED = false;
+
+			static Value encode(const F& z)
+			{
+				return z;
+			}
+
+			static Value read(const Stored* depth)
+			{
+				return F::load(depth);
+			}
+
+			static void write(Stored* depth, const Value& value)
+			{
+				store(depth, value);
+			}
+		};
+
+		template <class F>
+		struct ReversedFloatDepth
+			: FloatDepth<F>
+		{
+			static const bool REVERSED = true;
+		};
+
+		template <class F>
+		struct Unorm16Depth
+		{
+			typedef unsigned short Stored;
+			typedef typename F::Int Value;
+
+			static const int STRIDE = 1;
+			static const bool REVERSED = false;
+
+			static Value encode(const F& z)
+			{
+				return toInt(min(max(z, F(0.0f)), F(1.0f)) * F(65535.0f));
+			}
+
+			static Value read(const Stored* depth)
+			{
+				int values[F::WIDTH];
+				for (int i = 0; i < F::WIDTH; ++i)
+					values[i] = depth[i];
+
+				return Value::load(values);
+			}
+
+			static void write(Stored* depth, const Value& value)
+			{
+				int values[F::WIDTH];
+				store(values, value);
+
+				for (int i = 0; i < F::WIDTH; ++i)
+					depth[i] = (Stored)values[i];
+			}
+		};
+
+		// Packed into three bytes, low byte first
+		template <class F>
+		struct Unorm24Depth
+		{
+			typedef unsigned char Stored;
+			typedef typename F::Int Value;
+
+			static const int STRIDE = 3;
+			static const bool REVERSED = false;
+
+			static Value encode(const F& z)
+			{
+				return toInt(min(max(z, F(0.0f)), F(1.0f)) * F(16777215.0f));
+			}
+
+			static Value read(const Stored* depth)
+			{
+				int values[F::WIDTH];
+				for (int i = 0; i < F::WIDTH; ++i)
+					values[i] = depth[i * 3] | (depth[i * 3 + 1] << 8) | (depth[i * 3 + 2] << 16);
+
+				return Value::load(values);
+			}
+
+			static void write(Stored* depth, const Value& value)
+			{
+				int values[F::WIDTH];
+				store(values, value);
+
+				for (int i = 0; i < F::WIDTH; ++i)
+				{
+					depth[i * 3] = (Stored)values[i];
+					depth[i * 3 + 1] = (Stored)(values[i] >> 8);
+					depth[i * 3 + 2] = (Stored)(values[i] >> 16);
+				}
+			}
+		};
+
+		/*
+		 * Depth tests, shades and stores a group of pixels starting at (x, y)
+		 * Returns whether any of them were drawn
+		 */
+		template <class Shader, class Depth>
+		bool drawGroup(const TriangleSetup& t, const RasterTarget& target, TextureSpan& span, int x, int y,
+						typename Shader::Int mask, const typename Shader::Float& z, const typename Shader::Float* attributes)
+		{
+			typedef typename Shader::Float F;
+			typedef typename Shader::Int I;
+			typedef typename Depth::Stored D;
+			typedef typename Depth::Value V;
+
+			const I alphaMask((int)0xFF000000);
+
+			const int offset = getPixelOffset(target.layout, target.width, x, y);
+
+			// Visibility shaders draw into the visibility buffer, anything else clears it if there is one
+			D* depthBuffer = (D*)target.depth + offset * Depth::STRIDE;
+			unsigned int* colourBuffer = (Shader::VISIBILITY ? target.ids : target.pixels) + offset;
+			unsigned int* idBuffer = (!Shader::VISIBILITY && target.ids != 0 ? target.ids + offset : 0);
+			unsigned int* prepassBuffer = (target.prepassIds != 0 ? target.prepassIds + offset : 0);
+
+			D* depthOut = depthBuffer;
+			unsigned int* colourOut = colourBuffer;
+			unsigned int* idOut = idBuffer;
+			unsigned int* prepassOut = prepassBuffer;
+
+			// The last group of a row can hang off the right of a LINEAR buffer,
+			// in which case it's worked on in a copy
+			D depthCopy[F::WIDTH * Depth::STRIDE];
+			unsigned int colourCopy[F::WIDTH];
+			unsigned int idCopy[F::WIDTH];
+			unsigned int prepassCopy[F::WIDTH];
+
+			const int count = std::min(target.width - x, (int)F::WIDTH);
+
+			if (count < F::WIDTH)
+			{
+				for (int i = 0; i < F::WIDTH * Depth::STRIDE; ++i)
+					depthCopy[i] = (i < count * Depth::STRIDE ? depthBuffer[i] : 0);
+
+				for (int i = 0; i < F::WIDTH; ++i)
+				{
+					colourCopy[i] = (i < count ? colourBuffer[i] : 0);
+					idCopy[i] = (i < count && idBuffer != 0 ? idBuffer[i] : 0);
+					prepassCopy[i] = (i < count && prepassBuffer != 0 ? prepassBuffer[i] : 0);
+				}
+
+				depthOut = depthCopy;
+				colourOut = colourCopy;
+				idOut = (idBuffer != 0 ? idCopy : 0);
+				prepassOut = (prepassBuffer != 0 ? prepassCopy : 0);
+			}
+
+			// If on top of screen, which for reversed depth is the test the other way around
+			V depthValues = Depth::read(depthOut);
+			V depth = Depth::encode(z);
+			mask = mask & (Depth::REVERSED ? Shader::depthTest(depth, depthValues) : Shader::depthTest(depthValues, depth));
+
+			// After a depth pre-pass only the triangle it left in front shades a pixel
+			const I prepassId((int)t.prepassId);
+			if (!Shader::DEPTH_ONLY && prepassOut != 0)
+				mask = mask & equal(I::load((const int*)prepassOut), prepassId);
+
+			if (bits(mask) == 0)
+				return false;
+
+			Depth::write(depthOut, select(mask, depth, depthValues));
+
+			if (!Shader::DEPTH_ONLY)
+			{
+				I colour = Shader::shade(t, span, x, y, attributes, mask);
+				I current = I::load((const int*)colourOut);
+
+				// Keep whatever alpha is already in the buffer
+				if (!Shader::VISIBILITY)
+					colour = colour | (current & alphaMask);
+
+				store((int*)colourOut, select(mask, colour, current));
+
+				if (idOut != 0)
+					store((int*)idOut, select(mask, I(0), I::load((const int*)idOut)));
+			}
+			else if (prepassOut != 0)
+			{
+				store((int*)prepassOut, select(mask, prepassId, I::load((const int*)prepassOut)));
+			}
+
+			if (count < F::WIDTH)
+			{
+				for (int i = 0; i < count * Depth::STRIDE; ++i)
+					depthBuffer[i] = depthCopy[i];
+
+				for (int i = 0; i < count; ++i)
+				{
+					colourBuffer[i] = colourCopy[i];
+
+					if (idBuffer != 0)
+						idBuffer[i] = idCopy[i];
+
+					if (prepassBuffer != 0)
+						prepassBuffer[i] = prepassCopy[i];
+				}
+			}
+
+			return true;
+		}
+
+		/*
+		 * The parts of a triangle's set up that are the same for every block, in vector form
+		 */
+		template <class Shader>
+		struct BlockSetup
+		{
+			typedef typename Shader::Float F;
+			typedef typename Shader::Int I;
+
+			// Arrays can't be empty, so there's always room for one attribute
+			static const int STORAGE = (Shader::ATTRIBUTES > 0 ? Shader::ATTRIBUTES : 1);
+
+			// Half-space values across a group relative to its first pixel, and their step to the next group
+			I edgeRamp[3];
+			I dxEdge[3];
+
+			// Interpolants across a group at (t.minX, t.minY), and their steps to the next pixel, group and row
+			F z;
+			F dxZ;
+			F dyZ;
+			F groupDxZ;
+
+			F attributes[STORAGE];
+			F dxAttributes[STORAGE];
+			F dyAttributes[STORAGE];
+			F groupDxAttributes[STORAGE];
+
+			BlockSetup(const TriangleSetup& t)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					edgeRamp[i] = I::ramp(t.edges[i].stepX);
+					dxEdge[i] = I(t.edges[i].stepX * F::WIDTH);
+				}
+
+				const F ramp = F::ramp();
+
+				dxZ = F(t.z.dx);
+				dyZ = F(t.z.dy);
+				z = F(t.z.value) + dxZ * ramp;
+				groupDxZ = F(t.z.dx * F::WIDTH);
+
+				for (int i = 0; i < Shader::ATTRIBUTES; ++i)
+				{
+					const Interpolant& a = t.attributes[i];
+
+					dxAttributes[i] = F(a.dx);
+					dyAttributes[i] = F(a.dy);
+					attributes[i] = F(a.value) + dxAttributes[i] * ramp;
+					groupDxAttributes[i] = F(a.dx * F::WIDTH);
+				}
+			}
+		};
+
+		/*
+		 * Rasterises the pixels of a triangle in the rectangle (minX, minY) - (maxX, maxY), Float::WIDTH at a time
+		 * With TEST_EDGES false the whole rectangle is known to be inside the triangle, and only the
+		 * depth test decides which pixels are drawn
+		 * Returns whether any pixels were drawn
+		 */
+		template <class Shader, class Depth, bool TEST_EDGES>
+		bool rasteriseBlock(const TriangleSetup& t, const RasterTarget& target, const BlockSetup<Shader>& setup,
+							int minX, int minY, int maxX, int maxY)
+		{
+			typedef typename Shader::Float F;
+			typedef typename Shader::Int I;
+
+			// Groups start on a multiple of the group width so they never straddle two tiles
+			const int startX = minX & ~(F::WIDTH - 1);
+
+			// Offset of the first group from where the interpolants were set up
+			const F offsetX((float)(startX - t.minX));
+			const F offsetY((float)(minY - t.minY));
+
+			// Interpolants across the first group
+			F rowZ = setup.z + setup.dxZ * offsetX + setup.dyZ * offsetY;
+
+			F rowAttributes[BlockSetup<Shader>::STORAGE];
+			for (int i = 0; i < Shader::ATTRIBUTES; ++i)
+				rowAttributes[i] = setup.attributes[i] + setup.dxAttributes[i] * offsetX + setup.dyAttributes[i] * offsetY;
+
+			// Used to mask off the pixels of a group that are outside the rectangle
+			const I pixelRamp = I::ramp(1);
+			const I clipLeft(minX - 1);
+			const I clipRight(maxX);
+
+			const I zero(0);
+
+			bool drawn = false;
+
+			// Kept across rows for the mipmap level, while each row starts a new affine span
+			TextureSpan span;
+
+			for (int y = minY; y < maxY; y++)
+			{
+				I edge[3];
+				if (TEST_EDGES)
+				{
+					for (int i = 0; i < 3; ++i)
+						edge[i] = I(t.edges[i].at(startX, y)) - setup.edgeRamp[i];
+				}
+
+				F z = rowZ;
+				span.start = -1;
+
+				F attributes[BlockSetup<Shader>::STORAGE];
+				for (int i = 0; i < Shader::ATTRIBUTES; ++i)
+					attributes[i] = rowAttributes[i];
+
+				for (int x = startX; x < maxX; x += F::WIDTH)
+				{
+					I pixelX = I(x) + pixelRamp;
+					I mask = greater(pixelX, clipLeft) & greater(clipRight, pixelX);
+
+					// Pixels inside all three edges
+					if (TEST_EDGES)
+						mask = mask & greater(edge[0], zero) & greater(edge[1], zero) & greater(edge[2], zero);
+
+					if (bits(mask) != 0 && drawGroup<Shader, Depth>(t, target, span, x, y, mask, z, attributes))
+						drawn = true;
+
+					// Increment values in x
+					if (TEST_EDGES)
+					{
+						for (int i = 0; i < 3; ++i)
+							edge[i] = edge[i] - setup.dxEdge[i];
+					}
+
+					z = z + setup.groupDxZ;
+
+					for (int i = 0; i < Shader::ATTRIBUTES; ++i)
+						attributes[i] = attributes[i] + setup.groupDxAttributes[i];
+				}
+
+				// Increment values in y
+				rowZ = rowZ + setup.dyZ;
+
+				for (int i = 0; i < Shader::ATTRIBUTES; ++i)
+					rowAttributes[i] = rowAttributes[i] + setup.dyAttributes[i];
+			}
+
+			return drawn;
+		}
+
+		/*
+		 * Returns the furthest depth in the hierarchical depth buffer over the pixels (minX, minY) - (maxX, maxY),
+		 * kept the way it keeps them (see RasterTarget)
+		 */
+		float getMaxDepth(const RasterTarget& target, int minX, int minY, int maxX, int maxY)
+		{
+			const int cellMinX = minX / RasterTarget::HI_Z_SIZE;
+			const int cellMinY = minY / RasterTarget::HI_Z_SIZE;
+			const int cellMaxX = (maxX - 1) / RasterTarget::HI_Z_SIZE;
+			const int cellMaxY = (maxY - 1) / RasterTarget::HI_Z_SIZE;
+
+			float depth = -std::numeric_limits<float>::infinity();
+
+			for (int y = cellMinY; y <= cellMaxY; ++y)
+			{
+				for (int x = cellMinX; x <= cellMaxX; ++x)
+					depth = std::max(depth, target.hiZ[y * target.hiZWidth + x]);
+			}
+
+			return depth;
+		}
+
+		/*
+		 * Marks the cells of the hierarchical depth buffer over the pixels (minX, minY) - (maxX, maxY) as drawn to
+		 */
+		void markHiZ(const RasterTarget& target, int minX, int minY, int maxX, int maxY)
+		{
+			const int cellMinX = minX / RasterTarget::HI_Z_SIZE;
+			const int cellMinY = minY / RasterTarget::HI_Z_SIZE;
+			const int cellMaxX = (maxX - 1) / RasterTarget::HI_Z_SIZE;
+			const int cellMaxY = (maxY - 1) / RasterTarget::HI_Z_SIZE;
+
+			for (int y = cellMinY; y <= cellMaxY; ++y)
+			{
+				for (int x = cellMinX; x <= cellMaxX; ++x)
+					target.hiZDirty[y * target.hiZWidth + x] = 1;
+			}
+		}
+
+		/*
+		 * Rasterises the part of a triangle inside the clip rectangle
+		 * The bounding box is walked in blocks, and the edge functions at each block's corners decide
+		 * whether it is skipped, drawn without per-pixel edge tests or tested a pixel at a time
+		 * The triangle and each block are also skipped if the hierarchical depth buffer shows they're hidden
+		 */
+		template <class Shader, class Depth>
+		void rasteriseSpans(const TriangleSetup& t, const RasterTarget& target)
+		{
+			typedef typename Shader::Float F;
+
+			// Clip the bounding box to the tile
+			const int minX = std::max(t.minX, target.clipMinX);
+			const int minY = std::max(t.minY, target.clipMinY);
+			const int maxX = std::min(t.maxX, target.clipMaxX);
+			const int maxY = std::min(t.maxY, target.clipMaxY);
+
+			if (minX >= maxX || minY >= maxY)
+				return;
+
+			// Skip the triangle if it's behind everything already drawn here
+			if (getMinDepth(t, Depth::REVERSED, minX, minY, maxX, maxY) > *target.clipDepth)
+			{
+				target.stats->occludedTriangles++;
+				return;
+			}
+
+			const BlockSetup<Shader> setup(t);
+			const Edge* edges = t.edges;
+
+			// Blocks are at least a group wide, and are aligned so their groups are too
+			// They're also at least an affine texture span wide, so each span is only worked out once a row
+			const int blockWidth = std::max(std::max(target.blockSize, (int)F::WIDTH), t.textureSpan);
+			const int blockHeight = target.blockSize;
+
+			// A bounding box no bigger than a block is tested a pixel at a time without classifying it
+			if (maxX - minX <= blockWidth && maxY - minY <= blockHeight)
+			{
+				if (getMinDepth(t, Depth::REVERSED, minX, minY, maxX, maxY) > getMaxDepth(target, minX, minY, maxX, maxY))
+				{
+					target.stats->occludedBlocks++;
+				}
+				else
+				{
+					target.stats->partialBlocks++;
+
+					if (rasteriseBlock<Shader, Depth, true>(t, target, setup, minX, minY, maxX, maxY))
+						markHiZ(target, minX, minY, maxX, maxY);
+				}
+
+				return;
+			}
+
+			unsigned int rejected = 0;
+			unsigned int accepted = 0;
+			unsigned int partial = 0;
+			unsigned int occluded = 0;
+
+			for (int blockY = minY & ~(blockHeight - 1); blockY < maxY; blockY += blockHeight)
+			{
+				const int y0 = std::max(blockY, minY);
+				const int y1 = std::min(blockY + blockHeight, maxY) - 1;
+
+				for (int blockX = minX & ~(blockWidth - 1); blockX < maxX; blockX += blockWidth)
+				{
+					const int x0 = std::max(blockX, minX);
+					const int x1 = std::min(blockX + blockWidth, maxX) - 1;
+
+					// The edge functions are linear, so their smallest and largest values
+					// over the block are at its corners
+					bool outside = false;
+					bool inside = true;
+
+					for (int i = 0; i < 3; ++i)
+					{
+						const int c1 = edges[i].at(x0, y0);
+						const int c2 = edges[i].at(x1, y0);
+						const int c3 = edges[i].at(x0, y1);
+						const int c4 = edges[i].at(x1, y1);
+
+						if (c1 <= 0 && c2 <= 0 && c3 <= 0 && c4 <= 0)
+							outside = true;
+
+						if (c1 <= 0 || c2 <= 0 || c3 <= 0 || c4 <= 0)
+							inside = false;
+					}
+
+					if (outside)
+					{
+						rejected++;
+						continue;
+					}
+
+					// Skip the block if it's behind everything already drawn there
+					if (getMinDepth(t, Depth::REVERSED, x0, y0, x1 + 1, y1 + 1) > getMaxDepth(target, x0, y0, x1 + 1, y1 + 1))
+					{
+						occluded++;
+						continue;
+					}
+
+					bool drawn;
+
+					if (inside)
+					{
+						accepted++;
+						drawn = rasteriseBlock<Shader, Depth, false>(t, target, setup, x0, y0, x1 + 1, y1 + 1);
+					}
+					else
+					{
+						partial++;
+						drawn = rasteriseBlock<Shader, Depth, true>(t, target, setup, x0, y0, x1 + 1, y1 + 1);
+					}
+
+					if (drawn)
+						markHiZ(target, x0, y0, x1 + 1, y1 + 1);
+				}
+			}
+
+			target.stats->rejectedBlocks += rejected;
+			target.stats->acceptedBlocks += accepted;
+			target.stats->partialBlocks += partial;
+			target.stats->occludedBlocks += occluded;
+		}
+
+		// Lane i of a group holds bit i, for turning a row of a coverage mask into a vector mask
+		const int LANE_BITS[16] =
+		{
+			0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+			0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, 0x8000
+		};
+
+		/*
+		 * Returns the coverage mask of a triangle whose bounding box is no bigger than SMALL_SIZE square
+		 * All of the box's pixels are tested against the three edges together, Float::WIDTH at a time
+		 */
+		template <class F>
+		unsigned int getSmallCoverage(const TriangleSetup& t)
+		{
+			typedef typename F::Int I;
+
+			const int SIZE = TriangleSetup::SMALL_SIZE;
+			const int SIZE_SHIFT = 2;	// SIZE is 1 << SIZE_SHIFT
+
+			const Edge* edges = t.edges;
+
+			I origin[3];
+			I stepX[3];
+			I stepY[3];
+
+			for (int i = 0; i < 3; ++i)
+			{
+				origin[i] = I(edges[i].at(t.minX, t.minY));
+				stepX[i] = I(edges[i].stepX);
+				stepY[i] = I(edges[i].stepY);
+			}
+
+			const I zero(0);
+			const I columnMask(SIZE - 1);
+			const I width(t.maxX - t.minX);
+			const I height(t.maxY - t.minY);
+
+			unsigned int coverage = 0;
+
+			for (int first = 0; first < SIZE * SIZE; first += F::WIDTH)
+			{
+				// Bit i of the mask is pixel (i % SIZE, i / SIZE) of the box
+				const I index = I(first) + I::ramp(1);
+				const I x = index & columnMask;
+				const I y = index >> SIZE_SHIFT;
+
+				I mask = greater(width, x) & greater(height, y);
+
+				for (int i = 0; i < 3; ++i)
+					mask = mask & greater(origin[i] - stepX[i] * x + stepY[i] * y, zero);
+
+				coverage |= (unsigned int)bits(mask) << first;
+			}
+
+			return coverage;
+		}
+
+		/*
+		 * Rasterises the part of a triangle with a coverage mask inside the clip rectangle
+		 * There are no edges to step or blocks to classify: the interpolants are worked out directly
+		 * for each group holding a covered pixel, and only those pixels are drawn
+		 */
+		template <class Shader, class Depth>
+		void rasteriseSmall(const TriangleSetup& t, const RasterTarget& target)
+		{
+			typedef typename Shader::Float F;
+			typedef typename Shader::Int I;
+
+			const int SIZE = TriangleSetup::SMALL_SIZE;
+
+			// Clip the bounding box to the tile
+			const int minX = std::max(t.minX, target.clipMinX);
+			const int minY = std::max(t.minY, target.clipMinY);
+			const int maxX = std::min(t.maxX, target.clipMaxX);
+			const int maxY = std::min(t.maxY, target.clipMaxY);
+
+			if (minX >= maxX || minY >= maxY)
+				return;
+
+			// Skip the triangle if it's behind everything already drawn here
+			if (getMinDepth(t, Depth::REVERSED, minX, minY, maxX, maxY) > getMaxDepth(target, minX, minY, maxX, maxY))
+			{
+				target.stats->occludedTriangles++;
+				return;
+			}
+
+			target.stats->smallTriangles++;
+
+			// The columns of each row of the mask inside the clip rectangle
+			const unsigned int columns = ((1u << (maxX - t.minX)) - 1) & ~((1u << (minX - t.minX)) - 1);
+
+			const F ramp = F::ramp();
+			const I laneBits = I::load(LANE_BITS);
+
+			bool drawn = false;
+
+			// Kept across rows for the mipmap level, while each row starts a new affine span
+			TextureSpan span;
+
+			for (int y = minY; y < maxY; ++y)
+			{
+				const unsigned int row = (t.coverage >> ((y - t.minY) * SIZE)) & columns;
+
+				if (row == 0)
+					continue;
+
+				const F offsetY((float)(y - t.minY));
+				span.start = -1;
+
+				// Groups start on a multiple of the group width so they never straddle two tiles
+				for (int x = minX & ~(F::WIDTH - 1); x < maxX; x += F::WIDTH)
+				{
+					const int shift = x - t.minX;
+					const unsigned int group = (shift >= 0 ? row >> shift : row << -shift);
+
+					const I mask = equal(I((int)group) & laneBits, laneBits);
+
+					if (bits(mask) == 0)
+						continue;
+
+					const F offsetX = F((float)shift) + ramp;
+
+					const F z = F(t.z.value) + F(t.z.dx) * offsetX + F(t.z.dy) * offsetY;
+
+					F attributes[BlockSetup<Shader>::STORAGE];
+					for (int i = 0; i < Shader::ATTRIBUTES; ++i)
+					{
+						const Interpolant& a = t.attributes[i];
+
+						attributes[i] = F(a.value) + F(a.dx) * offsetX + F(a.dy) * offsetY;
+					}
+
+					if (drawGroup<Shader, Depth>(t, target, span, x, y, mask, z, attributes))
+						drawn = true;
+				}
+			}
+
+			if (drawn)
+				markHiZ(target, minX, minY, maxX, maxY);
+		}
+
+		/*
+		 * Rasterises a triangle with the small-triangle kernel if SMALL, otherwise by walking its bounding box in blocks
+		 */
+		template <class Shader, class Depth, bool SMALL>
+		void rasterise(const TriangleSetup& t, const RasterTarget& target)
+		{
+			if (SMALL)
+				rasteriseSmall<Shader, Depth>(t, target);
+			else
+				rasteriseSpans<Shader, Depth>(t, target);
+		}
+
+		/*
+		 * Fills in the kernels for every mode and type of triangle, for one depth format, either for triangles
+		 * with a coverage mask if SMALL or for the rest
+		 * Depth-only kernels depend only on the depth test, so they're shared between types where it's the same
+		 */
+		template <class F, class Depth, bool SMALL>
+		void setKernels(RasteriseFunction kernels[KERNEL_MODE_COUNT][TRIANGLE_TYPE_COUNT])
+		{
+			RasteriseFunction* draw = kernels[KernelModes::DRAW];
+			draw[TriangleTypes::COLOUR] = &rasterise<ColourShader<F>, Depth, SMALL>;
+			draw[TriangleTypes::TEXTURED] = &rasterise<TexturedShader<F>, Depth, SMALL>;
+			draw[TriangleTypes::PHONG] = &rasterise<PhongShader<F>, Depth, SMALL>;
+			draw[TriangleTypes::PHONG_TEXTURED] = &rasterise<PhongTexturedShader<F>, Depth, SMALL>;
+			draw[TriangleTypes::VISIBILITY] = &rasterise<VisibilityShader<F>, Depth, SMALL>;
+
+			RasteriseFunction* depthOnly = kernels[KernelModes::DEPTH_ONLY];
+			depthOnly[TriangleTypes::COLOUR] = &rasterise<DepthOnlyShader<ColourShader<F> >, Depth, SMALL>;
+			depthOnly[TriangleTypes::TEXTURED] = &rasterise<DepthOnlyShader<ColourShader<F> >, Depth, SMALL>;
+			depthOnly[TriangleTypes::PHONG] = &rasterise<DepthOnlyShader<PhongShader<F> >, Depth, SMALL>;
+			depthOnly[TriangleTypes::PHONG_TEXTURED] = &rasterise<DepthOnlyShader<PhongShader<F> >, Depth, SMALL>;
+			depthOnly[TriangleTypes::VISIBILITY] = &rasterise<DepthOnlyShader<PhongShader<F> >, Depth, SMALL>;
+
+			RasteriseFunction* depthEqual = kernels[KernelModes::DEPTH_EQUAL];
+			depthEqual[TriangleTypes::COLOUR] = &rasterise<DepthEqualShader<ColourShader<F> >, Depth, SMALL>;
+			depthEqual[TriangleTypes::TEXTURED] = &rasterise<DepthEqualShader<TexturedShader<F> >, Depth, SMALL>;
+			depthEqual[TriangleTypes::PHONG] = &rasterise<DepthEqualShader<PhongShader<F> >, Depth, SMALL>;
+			depthEqual[TriangleTypes::PHONG_TEXTURED] = &rasterise<DepthEqualShader<PhongTexturedShader<F> >, Depth, SMALL>;
+			depthEqual[TriangleTypes::VISIBILITY] = &rasterise<DepthEqualShader<VisibilityShader<F> >, Depth, SMALL>;
+		}
+
+		/*
+		 * Fills in the kernels for every mode of a program, untextured and textured, for one depth format, either
+		 * for triangles with a coverage mask if SMALL or for the rest
+		 * Programs test depth as ColourShader does, so they share its depth-only kernel
+		 */
+		template <class F, class Depth, bool SMALL, class Program>
+		void setProgramKernels(RasteriseFunction kernels[KERNEL_MODE_COUNT][2])
+		{
+			typedef ProgramShader<F, Program, false> Untextured;
+			typedef ProgramShader<F, Program, true> Textured;
+
+			kernels[KernelModes::DRAW][0] = &rasterise<Untextured, Depth, SMALL>;
+			kernels[KernelModes::DRAW][1] = &rasterise<Textured, Depth, SMALL>;
+
+			kernels[KernelModes::DEPTH_ONLY][0] = &rasterise<DepthOnlyShader<ColourShader<F> >, Depth, SMALL>;
+			kernels[KernelModes::DEPTH_ONLY][1] = &rasterise<DepthOnlyShader<ColourShader<F> >, Depth, SMALL>;
+
+			kernels[KernelModes::DEPTH_EQUAL][0] = &rasterise<DepthEqualShader<Untextured>, Depth, SMALL>;
+			kernels[KernelModes::DEPTH_EQUAL][1] = &rasterise<DepthEqualShader<Textured>, Depth, SMALL>;
+		}
+
+		/*
+		 * A program's kernels for every depth format, built over the float vector type F
+		 */
+		template <class F, class Program>
+		struct ProgramKernels : public ProgramKernelTable
+		{
+			ProgramKernels()
+			{
+				setProgramKernels<F, FloatDepth<F>, false, Program>(kernels[DepthFormats::FLOAT32]);
+				setProgramKernels<F, ReversedFloatDepth<F>, false, Program>(kernels[DepthFormats::REVERSED_FLOAT32]);
+				setProgramKernels<F, Unorm16Depth<F>, false, Program>(kernels[DepthFormats::UNORM16]);
+				setProgramKernels<F, Unorm24Depth<F>, false, Program>(kernels[DepthFormats::UNORM24]);
+
+				setProgramKernels<F, FloatDepth<F>, true, Program>(smallKernels[DepthFormats::FLOAT32]);
+				setProgramKernels<F, ReversedFloatDepth<F>, true, Program>(smallKernels[DepthFormats::REVERSED_FLOAT32]);
+				setProgramKernels<F, Unorm16Depth<F>, true, Program>(smallKernels[DepthFormats::UNORM16]);
+				setProgramKernels<F, Unorm24Depth<F>, true, Program>(smallKernels[DepthFormats::UNORM24]);
+			}
+		};
+
+		/*
+		 * The kernels for every depth format, mode and type of triangle, built over the float vector type F
+		 */
+		template <class F>
+		struct KernelTable : public RasterKernels
+		{
+			KernelTable()
+			{
+				setKernels<F, FloatDepth<F>, false>(kernels[DepthFormats::FLOAT32]);
+				setKernels<F, ReversedFloatDepth<F>, false>(kernels[DepthFormats::REVERSED_FLOAT32]);
+				setKernels<F, Unorm16Depth<F>, false>(kernels[DepthFormats::UNORM16]);
+				setKernels<F, Unorm24Depth<F>, false>(kernels[DepthFormats::UNORM24]);
+
+				setKernels<F, FloatDepth<F>, true>(smallKernels[DepthFormats::FLOAT32]);
+				setKernels<F, ReversedFloatDepth<F>, true>(smallKernels[DepthFormats::REVERSED_FLOAT32]);
+				setKernels<F, Unorm16Depth<F>, true>(smallKernels[DepthFormats::UNORM16]);
+				setKernels<F, Unorm24Depth<F>, true>(smallKernels[DepthFormats::UNORM24]);
+
+				addPrograms(*this);
+
+				setup = &setupBatch<F>;
+				coverage = &getSmallCoverage<F>;
+			}
+
+			/*
+			 * Fills in the kernels of each program in Programs.h, for addPrograms
+			 */
+			template <class Program>
+			void add(const Program*)
+			{
+				programs[Program::TYPE] = ProgramKernels<F, Program>();
+			}
+		};
+
+		/*
+		 * Returns the kernel table built over F, which is filled in the first time it's asked for
+		 */
+		template <class F>
+		const RasterKernels* getKernelTable()
+		{
+			static const KernelTable<F> kernels;
+
+			return &kernels;
+		}
+
+		/*
+		 * Returns the kernels of a program built over F, which are filled in the first time they're asked for
+		 */
+		template <class F, class Program>
+		const ProgramKernelTable* getProgramKernelTable()
+		{
+			static const ProgramKernels<F, Program> kernels;
+
+			return &kernels;
+		}
+	}
+}
+
+#endif
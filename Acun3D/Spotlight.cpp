@@ -1,10 +1,12 @@
+#include <math.h>
+
 #include "Spotlight.h"
 
 namespace a3d
 {
-	Spotlight::Spotlight(Vector position, Vector direction, Colour colour, float fov, float exponent)
+	Spotlight::Spotlight(Vector position, Vector direction, Colour colour, float fov, float exponent, float range)
 		: Light(LightTypes::SPOT, colour), _position(position), _direction(direction),
-			_fov(fov), _exponent(exponent)
+			_fov(fov), _cosFOV(cos(fov)), _exponent(exponent), _range(range)
 	{
 
 	}
@@ -24,8 +26,25 @@ namespace a3d
 		return _fov;
 	}
 		
+	/*
+	 * Returns the cosine of the angle from the spotlight's direction it lights out to, worked out once
+	 * rather than for every pixel it lights
+	 */
+	float Spotlight::getCosFOV() const
+	{
+		return _cosFOV;
+	}
+		
 	float Spotlight::getExponent() const
 	{
 		return _exponent;
 	}
+
+	/*
+	 * Returns the distance the light fades out over (see LightingMath::attenuate), or 0 if it reaches everything
+	 */
+	float Spotlight::getRange() const
+	{
+		return _range;
+	}
 }
\ No newline at end of file
@@ -9,19 +9,25 @@ namespace a3d
 		: public Light
 	{
 	public:
-		Spotlight(Vector position, Vector direction, Colour colour, float fov, float exponent);
+		Spotlight(Vector position, Vector direction, Colour colour, float fov, float exponent, float range = 0);
 		
 		const Vector& getPosition() const;
 		const Vector& getDirection() const;
 
 		float getFOV() const;
+		float getCosFOV() const;
 		float getExponent() const;
+		float getRange() const;
 
 	private:
 		Vector _position;
 		Vector _direction;
 		float _fov;
+		float _cosFOV;
 		float _exponent;
+
+		// Distance the light fades out over, or 0 for a light that reaches everything undimmed
+		float _range;
 	};
 }
 
@@ -0,0 +1,21 @@
+#ifndef __TEXTUREADDRESSMODE_H__
+#define __TEXTUREADDRESSMODE_H__
+
+namespace a3d
+{
+	namespace TextureAddressModes
+	{
+		enum TextureAddressMode
+		{
+			// Texture coordinates past an edge of the texture give the texels along that edge
+			CLAMP,
+
+			// The texture repeats
+			WRAP
+		};
+	}
+
+	typedef TextureAddressModes::TextureAddressMode TextureAddressMode;
+}
+
+#endif
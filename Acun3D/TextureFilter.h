@@ -0,0 +1,21 @@
+#ifndef __TEXTUREFILTER_H__
+#define __TEXTUREFILTER_H__
+
+namespace a3d
+{
+	namespace TextureFilters
+	{
+		enum TextureFilter
+		{
+			// The nearest texel
+			POINT,
+
+			// The four nearest texels, weighted by how near each is
+			BILINEAR
+		};
+	}
+
+	typedef TextureFilters::TextureFilter TextureFilter;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __TEXTUREFORMAT_H__
+#define __TEXTUREFORMAT_H__
+
+namespace a3d
+{
+	namespace TextureFormats
+	{
+		enum TextureFormat
+		{
+			// An int per texel, blue in the low byte, then green, red and alpha
+			BGRA8,
+
+			// A byte per texel indexing a palette of up to 256 BGRA8 colours, four to an int
+			INDEXED8,
+
+			// 16 bits per texel, 5 of red at the top, 6 of green and 5 of blue, two to an int
+			RGB565,
+
+			// Blocks of 4x4 texels in two ints, the first two RGB565 colours, the second 2 bits per texel
+			// choosing the first colour, the second, or one or two thirds of the way from the first to the second,
+			// which is BC1 (DXT1) without its transparent mode
+			BC1
+		};
+	}
+
+	typedef TextureFormats::TextureFormat TextureFormat;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef __TEXTURELAYOUT_H__
+#define __TEXTURELAYOUT_H__
+
+namespace a3d
+{
+	namespace TextureLayouts
+	{
+		enum TextureLayout
+		{
+			// Rows of texels one after another
+			LINEAR,
+
+			// Blocks of Image::TILE_SIZE texels square one after another in rows of blocks, each block's
+			// texels in rows, so that texels near each other in any direction share a cache line
+			TILED,
+
+			// Texels in Z-order, their index interleaving the bits of x and y, so that texels near each other
+			// in any direction are near each other in memory at every scale
+			MORTON
+		};
+	}
+
+	typedef TextureLayouts::TextureLayout TextureLayout;
+
+	// Number of texture layouts
+	const int TEXTURE_LAYOUT_COUNT = TextureLayouts::MORTON + 1;
+}
+
+#endif
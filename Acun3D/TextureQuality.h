@@ -0,0 +1,29 @@
+#ifndef __TEXTUREQUALITY_H__
+#define __TEXTUREQUALITY_H__
+
+namespace a3d
+{
+	namespace TextureQualities
+	{
+		// How much of a texture's quality Image::load may trade for memory when it picks a format
+		enum TextureQuality
+		{
+			// Always BGRA8
+			FULL,
+
+			// INDEXED8 if the full size image has no more than 256 colours, which keeps it exactly,
+			// otherwise BGRA8
+			HIGH,
+
+			// INDEXED8 if the full size image has no more than 256 colours, otherwise RGB565
+			MEDIUM,
+
+			// Always BC1
+			LOW
+		};
+	}
+
+	typedef TextureQualities::TextureQuality TextureQuality;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "ThreadPool.h"
+
+namespace a3d
+{
+	ThreadPool::ThreadPool(int workerCount)
+		: _job(0), _jobCount(0), _nextJob(0), _batch(0), _busyThreads(0), _quit(false)
+	{
+		setWorkerCount(workerCount);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		stopThreads();
+	}
+
+	/*
+	 * Sets the number of workers including the calling thread
+	 * A count of zero or less uses one worker per hardware thread
+	 */
+	void ThreadPool::setWorkerCount(int workerCount)
+	{
+		if (workerCount <= 0)
+			workerCount = (int)std::thread::hardware_concurrency();
+		if (workerCount <= 0)
+			workerCount = 1;
+
+		if (workerCount == getWorkerCount())
+			return;
+
+		stopThreads();
+		startThreads(workerCount - 1);
+	}
+
+	int ThreadPool::getWorkerCount() const
+	{
+		return (int)_threads.size() + 1;
+	}
+
+	/*
+	 * Executes jobs 0 .. jobCount - 1 and returns when all of them have finished
+	 */
+	void ThreadPool::run(Job& job, int jobCount)
+	{
+		if (jobCount <= 0)
+			return;
+
+		// Not worth waking anyone up for
+		if (_threads.empty() || jobCount == 1)
+		{
+			for (int i = 0; i < jobCount; ++i)
+				job.execute(i, 0);
+
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			_job = &job;
+			_jobCount = jobCount;
+			_nextJob = 0;
+			_busyThreads = (int)_threads.size();
+			_batch++;
+		}
+		_wake.notify_all();
+
+		// Help out on this thread
+		work(0);
+
+		// Wait for the other workers to let go of the job
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (_busyThreads > 0)
+			_finished.wait(lock);
+
+		_job = 0;
+	}
+
+	void ThreadPool::startThreads(int threadCount)
+	{
+		_quit = false;
+
+		for (int i = 0; i < threadCount; ++i)
+			_threads.push_back(std::thread(&ThreadPool::threadMain, this, i + 1, _batch));
+	}
+
+	void ThreadPool::stopThreads()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_wake.notify_all();
+
+		for (unsigned int i = 0; i < _threads.size(); ++i)
+			_threads[i].join();
+
+		_threads.clear();
+	}
+
+	void ThreadPool::threadMain(int worker, unsigned int lastBatch)
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				while (!_quit && _batch == lastBatch)
+					_wake.wait(lock);
+
+				if (_quit)
+					return;
+
+				lastBatch = _batch;
+			}
+
+			work(worker);
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_busyThreads--;
+			}
+			_finished.notify_one();
+		}
+	}
+
+	/*
+	 * Takes jobs from the shared counter until there are none left
+	 */
+	void ThreadPool::work(int worker)
+	{
+		int index;
+
+		while ((index = _nextJob++) < _jobCount)
+			_job->execute(index, worker);
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace a3d
+{
+	/*
+	 * A fixed set of worker threads which execute a numbered batch of jobs
+	 * The calling thread takes part in every batch as worker 0
+	 */
+	class ThreadPool
+	{
+	public:
+		struct Job
+		{
+			virtual ~Job() {}
+
+			// Executes job number index on the given worker (0 .. getWorkerCount() - 1)
+			virtual void execute(int index, int worker) = 0;
+		};
+
+		ThreadPool(int workerCount = 0);
+		~ThreadPool();
+
+		void setWorkerCount(int workerCount);
+		int getWorkerCount() const;
+
+		void run(Job& job, int jobCount);
+
+	private:
+		void startThreads(int threadCount);
+		void stopThreads();
+
+		void threadMain(int worker, unsigned int lastBatch);
+		void work(int worker);
+
+		std::vector<std::thread> _threads;
+
+		std::mutex _mutex;
+		std::condition_variable _wake;
+		std::condition_variable _finished;
+
+		// Current batch
+		Job* _job;
+		int _jobCount;
+		std::atomic<int> _nextJob;
+
+		unsigned int _batch;
+		int _busyThreads;
+		bool _quit;
+	};
+}
+
+#endif
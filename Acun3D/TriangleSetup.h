@@ -0,0 +1,184 @@
+#ifndef __TRIANGLESETUP_H__
+#define __TRIANGLESETUP_H__
+
+#include <vector>
+
+#include "Sampler.h"
+#include "LightList.h"
+#include "ProgramType.h"
+
+namespace a3d
+{
+	namespace TriangleTypes
+	{
+		enum TriangleType
+		{
+			COLOUR,
+			TEXTURED,
+			PHONG,
+			PHONG_TEXTURED,
+			VISIBILITY,
+
+			// Shaded by a program's fragment stage (see Programs.h), with or without a texture
+			PROGRAM,
+			PROGRAM_TEXTURED
+		};
+	}
+
+	typedef TriangleTypes::TriangleType TriangleType;
+
+	// Number of triangle types
+	const int TRIANGLE_TYPE_COUNT = TriangleTypes::PROGRAM_TEXTURED + 1;
+
+	/*
+	 * A value interpolated across a triangle
+	 * Stored as its value at (minX, minY) along with its x and y gradients
+	 */
+	struct Interpolant
+	{
+		float value;
+		float dx;
+		float dy;
+	};
+
+	/*
+	 * The half-space function of a triangle edge, positive for pixels inside it
+	 */
+	struct Edge
+	{
+		// Value at pixel (0, 0) in 28.4 fixed point, and its change for each pixel in x and y
+		int origin;
+		int stepX;
+		int stepY;
+
+		int at(int x, int y) const
+		{
+			return origin - stepX * x + stepY * y;
+		}
+	};
+
+	/*
+	 * A triangle that has been set up for rasterisation and is waiting in the tile bins
+	 */
+	struct TriangleSetup
+	{
+		static const int MAX_ATTRIBUTES = 9;
+
+		// Width and height in pixels of the largest bounding box drawn by the small-triangle kernels
+		static const int SMALL_SIZE = 4;
+
+		TriangleType type;
+
+		// Edge functions of the vertices snapped to 28.4 fixed point, from vertex 1 to 2, 2 to 3 and 3 to 1
+		Edge edges[3];
+
+		// Bounding box in pixels, clipped to the screen (max exclusive)
+		int minX, minY;
+		int maxX, maxY;
+
+		// For a bounding box no bigger than SMALL_SIZE square, the pixels of it inside the triangle,
+		// a bit for each in rows of SMALL_SIZE bits starting at (minX, minY), otherwise 0
+		unsigned int coverage;
+
+		// Depth
+		Interpolant z;
+
+		// Attributes, laid out depending on the type:
+		// COLOUR:         b, g, r
+		// TEXTURED:       b, g, r, u / z, v / z, 1 / z
+		// PHONG:          normal x, y, z, camera-space x, y, z
+		// PHONG_TEXTURED: normal x, y, z, camera-space x, y, z, u / z, v / z, 1 / z
+		// VISIBILITY:     none
+		// PROGRAM:        the program's varyings
+		// PROGRAM_TEXTURED: the program's varyings, u / z, v / z, 1 / z
+		Interpolant attributes[MAX_ATTRIBUTES];
+
+		// What a VISIBILITY triangle writes to the visibility buffer
+		unsigned int id;
+
+		// With a depth pre-pass, what the pre-pass writes where the triangle is in front (see RasterTarget)
+		unsigned int prepassId;
+
+		// Reads the texture of a textured triangle
+		Sampler sampler;
+
+		// For a textured triangle, how many pixels apart along a row its texture coordinates are worked out
+		// exactly, with those in between stepped affinely, or 1 if they're worked out at every pixel
+		int textureSpan;
+
+		// Lights of a Phong triangle
+		const LightList* lights;
+
+		// For a textured triangle, the attribute holding u / z, followed by v / z and 1 / z
+		int textureAttribute;
+
+		// Which program a PROGRAM or PROGRAM_TEXTURED triangle is shaded by, the program, and for a CUSTOM program
+		// its kernels for the path the rasteriser is on
+		ProgramType programType;
+		const void* program;
+		const ProgramKernelTable* programKernels;
+
+		/*
+		 * Returns the mipmap level of the sampler's image nearest the size of pixel (x, y) on the texture,
+		 * from how fast its texture coordinates change across the screen there
+		 * first is the interpolant holding u / z, followed by v / z and 1 / z
+		 */
+		int getTextureLevel(int first, float x, float y) const
+		{
+			const Interpolant& uoz = attributes[first];
+			const Interpolant& voz = attributes[first + 1];
+			const Interpolant& ooz = attributes[first + 2];
+
+			const float offsetX = x - minX;
+			const float offsetY = y - minY;
+
+			const float z = 1.0f / (ooz.value + ooz.dx * offsetX + ooz.dy * offsetY);
+			const float u = (uoz.value + uoz.dx * offsetX + uoz.dy * offsetY) * z;
+			const float v = (voz.value + voz.dx * offsetX + voz.dy * offsetY) * z;
+
+			// u = (u / z) / (1 / z) changes by ((u / z)' - u (1 / z)') / (1 / z) a pixel
+			const float dudx = (uoz.dx - u * ooz.dx) * z;
+			const float dvdx = (voz.dx - v * ooz.dx) * z;
+			const float dudy = (uoz.dy - u * ooz.dy) * z;
+			const float dvdy = (voz.dy - v * ooz.dy) * z;
+
+			const float footprintX = dudx * dudx + dvdx * dvdx;
+			const float footprintY = dudy * dudy + dvdy * dvdy;
+
+			return sampler.selectLevel(footprintX > footprintY ? footprintX : footprintY);
+		}
+	};
+
+	/*
+	 * Triangles waiting to be set up together, with their vertices and attributes laid out an array to a value
+	 * so that setup can work on a vector of triangles at a time
+	 * Everything else about each triangle goes straight into its setup as it's added
+	 */
+	struct TriangleBatch
+	{
+		// Most triangles in a batch, a multiple of the width of every SIMD.h vector
+		static const int SIZE = 16;
+
+		int count;
+
+		// Most attributes used by any triangle in the batch
+		int attributeCount;
+
+		// Screen positions and depths of each vertex
+		float x[3][SIZE];
+		float y[3][SIZE];
+		float z[3][SIZE];
+
+		// Values of each attribute at each vertex, laid out as in TriangleSetup
+		float attributes[TriangleSetup::MAX_ATTRIBUTES][3][SIZE];
+
+		// The set up triangles, and whether each of them might cover any pixels
+		TriangleSetup setups[SIZE];
+		bool visible[SIZE];
+
+		// Whether each triangle is lit by the deferred shading pass
+		bool deferred[SIZE];
+	};
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef __BANDEDPROGRAM_H__
+#define __BANDEDPROGRAM_H__
+
+#include <Programs.h>
+
+/*
+ * A program of TestProject's own: the lit colour rounded to a few flat bands
+ * Its kernels are built for each path by BandedProgramScalar.cpp, BandedProgramSSE2.cpp and the rest
+ */
+struct BandedProgram
+{
+	static const a3d::ProgramType TYPE = a3d::ProgramTypes::CUSTOM;
+
+	// Lit b, g and r
+	static const int VARYINGS = 3;
+
+	// Number of bands between black and full brightness
+	float bands;
+
+	void vertex(const a3d::ProgramVertex& in, float* varyings) const
+	{
+		varyings[0] = in.colour._b;
+		varyings[1] = in.colour._g;
+		varyings[2] = in.colour._r;
+	}
+
+	template <class F>
+	void fragment(const F* varyings, F* colour) const
+	{
+		for (int i = 0; i < 3; ++i)
+			colour[i] = colour[i] * toFloat(toInt(varyings[i] * F(bands))) * F(1.0f / bands);
+	}
+};
+
+namespace a3d
+{
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::SCALAR>();
+
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::SSE2>();
+
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::AVX2>();
+
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::AVX512>();
+
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::NEON>();
+}
+
+#endif
\ No newline at end of file
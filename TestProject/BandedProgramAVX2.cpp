@@ -0,0 +1,45 @@
+// BandedProgram's AVX2 kernels, built for AVX2 whatever the rest of the project targets
+
+// Headers shared with the rest of the project are included before switching instruction set
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include <RasterKernels.h>
+#include <LightList.h>
+#include <LightingMath.h>
+
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#elif defined(__GNUC__) && !defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma GCC target("avx2")
+#define SIMD_AVX2
+#elif defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#define SIMD_AVX2
+#define POP_TARGET
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define SIMD_AVX2
+#endif
+
+#include <ProgramKernels.h>
+
+#include "BandedProgram.h"
+
+namespace a3d
+{
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::AVX2>()
+	{
+#ifdef SIMD_AVX2
+		return getProgramKernelTable<simd::avx2::float8, BandedProgram>();
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef POP_TARGET
+#pragma clang attribute pop
+#endif
\ No newline at end of file
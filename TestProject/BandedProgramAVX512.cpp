@@ -0,0 +1,56 @@
+// BandedProgram's AVX512 kernels, built for AVX512 whatever the rest of the project targets
+
+// Headers shared with the rest of the project are included before switching instruction set
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include <RasterKernels.h>
+#include <LightList.h>
+#include <LightingMath.h>
+
+#if defined(__AVX512F__)
+#define SIMD_AVX512
+#elif defined(__GNUC__) && !defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma GCC target("avx512f")
+#define SIMD_AVX512
+#elif defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#define SIMD_AVX512
+#define POP_TARGET
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define SIMD_AVX512
+#endif
+
+// GCC's AVX512 intrinsics start from undefined vectors, which it warns about wherever they're inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <ProgramKernels.h>
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#include "BandedProgram.h"
+
+namespace a3d
+{
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::AVX512>()
+	{
+#ifdef SIMD_AVX512
+		return getProgramKernelTable<simd::avx512::float16, BandedProgram>();
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef POP_TARGET
+#pragma clang attribute pop
+#endif
\ No newline at end of file
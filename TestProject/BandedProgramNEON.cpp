@@ -0,0 +1,21 @@
+// BandedProgram's NEON kernels, only built when the compiler is targeting an ARM CPU with NEON
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#endif
+
+#include <ProgramKernels.h>
+
+#include "BandedProgram.h"
+
+namespace a3d
+{
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::NEON>()
+	{
+#ifdef SIMD_NEON
+		return getProgramKernelTable<simd::neon::float4, BandedProgram>();
+#else
+		return 0;
+#endif
+	}
+}
\ No newline at end of file
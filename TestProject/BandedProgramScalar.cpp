@@ -0,0 +1,15 @@
+// BandedProgram's scalar kernels
+#define SIMD_SCALAR
+
+#include <ProgramKernels.h>
+
+#include "BandedProgram.h"
+
+namespace a3d
+{
+	template <>
+	const ProgramKernelTable* getProgramKernels<BandedProgram, RasterPaths::SCALAR>()
+	{
+		return getProgramKernelTable<simd::scalar::float4, BandedProgram>();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "LightingAccuracyCheck.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include <MD2_Model.h>
+#include <LightList.h>
+#include <DirectionalLight.h>
+#include <PointLight.h>
+#include <Spotlight.h>
+
+namespace Benchmarks
+{
+	namespace
+	{
+		const char* ACCURACY_NAMES[a3d::LIGHTING_ACCURACY_COUNT] = { "exact", "fast", "approximate" };
+
+		namespace LightKinds
+		{
+			enum LightKind
+			{
+				DIRECTIONAL,
+				POINT,
+				SPOT
+			};
+		}
+
+		typedef LightKinds::LightKind LightKind;
+
+		const int LIGHT_KIND_COUNT = LightKinds::SPOT + 1;
+		const char* LIGHT_KIND_NAMES[LIGHT_KIND_COUNT] = { "directional", "point", "spot" };
+
+		// Steps of latitude and longitude that normals and the directions lights shine from are swept over
+		const int LATITUDES = 9;
+		const int LONGITUDES = 16;
+
+		// Camera-space points lit, in front of the camera
+		const float POSITIONS[][3] = { { 0.0f, 0.0f, -50.0f }, { 30.0f, -20.0f, -80.0f } };
+		const int POSITION_COUNT = sizeof(POSITIONS) / sizeof(POSITIONS[0]);
+
+		// How far point lights and spotlights are from the point, and the ranges they're given, 0 for none
+		const float DISTANCE = 40.0f;
+		const float RANGES[] = { 0.0f, 80.0f };
+		const int RANGE_COUNT = sizeof(RANGES) / sizeof(RANGES[0]);
+
+		// Spotlights' exponents, whole ones taken by squaring and a fractional one by pow, their cone,
+		// and how far they're turned from the point, as a fraction of the cone, staying clear of its edge
+		const float EXPONENTS[] = { 0.0f, 1.0f, 2.0f, 5.0f, 32.0f, 64.0f, 2.5f };
+		const int EXPONENT_COUNT = sizeof(EXPONENTS) / sizeof(EXPONENTS[0]);
+		const float FOV = 3.14159265f / 4.0f;
+		const float TURNS[] = { 0.0f, 0.5f, 0.8f };
+		const int TURN_COUNT = sizeof(TURNS) / sizeof(TURNS[0]);
+
+		/*
+		 * Returns the unit vector at a step of latitude and longitude
+		 */
+		a3d::Vector getDirection(int latitude, int longitude)
+		{
+			const float theta = 3.14159265f * (latitude + 0.5f) / LATITUDES;
+			const float phi = 2.0f * 3.14159265f * longitude / LONGITUDES;
+
+			return a3d::Vector(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+		}
+
+		/*
+		 * Returns a unit vector at right angles to direction
+		 */
+		a3d::Vector getPerpendicular(const a3d::Vector& direction)
+		{
+			const a3d::Vector up = (fabs(direction.getY()) < 0.9f ? a3d::Vector(0, 1, 0) : a3d::Vector(1, 0, 0));
+
+			return direction.cross(up).getNormalised();
+		}
+
+		/*
+		 * Raises each channel of worst, out of 255, to the difference between two lit colours if it's larger
+		 */
+		void addDifference(const a3d::Colour& exact, const a3d::Colour& colour, float* worst)
+		{
+			const float differences[3] = { fabs(colour._b - exact._b), fabs(colour._g - exact._g), fabs(colour._r - exact._r) };
+
+			for (int i = 0; i < 3; ++i)
+			{
+				if (differences[i] * 255.0f > worst[i])
+					worst[i] = differences[i] * 255.0f;
+			}
+		}
+
+		/*
+		 * Lights the point at position with every swept normal, through MD2_Model::calculateLights and
+		 * LightList::calculate at each accuracy, and raises the largest differences each gives from EXACT
+		 */
+		void measureLight(a3d::Light& light, const a3d::Vector& position,
+						float worst[2][a3d::LIGHTING_ACCURACY_COUNT][3])
+		{
+			std::vector<a3d::Light*> lights(1, &light);
+
+			a3d::LightList lists[a3d::LIGHTING_ACCURACY_COUNT];
+			for (int i = 0; i < a3d::LIGHTING_ACCURACY_COUNT; ++i)
+				lists[i].compile(lights, (a3d::LightingAccuracy)i);
+
+			for (int latitude = 0; latitude < LATITUDES; ++latitude)
+			{
+				for (int longitude = 0; longitude < LONGITUDES; ++longitude)
+				{
+					a3d::Vector normal = getDirection(latitude, longitude);
+					a3d::Vector point = position;
+
+					const a3d::Colour exact = a3d::md2::MD2_Model::calculateLights(point, normal, lights);
+					const a3d::Colour exactList = lists[a3d::LightingAccuracies::EXACT].calculate(point, normal);
+
+					for (int i = a3d::LightingAccuracies::EXACT + 1; i < a3d::LIGHTING_ACCURACY_COUNT; ++i)
+					{
+						addDifference(exact, a3d::md2::MD2_Model::calculateLights(point, normal, lights, (a3d::LightingAccuracy)i),
+										worst[0][i]);
+						addDifference(exactList, lists[i].calculate(point, normal), worst[1][i]);
+					}
+				}
+			}
+		}
+	}
+
+	/*
+	 * Measures how far each lighting accuracy strays from EXACT, lighting points with every swept normal by single
+	 * directional lights, point lights and spotlights shining from every swept direction, the latter two with and
+	 * without a range and spotlights with several exponents, turned so the point is inside their cone
+	 * Returns a line for each function, kind of light and accuracy with the largest difference in b, g and r,
+	 * out of 255, to compare against the bounds LightingAccuracy.h gives
+	 */
+	std::string runLightingAccuracyCheck()
+	{
+		// Largest differences, for calculateLights then LightList, for each kind of light and accuracy
+		float worst[LIGHT_KIND_COUNT][2][a3d::LIGHTING_ACCURACY_COUNT][3] = {};
+
+		const a3d::Colour colour(1.0f, 0.6f, 0.3f);
+
+		for (int p = 0; p < POSITION_COUNT; ++p)
+		{
+			const a3d::Vector position(POSITIONS[p][0], POSITIONS[p][1], POSITIONS[p][2]);
+
+			for (int latitude = 0; latitude < LATITUDES; ++latitude)
+			{
+				for (int longitude = 0; longitude < LONGITUDES; ++longitude)
+				{
+					// Direction the light shines on the point in, and where a light DISTANCE away shining that way is
+					const a3d::Vector direction = getDirection(latitude, longitude);
+					const a3d::Vector origin = position + direction * -DISTANCE;
+
+					a3d::DirectionalLight directional(direction, colour);
+					measureLight(directional, position, worst[LightKinds::DIRECTIONAL]);
+
+					for (int r = 0; r < RANGE_COUNT; ++r)
+					{
+						a3d::PointLight point(origin, colour, RANGES[r]);
+						measureLight(point, position, worst[LightKinds::POINT]);
+
+						const a3d::Vector perpendicular = getPerpendicular(direction);
+
+						for (int t = 0; t < TURN_COUNT; ++t)
+						{
+							const float turn = TURNS[t] * FOV;
+							const a3d::Vector aim = direction * cos(turn) + perpendicular * sin(turn);
+
+							for (int e = 0; e < EXPONENT_COUNT; ++e)
+							{
+								a3d::Spotlight spot(origin, aim, colour, FOV, EXPONENTS[e], RANGES[r]);
+								measureLight(spot, position, worst[LightKinds::SPOT]);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		const char* FUNCTION_NAMES[2] = { "MD2_Model::calculateLights", "LightList::calculate" };
+
+		std::string result;
+		char line[256];
+
+		sprintf_s(line, "Largest difference from exact in b, g and r, out of 255, over %d normals and %d light directions\n",
+					LATITUDES * LONGITUDES, LATITUDES * LONGITUDES);
+		result += line;
+
+		for (int f = 0; f < 2; ++f)
+		{
+			for (int kind = 0; kind < LIGHT_KIND_COUNT; ++kind)
+			{
+				for (int i = a3d::LightingAccuracies::EXACT + 1; i < a3d::LIGHTING_ACCURACY_COUNT; ++i)
+				{
+					const float* channels = worst[kind][f][i];
+
+					sprintf_s(line, "%s, %s, %s: %.2f %.2f %.2f\n", FUNCTION_NAMES[f], LIGHT_KIND_NAMES[kind],
+								ACCURACY_NAMES[i], channels[0], channels[1], channels[2]);
+					result += line;
+				}
+			}
+		}
+
+		return result;
+	}
+}
\ No newline at end of file
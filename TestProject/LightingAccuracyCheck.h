@@ -0,0 +1,11 @@
+#ifndef __LIGHTINGACCURACYCHECK_H__
+#define __LIGHTINGACCURACYCHECK_H__
+
+#include <string>
+
+namespace Benchmarks
+{
+	std::string runLightingAccuracyCheck();
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "Lights.h"
+
+#include "Resource.h"
+
+namespace Demos
+{
+	Lights::Lights(a3d::Renderer& rend, a3d::Camera& cam, int time, int length, a3d::MaterialType materialType,
+			a3d::ShadingType shadingType, a3d::CullingType cullingType)
+		: Demos::Demo(rend, cam, time, length), _materialType(materialType), _shadingType(shadingType), _cullingType(cullingType)
+	{
+		// Set up scene
+		_model.loadModel("miku.md2");
+		_plane.loadModel("plane.md2");
+
+		a3d::TransformNode* planeTranslate = new a3d::TransformNode(rend);
+		planeTranslate->translate(0, 0, -20);
+		planeTranslate->scale(6, 6, 6);
+		add(planeTranslate);
+		planeTranslate->add(new a3d::ModelNode(rend, _plane));
+
+		// Two rows of mikus turning on the spot
+		for (int i = 0; i < 10; ++i)
+		{
+			a3d::TransformNode* translate = new a3d::TransformNode(rend);
+			translate->translate((i % 5) * 30.0f - 60 + (i / 5) * 15.0f, 0, (i / 5) * -50.0f + 10);
+			add(translate);
+
+			a3d::RotatingNode* rotatingNode = new a3d::RotatingNode(rend, 0, 0.001f, 0, 1, time);
+			translate->add(rotatingNode);
+
+			rotatingNode->add(new a3d::ModelNode(rend, _model));
+		}
+
+		// A grid of small point lights between them and a narrow spotlight over each, all with a range
+		// so each tile is only lit by the few that reach it
+		for (int i = 0; i < 32; ++i)
+		{
+			a3d::Vector position((i % 8) * 20.0f - 70, (i / 16) * 30.0f + 10, ((i / 8) % 2) * -50.0f + 25);
+			a3d::Colour colour(0.3f + 0.1f * (i % 7), 0.3f + 0.15f * (i % 5), 1.0f - 0.15f * (i % 6));
+
+			addLight(new a3d::PointLight(position, colour, 30.0f));
+		}
+
+		for (int i = 0; i < 10; ++i)
+		{
+			a3d::Vector position((i % 5) * 30.0f - 60 + (i / 5) * 15.0f, 90, (i / 5) * -50.0f + 10);
+			a3d::Colour colour(0.9f - 0.15f * (i % 5), 0.5f, 0.2f + 0.15f * (i % 5));
+
+			addLight(new a3d::Spotlight(position, a3d::Vector(0, -1, 0), colour, PI / 8.0f, 2, 100.0f));
+		}
+	}
+
+	void Lights::traverse(int time)
+	{
+		// Set up camera
+		a3d::Vertex4f pos(4, 0, 50, 170, 1);
+		_cam.setPosition(pos);
+
+		// Set up rendering mode
+		_rend.setMaterialType(_materialType);
+		_rend.setShadingType(_shadingType);
+		_rend.setCullingType(_cullingType);
+
+		// Render demo
+		Demo::traverse(time);
+	}
+}
\ No newline at end of file
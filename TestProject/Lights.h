@@ -0,0 +1,37 @@
+#ifndef __LIGHTS_H__
+#define __LIGHTS_H__
+
+#include <MD2_Model.h>
+
+#include <PointLight.h>
+#include <Spotlight.h>
+
+#include <SceneNode.h>
+#include <ModelNode.h>
+#include <RotatingNode.h>
+#include <TransformNode.h>
+
+#include "Demo.h"
+
+namespace Demos
+{
+	class Lights
+		: public Demo
+	{
+	public:
+		Lights(a3d::Renderer& rend, a3d::Camera& cam, int time, int length, a3d::MaterialType materialType = a3d::MaterialTypes::SOLID,
+			a3d::ShadingType shadingType = a3d::ShadingTypes::PHONG, a3d::CullingType cullingType = a3d::CullingTypes::BACK);
+		
+		virtual void traverse(int time = 0);
+
+	private:
+		a3d::md2::MD2_Model _model;
+		a3d::md2::MD2_Model _plane;
+		
+		a3d::MaterialType _materialType;
+		a3d::ShadingType _shadingType;
+		a3d::CullingType _cullingType;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -18,6 +18,7 @@
 #include <Pixel.h>
 #include <MD2_Model.h>
 #include <Renderer.h>
+#include <Programs.h>
 
 // Scene Graph
 #include <SceneNode.h>
@@ -33,6 +34,14 @@
 #include "Tunnel.h"
 #include "Orbit.h"
 #include "Sonic.h"
+#include "Lights.h"
+
+// Programs
+#include "BandedProgram.h"
+
+// Benchmarks
+#include "TextureBenchmark.h"
+#include "LightingAccuracyCheck.h"
 
 #define MAX_LOADSTRING 100
 
@@ -76,6 +85,13 @@ float yrot = 0;
 
 a3d::Matrix4f projection;
 
+// Programs to shade models with, and which of them is in use (0 for none)
+a3d::TintProgram tintProgram = { a3d::Colour(1.0f, 0.6f, 0.3f) };
+a3d::FogProgram fogProgram = { a3d::Colour(0.3f, 0.4f, 0.5f), 60.0f, 110.0f };
+a3d::RimLightProgram rimLightProgram = { a3d::Colour(0.2f, 0.5f, 1.0f), 2.0f };
+BandedProgram bandedProgram = { 4.0f };
+int currentProgram = 0;
+
 int APIENTRY _tWinMain(HINSTANCE hInstance,
                      HINSTANCE hPrevInstance,
                      LPTSTR    lpCmdLine,
@@ -241,6 +257,54 @@ int APIENTRY _tWinMain(HINSTANCE hInstance,
 	demo->addLight(new a3d::Spotlight(a3d::Vector(0, 0, 0), a3d::Vector(0, 0, -1).getNormalised(), a3d::Colour(0, 0.75f, 0.75f), PI / 2.0f, 64));
 	list.push_back(demo);
 
+	// Textured, deferred phong, directional + point + spotlight
+	demo = new Demos::Miku(rend, cam, time, 10000, a3d::MaterialTypes::TEXTURED, a3d::ShadingTypes::DEFERRED_PHONG, a3d::CullingTypes::BACK);
+	demo->addMessage("Material mode: Textured");
+	demo->addMessage("Shading mode:  Deferred Phong");
+	demo->addMessage("Culling mode:  Back");
+	demo->addMessage("");
+	demo->addMessage("Lit once per pixel");
+	demo->addMessage("");
+	demo->addMessage("Lights:");
+	demo->addMessage("Directional (white)");
+	demo->addMessage("Point (pink)");
+	demo->addMessage("Spotlight (blue)");
+	demo->addLight(new a3d::DirectionalLight(a3d::Vector(-1, 0, 0).getNormalised(), a3d::Colour(0.85f, 0.85f, 0.85f)));
+	demo->addLight(new a3d::PointLight(a3d::Vector(15, 15, -80), a3d::Colour(0.7f, 0, 0.7f)));
+	demo->addLight(new a3d::Spotlight(a3d::Vector(0, 0, 0), a3d::Vector(0, 0, -1).getNormalised(), a3d::Colour(0, 0.75f, 0.75f), PI / 2.0f, 64));
+	list.push_back(demo);
+
+	// Many point lights and spotlights with ranges, each tile lit only by those reaching it
+	demo = new Demos::Lights(rend, cam, time, 15000, a3d::MaterialTypes::TEXTURED, a3d::ShadingTypes::PHONG, a3d::CullingTypes::BACK);
+	demo->addMessage("Material mode: Textured");
+	demo->addMessage("Shading mode:  Phong");
+	demo->addMessage("Culling mode:  Back");
+	demo->addMessage("");
+	demo->addMessage("Lights culled per tile");
+	demo->addMessage("");
+	demo->addMessage("Lights:");
+	demo->addMessage("Ambient (white)");
+	demo->addMessage("32 point (ranged)");
+	demo->addMessage("10 spotlights (ranged)");
+	demo->addLight(new a3d::AmbientLight(0.3f));
+	list.push_back(demo);
+
+	// The same lights, culled to the positions resolved in each tile
+	demo = new Demos::Lights(rend, cam, time, 15000, a3d::MaterialTypes::TEXTURED, a3d::ShadingTypes::DEFERRED_PHONG, a3d::CullingTypes::BACK);
+	demo->addMessage("Material mode: Textured");
+	demo->addMessage("Shading mode:  Deferred Phong");
+	demo->addMessage("Culling mode:  Back");
+	demo->addMessage("");
+	demo->addMessage("Lights culled per tile");
+	demo->addMessage("Lit once per pixel");
+	demo->addMessage("");
+	demo->addMessage("Lights:");
+	demo->addMessage("Ambient (white)");
+	demo->addMessage("32 point (ranged)");
+	demo->addMessage("10 spotlights (ranged)");
+	demo->addLight(new a3d::AmbientLight(0.3f));
+	list.push_back(demo);
+
 	// Scenegraph recursion, camera movement
 	demo = new Demos::Tunnel(rend, cam, time, 15000, a3d::MaterialTypes::TEXTURED, a3d::ShadingTypes::SMOOTH, a3d::CullingTypes::BACK);
 	demo->addMessage("Material mode: Solid");
@@ -321,6 +385,89 @@ int APIENTRY _tWinMain(HINSTANCE hInstance,
 
 			list[currentDemo]->reset(time);
 		}
+
+		// On pressing P, switch the depth pre-pass on or off to compare frame rates
+		if (keys['P'] && !oldkeys['P'])
+			rend.setDepthPrepass(!rend.getDepthPrepass());
+
+		// On pressing O, switch between drawing models as they come and front to back
+		if (keys['O'] && !oldkeys['O'])
+		{
+			if (rend.getDrawOrder() == a3d::DrawOrders::IMMEDIATE)
+				rend.setDrawOrder(a3d::DrawOrders::FRONT_TO_BACK);
+			else
+				rend.setDrawOrder(a3d::DrawOrders::IMMEDIATE);
+		}
+
+		// On pressing Z, cycle through the depth buffer formats
+		if (keys['Z'] && !oldkeys['Z'])
+			rend.setDepthFormat((a3d::DepthFormat)((rend.getDepthFormat() + 1) % a3d::DEPTH_FORMAT_COUNT));
+
+		// On pressing T, cycle the longest affine texture span through off, 8, 16 and 32 pixels
+		if (keys['T'] && !oldkeys['T'])
+		{
+			if (rend.getPerspectiveSpan() == 0)
+				rend.setPerspectiveSpan(a3d::Rasteriser::MIN_PERSPECTIVE_SPAN);
+			else if (rend.getPerspectiveSpan() < a3d::Rasteriser::MAX_PERSPECTIVE_SPAN)
+				rend.setPerspectiveSpan(rend.getPerspectiveSpan() * 2);
+			else
+				rend.setPerspectiveSpan(0);
+		}
+
+		// On pressing F, switch between point and bilinear texture filtering
+		if (keys['F'] && !oldkeys['F'])
+		{
+			if (rend.getTextureFilter() == a3d::TextureFilters::POINT)
+				rend.setTextureFilter(a3d::TextureFilters::BILINEAR);
+			else
+				rend.setTextureFilter(a3d::TextureFilters::POINT);
+		}
+
+		// On pressing M, cycle through picking mipmaps never, per triangle and per group of pixels
+		if (keys['M'] && !oldkeys['M'])
+			rend.setMipmapMode((a3d::MipmapMode)((rend.getMipmapMode() + 1) % (a3d::MipmapModes::GROUP + 1)));
+
+		// On pressing X, cycle through the layouts textures are read in
+		if (keys['X'] && !oldkeys['X'])
+			rend.setTextureLayout((a3d::TextureLayout)((rend.getTextureLayout() + 1) % a3d::TEXTURE_LAYOUT_COUNT));
+
+		// On pressing A, cycle through how accurately lighting maths is done
+		if (keys['A'] && !oldkeys['A'])
+			rend.setLightingAccuracy((a3d::LightingAccuracy)((rend.getLightingAccuracy() + 1) % (a3d::LightingAccuracies::APPROXIMATE + 1)));
+
+		// On pressing E, cycle through shading with no program, a tint, fog, rim lighting and bands
+		if (keys['E'] && !oldkeys['E'])
+		{
+			currentProgram = (currentProgram + 1) % (a3d::PROGRAM_TYPE_COUNT + 2);
+
+			if (currentProgram == 1)
+				rend.setProgram(tintProgram);
+			else if (currentProgram == 2)
+				rend.setProgram(fogProgram);
+			else if (currentProgram == 3)
+				rend.setProgram(rimLightProgram);
+			else if (currentProgram == 4)
+				rend.setProgram(bandedProgram);
+			else
+				rend.clearProgram();
+		}
+
+		// On pressing B, time sampling a texture in each layout and format and show the results
+		if (keys['B'] && !oldkeys['B'])
+			MessageBoxA(hWnd, Benchmarks::runTextureBenchmark("miku.png").c_str(), "Texture layouts and formats", MB_OK);
+
+		// On pressing C, measure how far each lighting accuracy strays from EXACT and show the results
+		if (keys['C'] && !oldkeys['C'])
+			MessageBoxA(hWnd, Benchmarks::runLightingAccuracyCheck().c_str(), "Lighting accuracy", MB_OK);
+
+		// On pressing L, switch between drawing straight to the screen and drawing to tiled buffers
+		if (keys['L'] && !oldkeys['L'])
+		{
+			if (rend.getFramebufferLayout() == a3d::FramebufferLayouts::LINEAR)
+				rend.setFramebufferLayout(a3d::FramebufferLayouts::TILED);
+			else
+				rend.setFramebufferLayout(a3d::FramebufferLayouts::LINEAR);
+		}
 		
 		// Clear screen
 		rend.beginScene(a3d::Pixel(0, 0, 0, 0));
@@ -349,6 +496,9 @@ int APIENTRY _tWinMain(HINSTANCE hInstance,
 				screenText = list[currentDemo]->getDemoText();
 			rend.popMatrix();
 
+			// Draw anything kept for the depth pre-pass and light anything that was deferred
+			rend.endScene();
+
 			if (list[currentDemo]->dead())
 			{
 				if (currentDemo < list.size() - 1)
@@ -368,7 +518,14 @@ int APIENTRY _tWinMain(HINSTANCE hInstance,
 		if (dt >= 1000)
 		{
 			fps = frameCount;
-			swprintf_s(title, L"%d", fps);
+			a3d::RasterStats stats = rend.getRasterStats();
+			swprintf_s(title, L"%d (%S%S%S%S, %S depth, %.2f bytes per pixel, %u clipped, %u tile lights, %u culled)", fps,
+						a3d::Rasteriser::getRasterPathName(rend.getRasterPath()),
+						rend.getDepthPrepass() ? ", depth pre-pass" : "",
+						rend.getDrawOrder() == a3d::DrawOrders::FRONT_TO_BACK ? ", front to back" : "",
+						rend.getFramebufferLayout() == a3d::FramebufferLayouts::TILED ? ", tiled" : "",
+						a3d::Rasteriser::getDepthFormatName(rend.getDepthFormat()), rend.getBytesPerPixel(),
+						rend.getClippedTriangles(), stats.tileLights, stats.culledLights);
 			startTime = GetTickCount();
 			frameCount = 0;
 			
@@ -0,0 +1,211 @@
+#include "TextureBenchmark.h"
+
+// Windows API
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include <Image.h>
+#include <Sampler.h>
+#include <CPUFeatures.h>
+
+#include "TextureBenchmarkPaths.h"
+
+namespace Benchmarks
+{
+	namespace
+	{
+		const char* LAYOUT_NAMES[a3d::TEXTURE_LAYOUT_COUNT] = { "linear", "tiled", "morton" };
+		const char* FORMAT_NAMES[] = { "bgra8", "indexed8", "rgb565", "bc1" };
+
+		const a3d::TextureQuality QUALITIES[] =
+		{
+			a3d::TextureQualities::FULL, a3d::TextureQualities::HIGH, a3d::TextureQualities::MEDIUM, a3d::TextureQualities::LOW
+		};
+
+		const int QUALITY_COUNT = sizeof(QUALITIES) / sizeof(QUALITIES[0]);
+
+		// Angles the rows of samples are rotated by, in degrees
+		const int ANGLES[] = { 0, 30, 60, 90 };
+		const int ANGLE_COUNT = sizeof(ANGLES) / sizeof(ANGLES[0]);
+
+		// Each timing is the fastest of this many passes
+		const int PASSES = 5;
+
+		/*
+		 * A way of sampling the benchmark's rows, by name
+		 */
+		struct SamplePath
+		{
+			const char* name;
+			SampleRowsFunction sampleRows;
+		};
+
+		double getSeconds()
+		{
+			LARGE_INTEGER frequency;
+			LARGE_INTEGER counter;
+
+			QueryPerformanceFrequency(&frequency);
+			QueryPerformanceCounter(&counter);
+
+			return (double)counter.QuadPart / (double)frequency.QuadPart;
+		}
+
+		/*
+		 * Samples rows of texels (see SampleRowsFunction) with Sampler::sample, a texel at a time
+		 */
+		unsigned int sampleRotated(const a3d::Sampler& sampler, int angle)
+		{
+			const float radians = angle * 3.14159265f / 180.0f;
+			const float c = cos(radians);
+			const float s = sin(radians);
+
+			const int width = sampler.getWidth();
+			const int height = sampler.getHeight();
+			const float centreX = width * 0.5f;
+			const float centreY = height * 0.5f;
+
+			unsigned int sum = 0;
+
+			for (int y = 0; y < height; ++y)
+			{
+				const float rowY = y - centreY;
+
+				float u = centreX - centreX * c - rowY * s;
+				float v = centreY - centreX * s + rowY * c;
+
+				for (int x = 0; x < width; ++x)
+				{
+					sum += sampler.sample(u, v);
+
+					u += c;
+					v += s;
+				}
+			}
+
+			return sum;
+		}
+
+		/*
+		 * Returns the millions of texels sampleRows samples a second with sampler at each angle
+		 * Adds the texels to sum so that they can't be thrown away
+		 */
+		std::string timeAngles(const a3d::Sampler& sampler, SampleRowsFunction sampleRows, unsigned int& sum)
+		{
+			const double texels = (double)sampler.getWidth() * sampler.getHeight();
+
+			std::string result;
+			char line[256];
+
+			for (int i = 0; i < ANGLE_COUNT; ++i)
+			{
+				double best = 0;
+
+				for (int pass = 0; pass < PASSES; ++pass)
+				{
+					const double start = getSeconds();
+					sum += sampleRows(sampler, ANGLES[i]);
+					const double time = getSeconds() - start;
+
+					if (pass == 0 || time < best)
+						best = time;
+				}
+
+				sprintf_s(line, " %.1f", texels / best / 1000000.0);
+				result += line;
+			}
+
+			return result;
+		}
+	}
+
+	/*
+	 * Times point sampling an image in each texture layout along rows at several angles, which is where
+	 * rows of texels one after another miss the cache the most, then in the format each texture quality
+	 * picks for it
+	 * Each is timed with Sampler::sample, then with sampleTexels on each instruction set the build and the CPU
+	 * can run, as the rasteriser's kernels sample
+	 * Returns a line for each way of sampling, layout and quality with the millions of texels sampled a second
+	 * at each angle
+	 */
+	std::string runTextureBenchmark(const char* filename)
+	{
+		a3d::Image image(filename);
+
+		if (image.getLevelCount() == 0)
+			return "Couldn't load the benchmark's image";
+
+		for (int layout = 0; layout < a3d::TEXTURE_LAYOUT_COUNT; ++layout)
+			image.addLayout((a3d::TextureLayout)layout);
+
+		const SamplePath paths[] =
+		{
+			{ "Sampler::sample", &sampleRotated },
+			{ "sampleTexels, sse2", a3d::CPUFeatures::hasSSE2() ? getSSE2SampleRows() : 0 },
+			{ "sampleTexels, avx2", a3d::CPUFeatures::hasAVX2() ? getAVX2SampleRows() : 0 },
+			{ "sampleTexels, avx512", a3d::CPUFeatures::hasAVX512() ? getAVX512SampleRows() : 0 },
+			{ "sampleTexels, neon", getNEONSampleRows() }
+		};
+
+		const int pathCount = sizeof(paths) / sizeof(paths[0]);
+
+		std::string result;
+		char line[256];
+		unsigned int sum = 0;
+
+		sprintf_s(line, "%dx%d texels, millions sampled a second at", image.getWidth(), image.getHeight());
+		result += line;
+
+		for (int i = 0; i < ANGLE_COUNT; ++i)
+		{
+			sprintf_s(line, " %d", ANGLES[i]);
+			result += line;
+		}
+
+		result += " degrees\n";
+
+		for (int path = 0; path < pathCount; ++path)
+		{
+			if (paths[path].sampleRows == 0)
+				continue;
+
+			result += "\n";
+			result += paths[path].name;
+			result += "\n";
+
+			for (int layout = 0; layout < a3d::TEXTURE_LAYOUT_COUNT; ++layout)
+			{
+				const a3d::Sampler sampler(image, a3d::TextureFilters::POINT, a3d::TextureAddressModes::WRAP,
+											a3d::MipmapModes::NONE, (a3d::TextureLayout)layout);
+
+				sprintf_s(line, "%s:", LAYOUT_NAMES[layout]);
+				result += line;
+				result += timeAngles(sampler, paths[path].sampleRows, sum);
+				result += "\n";
+			}
+
+			for (int i = 0; i < QUALITY_COUNT; ++i)
+			{
+				const a3d::Image packed(filename, 0, a3d::TextureLayouts::LINEAR, QUALITIES[i]);
+				const a3d::Sampler sampler(packed, a3d::TextureFilters::POINT, a3d::TextureAddressModes::WRAP);
+
+				// Full size level's rows, which are rows of blocks for BC1
+				const int rows = (packed.getFormat() == a3d::TextureFormats::BC1 ? (packed.getHeight() + 3) / 4 : packed.getHeight());
+
+				sprintf_s(line, "%s (%d KB):", FORMAT_NAMES[packed.getFormat()], packed.getPitch() * rows * 4 / 1024);
+				result += line;
+				result += timeAngles(sampler, paths[path].sampleRows, sum);
+				result += "\n";
+			}
+		}
+
+		// Only there so the samples are used
+		sprintf_s(line, "\n(checksum %08x)", sum);
+		result += line;
+
+		return result;
+	}
+}
@@ -0,0 +1,11 @@
+#ifndef __TEXTUREBENCHMARK_H__
+#define __TEXTUREBENCHMARK_H__
+
+#include <string>
+
+namespace Benchmarks
+{
+	std::string runTextureBenchmark(const char* filename);
+}
+
+#endif
@@ -0,0 +1,41 @@
+// The texture benchmark's rows sampled with AVX2, built for it whatever the rest of the project targets,
+// and only run when the CPU supports it
+
+// Headers shared with the rest of the project are included before switching instruction set
+#include <math.h>
+#include <algorithm>
+
+#include <TriangleSetup.h>
+
+#include "TextureBenchmarkPaths.h"
+
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#elif defined(__GNUC__) && !defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma GCC target("avx2")
+#define SIMD_AVX2
+#elif defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#define SIMD_AVX2
+#define POP_TARGET
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define SIMD_AVX2
+#endif
+
+#include "TextureBenchmarkKernel.h"
+
+namespace Benchmarks
+{
+	SampleRowsFunction getAVX2SampleRows()
+	{
+#ifdef SIMD_AVX2
+		return &sampleRows<a3d::simd::avx2::float8>;
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef POP_TARGET
+#pragma clang attribute pop
+#endif
\ No newline at end of file
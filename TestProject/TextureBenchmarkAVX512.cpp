@@ -0,0 +1,52 @@
+// The texture benchmark's rows sampled with AVX512, built for it whatever the rest of the project targets,
+// and only run when the CPU supports it
+
+// Headers shared with the rest of the project are included before switching instruction set
+#include <math.h>
+#include <algorithm>
+
+#include <TriangleSetup.h>
+
+#include "TextureBenchmarkPaths.h"
+
+#if defined(__AVX512F__)
+#define SIMD_AVX512
+#elif defined(__GNUC__) && !defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma GCC target("avx512f")
+#define SIMD_AVX512
+#elif defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#define SIMD_AVX512
+#define POP_TARGET
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define SIMD_AVX512
+#endif
+
+// GCC's AVX512 intrinsics start from undefined vectors, which it warns about wherever they're inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "TextureBenchmarkKernel.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace Benchmarks
+{
+	SampleRowsFunction getAVX512SampleRows()
+	{
+#ifdef SIMD_AVX512
+		return &sampleRows<a3d::simd::avx512::float16>;
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef POP_TARGET
+#pragma clang attribute pop
+#endif
\ No newline at end of file
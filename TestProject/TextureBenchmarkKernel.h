@@ -0,0 +1,71 @@
+#ifndef __TEXTUREBENCHMARKKERNEL_H__
+#define __TEXTUREBENCHMARKKERNEL_H__
+
+// The texture benchmark's rows of samples, built once per instruction set by TextureBenchmarkSSE2.cpp etc,
+// which choose the SIMD.h backend they need before including this
+
+#include <math.h>
+
+#include <SampleKernel.h>
+
+#include "TextureBenchmarkPaths.h"
+
+namespace Benchmarks
+{
+	namespace
+	{
+		/*
+		 * Samples rows as TextureBenchmark.cpp's sampleRotated does, with sampleTexels over the float vector type F
+		 * Rows are sampled in whole vectors, so a row narrower than one still gets a whole vector of texels
+		 */
+		template <class F>
+		unsigned int sampleRows(const a3d::Sampler& sampler, int angle)
+		{
+			typedef typename F::Int I;
+
+			const float radians = angle * 3.14159265f / 180.0f;
+			const float c = cos(radians);
+			const float s = sin(radians);
+
+			const int width = sampler.getWidth();
+			const int height = sampler.getHeight();
+			const float centreX = width * 0.5f;
+			const float centreY = height * 0.5f;
+
+			// Steps between the lanes of a vector, and from one vector to the next
+			const F stepU = F::ramp() * F(c);
+			const F stepV = F::ramp() * F(s);
+			const F nextU((float)F::WIDTH * c);
+			const F nextV((float)F::WIDTH * s);
+
+			I sum(0);
+
+			for (int y = 0; y < height; ++y)
+			{
+				const float rowY = y - centreY;
+
+				F u = F(centreX - centreX * c - rowY * s) + stepU;
+				F v = F(centreY - centreX * s + rowY * c) + stepV;
+
+				for (int x = 0; x < width; x += F::WIDTH)
+				{
+					sum = sum + a3d::sampleTexels(sampler, u, v);
+
+					u = u + nextU;
+					v = v + nextV;
+				}
+			}
+
+			int lanes[F::WIDTH];
+			store(lanes, sum);
+
+			unsigned int total = 0;
+			for (int i = 0; i < F::WIDTH; ++i)
+				total += lanes[i];
+
+			return total;
+		}
+	}
+}
+
+#endif
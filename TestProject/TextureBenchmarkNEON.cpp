@@ -0,0 +1,18 @@
+// The texture benchmark's rows sampled with NEON, only built when the compiler is targeting an ARM CPU with NEON
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#endif
+
+#include "TextureBenchmarkKernel.h"
+
+namespace Benchmarks
+{
+	SampleRowsFunction getNEONSampleRows()
+	{
+#ifdef SIMD_NEON
+		return &sampleRows<a3d::simd::neon::float4>;
+#else
+		return 0;
+#endif
+	}
+}
\ No newline at end of file
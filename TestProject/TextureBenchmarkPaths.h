@@ -0,0 +1,22 @@
+#ifndef __TEXTUREBENCHMARKPATHS_H__
+#define __TEXTUREBENCHMARKPATHS_H__
+
+#include <Sampler.h>
+
+namespace Benchmarks
+{
+	/*
+	 * Samples a texel for every texel of the sampler's image, in rows rotated by angle degrees about its centre,
+	 * a texel apart, wrapping at its edges, and returns the sum of the texels so they can't be thrown away
+	 */
+	typedef unsigned int (*SampleRowsFunction)(const a3d::Sampler& sampler, int angle);
+
+	// Sampling with SampleKernel.h's sampleTexels a SIMD.h vector of texels at a time, built for each instruction
+	// set by TextureBenchmarkSSE2.cpp etc, or 0 where the compiler can't build for it
+	SampleRowsFunction getSSE2SampleRows();
+	SampleRowsFunction getAVX2SampleRows();
+	SampleRowsFunction getAVX512SampleRows();
+	SampleRowsFunction getNEONSampleRows();
+}
+
+#endif
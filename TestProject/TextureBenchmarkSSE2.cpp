@@ -0,0 +1,38 @@
+// The texture benchmark's rows sampled with SSE2, built for it whatever the rest of the project targets
+
+// Headers shared with the rest of the project are included before switching instruction set
+#include <math.h>
+#include <algorithm>
+
+#include <TriangleSetup.h>
+
+#include "TextureBenchmarkPaths.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#elif defined(__GNUC__) && !defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma GCC target("sse2")
+#define SIMD_SSE2
+#elif defined(__clang__) && (defined(__i386__) || defined(__x86_64__))
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#define SIMD_SSE2
+#define POP_TARGET
+#endif
+
+#include "TextureBenchmarkKernel.h"
+
+namespace Benchmarks
+{
+	SampleRowsFunction getSSE2SampleRows()
+	{
+#ifdef SIMD_SSE2
+		return &sampleRows<a3d::simd::sse2::float4>;
+#else
+		return 0;
+#endif
+	}
+}
+
+#ifdef POP_TARGET
+#pragma clang attribute pop
+#endif
\ No newline at end of file